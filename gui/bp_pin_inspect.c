@@ -424,7 +424,7 @@ void bp_pin_inspect_do(bpPinInspect *s, const pin *p, int fmt_opts) {
     /* debug stuff */
     gchar *data_info = g_strdup_printf("was_read = %s; is_null = %s; len = %lu byte(s)%s; guess_nbase = %d",
         p->obj->data.was_read ? "yes" : "no", (p->obj->data.any == NULL) ? "yes" : "no",
-        p->obj->data.len, p->obj->data.is_utf8 ? ", utf8" : "", p->obj->data.maybe_num);
+        p->obj->data.len, sysobj_data_is_utf8(&p->obj->data) ? ", utf8" : "", sysobj_data_maybe_num(&p->obj->data));
     double ui = sysobj_update_interval(p->obj);
     gchar *uidesc = "";
     if (ui == UPDATE_INTERVAL_DEFAULT) uidesc = " (use-default)";
@@ -515,7 +515,7 @@ void bp_pin_inspect_do(bpPinInspect *s, const pin *p, int fmt_opts) {
     gtk_text_buffer_get_iter_at_offset(priv->val_formatted, &iter, 0);
     gtk_text_buffer_insert_markup(priv->val_formatted, &iter, nice, -1);
 
-    if (p->obj->data.is_utf8)
+    if (sysobj_data_is_utf8(&p->obj->data))
         gtk_text_buffer_set_text(priv->val_raw, p->obj->data.str, -1);
     else {
         gchar *hex = print_hex(p->obj->data.uint8, p->obj->data.len);
@@ -21,6 +21,7 @@
 #include "bsysinfo-gtk.h"
 #include <inttypes.h> /* for PRIu64 */
 #include "uri_handler.h"
+#include "uevent.h"
 #include "bp_sysobj_search.h"
 #include "bp_sysobj_browser.h"
 #include "bp_sysobj_view.h"
@@ -109,6 +110,7 @@ static int app_init(void) {
     sysobj_append_data_path(config_dir);
     g_free(config_dir);
     sysobj_init(NULL);
+    uevent_listen_start(); /* follow hotplug while open */
     uri_set_function((uri_handler)uri_sysobj);
     about_init();
     sysobj_virt_add_simple_mkpath(":app/watchlist/no-group", NULL, "*", VSO_TYPE_DIR);
@@ -0,0 +1,78 @@
+/* :/pci/aer and :/pci/aer_hot from canned aer_dev_* counters under an alt root */
+
+#include "test_util.h"
+
+static void put(const gchar *root, const gchar *slot, const gchar *file, const gchar *contents) {
+    gchar *fn = g_strdup_printf("sys/bus/pci/devices/%s/%s", slot, file);
+    put_file(root, fn, contents);
+    g_free(fn);
+}
+
+static void put_aer(const gchar *root, const gchar *slot, int rx_err, int bad_tlp, int malf_tlp) {
+    gchar *s = g_strdup_printf(
+        "RxErr %d\nBadTLP %d\nBadDLLP 0\nRollover 0\nTimeout 0\n"
+        "NonFatalErr 0\nCorrIntErr 0\nHeaderOF 0\nTOTAL_ERR_COR %d\n",
+        rx_err, bad_tlp, rx_err + bad_tlp);
+    put(root, slot, "aer_dev_correctable", s);
+    g_free(s);
+    s = g_strdup_printf(
+        "Undefined 0\nDLP 0\nSDES 0\nTLP 0\nFCP 0\nCmpltTO 0\nMalfTLP %d\n"
+        "ECRC 0\nUnsupReq 0\nTOTAL_ERR_NONFATAL %d\n",
+        malf_tlp, malf_tlp);
+    put(root, slot, "aer_dev_nonfatal", s);
+    g_free(s);
+    put(root, slot, "aer_dev_fatal",
+        "Undefined 0\nDLP 0\nSDES 0\nTLP 0\nFCP 0\nCmpltTO 0\nMalfTLP 0\n"
+        "ECRC 0\nUnsupReq 0\nTOTAL_ERR_FATAL 0\n");
+}
+
+int main(int argc, char **argv) {
+    int fails = 0;
+    gchar *root = g_dir_make_tmp("test_aer-XXXXXX", NULL);
+    if (!root) return 1;
+
+    put_file(root, "proc/uptime", "100.00 50.00\n");
+
+    put_aer(root, "0000:00:1c.0", 50, 150, 0);
+    put_aer(root, "0000:01:00.0", 0, 0, 10);
+    put(root, "0000:02:00.0", "vendor", "0x8086\n"); /* no AER */
+    put_aer(root, "0000:03:00.0", 0, 0, 0);
+
+    sysobj_init(root);
+
+    printf("since boot:\n");
+    fails += check(":/pci/aer/0000:00:1c.0/errors_per_sec", "2.0");
+    fails += check(":/pci/aer/0000:00:1c.0/correctable_per_sec", "2.0");
+    fails += check(":/pci/aer/0000:00:1c.0/correctable/RxErr", "0.5");
+    fails += check(":/pci/aer/0000:00:1c.0/correctable/BadTLP", "1.5");
+    fails += check(":/pci/aer/0000:00:1c.0/fatal_per_sec", "0.0");
+    fails += check(":/pci/aer/0000:01:00.0/nonfatal_per_sec", "0.1");
+    fails += check(":/pci/aer/0000:01:00.0/nonfatal/MalfTLP", "0.1");
+    fails += check(":/pci/aer/0000:02:00.0/errors_per_sec", NULL);
+    fails += check(":/pci/aer/0000:03:00.0/errors_per_sec", "0.0");
+    fails += check(":/pci/aer_hot",
+        "0000:00:1c.0 2.0 2.0 0.0 0.0\n"
+        "0000:01:00.0 0.1 0.0 0.1 0.0");
+
+    /* a flapping link */
+    put_aer(root, "0000:01:00.0", 0, 0, 1010);
+    g_usleep(G_USEC_PER_SEC * 11 / 10); /* past the sample interval */
+
+    printf("later:\n");
+    fails += check(":/pci/aer/0000:00:1c.0/correctable/BadTLP", "0.0");
+    /* 1000 in 1.1s, allow for a slow machine */
+    fails += check_range(":/pci/aer/0000:01:00.0/nonfatal_per_sec", 380, 910);
+    fails += check_range(":/pci/aer/0000:01:00.0/nonfatal/MalfTLP", 380, 910);
+    gchar *hot = sysobj_raw_from_fn(":/pci/aer_hot", NULL);
+    gboolean ok = hot && g_str_has_prefix(hot, "0000:01:00.0 ") && !strchr(hot, '\n');
+    printf("%s :/pci/aer_hot = %s\n", ok ? "    " : "FAIL", hot ? hot : "(none)");
+    fails += ok ? 0 : 1;
+    g_free(hot);
+
+    printf("%s\n", fails ? "FAIL" : "OK");
+    sysobj_cleanup();
+
+    rm_tree(root);
+    g_free(root);
+    return fails ? 1 : 0;
+}
@@ -0,0 +1,77 @@
+/* util_counter_delta(), and :/block_io from canned /sys/block/<dev>/stat
+ * under an alt root: a counter that went down, and a stat that's gone */
+
+#include "test_util.h"
+
+static void put_stat(const gchar *root, const gchar *dev,
+    guint64 read_ios, guint64 read_sectors, guint64 write_ios, guint64 write_sectors, guint64 io_ticks) {
+    gchar *fn = g_strdup_printf("sys/block/%s/stat", dev);
+    gchar *stat = g_strdup_printf(
+        "%8" G_GUINT64_FORMAT " 0 %8" G_GUINT64_FORMAT " 0 %8" G_GUINT64_FORMAT " 0 %8" G_GUINT64_FORMAT
+        " 0 0 %" G_GUINT64_FORMAT " 0 0 0 0 0 0 0\n",
+        read_ios, read_sectors, write_ios, write_sectors, io_ticks);
+    put_file(root, fn, stat);
+    g_free(stat);
+    g_free(fn);
+}
+
+static int check_delta(const gchar *what, guint64 got, guint64 want) {
+    gboolean ok = (got == want);
+    printf("%s %s = %" G_GUINT64_FORMAT "%s\n", ok ? "    " : "FAIL", what, got, ok ? "" : " (wrong)");
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char **argv) {
+    int fails = 0;
+
+    printf("deltas:\n");
+    fails += check_delta("up", util_counter_delta(150, 100), 50);
+    fails += check_delta("reset", util_counter_delta(100, 4294967000), 100);
+    fails += check_delta("reset from above 2^32", util_counter_delta(1000, 5000000000), 1000);
+    fails += check_delta("32-bit wrap", util_counter32_delta(100, 4294967000), 396);
+    fails += check_delta("32-bit, reset from above 2^32", util_counter32_delta(1000, 5000000000), 1000);
+
+    gchar *root = g_dir_make_tmp("test_block_io-XXXXXX", NULL);
+    if (!root) return 1;
+    put_file(root, "proc/uptime", "100.00 50.00\n");
+
+    put_stat(root, "sda", 1000, 5000000000ULL, 500, 4294967000ULL, 0);
+    put_stat(root, "sdb", 100, 1000, 0, 0, 0);
+    put_stat(root, "sdc", 0, 0, 0, 0, 4294967000ULL);
+
+    sysobj_init(root);
+
+    printf("since boot:\n");
+    fails += check(":/block_io/sda/read_iops", "10.0");
+    fails += check(":/block_io/sda/write_iops", "5.0");
+    fails += check(":/block_io/sda/iops", "15.0");
+    fails += check(":/block_io/sdb/read_bytes_per_sec", "5120.0");
+
+    /* the disk was reset, whatever the cause, the sectors went down:
+     * counted from 0, not as a wrap at 32 or 64 bits */
+    put_stat(root, "sda", 1500, 1000, 500, 100, 0);
+    /* io_ticks is an unsigned int, it wrapped: +396ms */
+    put_stat(root, "sdc", 0, 0, 0, 0, 100);
+    gchar *sdb_stat = g_build_filename(root, "sys/block/sdb/stat", NULL);
+    g_remove(sdb_stat);
+    g_free(sdb_stat);
+    g_usleep(G_USEC_PER_SEC * 6 / 10); /* past the sample interval */
+
+    /* the interval is real time, allow for a slow machine */
+    printf("later:\n");
+    fails += check_range(":/block_io/sda/read_iops", 500 / 2.0, 500 / 0.5);
+    fails += check_range(":/block_io/sda/read_bytes_per_sec", 1000 * 512 / 2.0, 1000 * 512 / 0.5);
+    fails += check_range(":/block_io/sda/write_bytes_per_sec", 100 * 512 / 2.0, 100 * 512 / 0.5);
+    fails += check(":/block_io/sda/write_iops", "0.0");
+    /* 396ms in 600, not 100, allow for a slow machine */
+    fails += check_range(":/block_io/sdc/util", 33.0, 100.0);
+    /* removed without a uevent */
+    fails += check(":/block_io/sdb/iops", NULL);
+
+    printf("%s\n", fails ? "FAIL" : "OK");
+    sysobj_cleanup();
+
+    rm_tree(root);
+    g_free(root);
+    return fails ? 1 : 0;
+}
@@ -0,0 +1,90 @@
+/* :/cpu/residency from canned cpuidle and cpufreq stats under an alt root */
+
+#include "test_util.h"
+
+#define CPUS 4
+
+static void putf(const gchar *root, const gchar *contents, const gchar *fmt, int a, int b) {
+    gchar *file = g_strdup_printf(fmt, a, b);
+    put_file(root, file, contents);
+    g_free(file);
+}
+
+/* times in us, since boot is 100s */
+static void put_idle(const gchar *root, int cpu, int t0, int t1, int t2) {
+    static const char *names[] = { "POLL", "C1", "C6" };
+    int t[] = { t0, t1, t2 };
+    for (int s = 0; s < 3; s++) {
+        gchar *v = g_strdup_printf("%d\n", t[s]);
+        putf(root, v, "sys/devices/system/cpu/cpu%d/cpuidle/state%d/time", cpu, s);
+        g_free(v);
+        putf(root, "1000\n", "sys/devices/system/cpu/cpu%d/cpuidle/state%d/usage", cpu, s);
+        putf(root, names[s], "sys/devices/system/cpu/cpu%d/cpuidle/state%d/name", cpu, s);
+    }
+}
+
+int main(int argc, char **argv) {
+    int fails = 0;
+    gchar *root = g_dir_make_tmp("test_cpu_residency-XXXXXX", NULL);
+    if (!root) return 1;
+
+    put_file(root, "proc/uptime", "100.00 50.00\n");
+    for (int c = 0; c < CPUS; c++) {
+        if (c < 2)
+            put_idle(root, c, 1000000, 50000000, 20000000);
+        else
+            put_idle(root, c, 1000000, 30000000, 30000000);
+        putf(root, (c < 2) ? "0\n" : "1\n", "sys/devices/system/cpu/cpu%d/topology/physical_package_id", c, 0);
+    }
+    put_file(root, "sys/devices/system/cpu/cpufreq/policy0/related_cpus", "0 1\n");
+    put_file(root, "sys/devices/system/cpu/cpufreq/policy0/stats/time_in_state",
+        "800000 6000\n1600000 3000\n2400000 1000\n");
+    put_file(root, "sys/devices/system/cpu/cpufreq/policy0/stats/total_trans", "500\n");
+    put_file(root, "sys/devices/system/cpu/cpufreq/policy2/related_cpus", "2 3\n");
+    put_file(root, "sys/devices/system/cpu/cpufreq/policy2/stats/time_in_state",
+        "1000000 5000\n2000000 5000\n");
+    put_file(root, "sys/devices/system/cpu/cpufreq/policy2/stats/total_trans", "100\n");
+
+    sysobj_init(root);
+
+    printf("since boot:\n");
+    fails += check(":/cpu/residency/cpu0/state1/name", "C1");
+    fails += check(":/cpu/residency/cpu0/state0/residency", "1.0");
+    fails += check(":/cpu/residency/cpu0/state1/residency", "50.0");
+    fails += check(":/cpu/residency/cpu0/state2/residency", "20.0");
+    fails += check(":/cpu/residency/cpu0/state1/entries_per_sec", "10.0");
+    fails += check(":/cpu/residency/cpu0/idle", "71.0");
+    fails += check(":/cpu/residency/cpu0/idle_entries_per_sec", "30.0");
+    fails += check(":/cpu/residency/cpu3/idle", "61.0");
+    fails += check(":/cpu/residency/policy0/cpus", "0-1");
+    fails += check(":/cpu/residency/policy0/time_in_state", "800000 60.0\n1600000 30.0\n2400000 10.0");
+    fails += check(":/cpu/residency/policy0/avg_freq", "1200000");
+    fails += check(":/cpu/residency/policy0/transitions_per_sec", "5.0");
+    fails += check(":/cpu/residency/policy0/idle", "71.0");
+    fails += check(":/cpu/residency/policy2/avg_freq", "1500000");
+    fails += check(":/cpu/residency/package0/idle", "71.0");
+    fails += check(":/cpu/residency/package1/idle", "61.0");
+    fails += check(":/cpu/residency/package1/cpus", "2-3");
+    fails += check(":/cpu/residency/package1/avg_freq", "1500000");
+
+    /* cpu0: +0.5s in C1, policy0: +0.5s at each of the top two */
+    put_idle(root, 0, 1000000, 50500000, 20000000);
+    put_file(root, "sys/devices/system/cpu/cpufreq/policy0/stats/time_in_state",
+        "800000 6000\n1600000 3050\n2400000 1050\n");
+    g_usleep(G_USEC_PER_SEC * 11 / 10); /* past the sample interval */
+
+    printf("delta:\n");
+    fails += check(":/cpu/residency/policy0/time_in_state", "800000 0.0\n1600000 50.0\n2400000 50.0");
+    fails += check(":/cpu/residency/policy0/avg_freq", "2000000");
+    fails += check(":/cpu/residency/cpu0/state2/residency", "0.0");
+    fails += check(":/cpu/residency/cpu0/state1/entries_per_sec", "0.0");
+    /* the interval is real time, slept 1.1s, allow for a slow machine */
+    fails += check_range(":/cpu/residency/cpu0/state1/residency", 20.0, 46.0);
+
+    printf("%s\n", fails ? "FAIL" : "OK");
+    sysobj_cleanup();
+
+    rm_tree(root);
+    g_free(root);
+    return fails ? 1 : 0;
+}
@@ -0,0 +1,65 @@
+/* :/cpu/usage from canned /proc/stat under an alt root */
+
+#include "test_util.h"
+
+static const char stat_boot[] =
+    "cpu  100 0 100 800 0 0 0 0 0 0\n"
+    "cpu0 50 0 50 400 0 0 0 0 0 0\n"
+    "cpu1 50 0 50 400 0 0 0 0 0 0\n"
+    "intr 12345 0 0\n"
+    "ctxt 6789\n";
+
+/* all: +300 user, +100 system, +500 idle, +100 iowait */
+static const char stat_later[] =
+    "cpu  400 0 200 1300 100 0 0 0 0 0\n"
+    "cpu0 350 0 100 500 50 0 0 0 0 0\n"
+    "cpu1 50 0 100 800 50 0 0 0 0 0\n"
+    "intr 23456 0 0\n"
+    "ctxt 7890\n";
+
+static struct {
+    const char *path;
+    const char *boot, *later;
+} expect[] = {
+    { ":/cpu/usage/all/user",   "10.0", "30.0" },
+    { ":/cpu/usage/all/system", "10.0", "10.0" },
+    { ":/cpu/usage/all/idle",   "80.0", "50.0" },
+    { ":/cpu/usage/all/iowait", "0.0",  "10.0" },
+    { ":/cpu/usage/all/busy",   "20.0", "40.0" },
+    { ":/cpu/usage/cpu0/user",  "10.0", "60.0" },
+    { ":/cpu/usage/cpu0/busy",  "20.0", "70.0" },
+    { ":/cpu/usage/cpu1/user",  "10.0", "0.0" },
+    { ":/cpu/usage/cpu1/idle",  "80.0", "80.0" },
+    { ":/cpu/usage/cpu1/busy",  "20.0", "10.0" },
+};
+
+static int check_all(gboolean later) {
+    int fails = 0;
+    for (int i = 0; i < (int)G_N_ELEMENTS(expect); i++)
+        fails += check(expect[i].path, later ? expect[i].later : expect[i].boot);
+    return fails;
+}
+
+int main(int argc, char **argv) {
+    int fails = 0;
+    gchar *root = g_dir_make_tmp("test_cpu_usage-XXXXXX", NULL);
+    if (!root) return 1;
+    put_file(root, "proc/stat", stat_boot);
+
+    sysobj_init(root);
+
+    printf("since boot:\n");
+    fails += check_all(FALSE);
+
+    put_file(root, "proc/stat", stat_later);
+    g_usleep(G_USEC_PER_SEC / 2); /* past the sample interval */
+    printf("delta:\n");
+    fails += check_all(TRUE);
+
+    printf("%s\n", fails ? "FAIL" : "OK");
+    sysobj_cleanup();
+
+    rm_tree(root);
+    g_free(root);
+    return fails ? 1 : 0;
+}
@@ -0,0 +1,60 @@
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "cpubits.h"
+
+static int fails = 0;
+
+#define check(cond) \
+    if (!(cond)) { printf("FAIL: %s:%d %s\n", __FILE__, __LINE__, #cond); fails++; }
+
+static void check_list(const char *list, const char *expect, int count, int min, int max) {
+    cpubits *b = cpubits_from_str(list);
+    char *s = cpubits_to_str(b, NULL, 0);
+    printf("%s -> %s (%d)\n", list, s, cpubits_count(b));
+    check(strcmp(s, expect) == 0);
+    check(cpubits_count(b) == count);
+    check(cpubits_min(b) == min);
+    check(cpubits_max(b) == max);
+    free(s);
+    free(b);
+}
+
+int main(int argc, char **argv) {
+    check_list("", "", 0, -1, -1);
+    check_list("0", "0", 1, 0, 0);
+    check_list("0-3", "0-3", 4, 0, 3);
+    check_list("1,3,5-7", "1,3,5-7", 5, 1, 7);
+    check_list("0-1023", "0-1023", 1024, 0, 1023);
+    check_list("60-70,127,128", "60-70,127-128", 13, 60, 128);
+
+    /* the same set, as a mask */
+    cpubits *m = cpubits_from_mask("00000001,80000000,0000000f\n");
+    cpubits *l = cpubits_from_str("0-3,63-64");
+    check(cpubits_equal(m, l));
+    check(cpubits_count(m) == 6);
+
+    /* iteration */
+    int n = 0, i = cpubits_min(m);
+    for (; i >= 0; i = cpubits_next(m, i, -1)) n++;
+    check(n == 6);
+    check(cpubits_next(m, 3, -1) == 63);
+    check(cpubits_next(m, 3, 63) == -1);
+    check(cpubits_rank(m, 64) == 5);
+
+    cpubits *sibs = cpubits_from_str("2-3,66-67");
+    cpubits *a = cpubits_and(l, sibs);
+    cpubits *o = cpubits_or(l, sibs);
+    char *as = cpubits_to_str(a, NULL, 0);
+    char *os = cpubits_to_str(o, NULL, 0);
+    printf("and: %s, or: %s\n", as, os);
+    check(strcmp(as, "2-3") == 0);
+    check(strcmp(os, "0-3,63-64,66-67") == 0);
+    check(!cpubits_equal(a, o));
+    free(as); free(os);
+    free(a); free(o); free(sibs); free(l); free(m);
+
+    printf("%s\n", fails ? "FAIL" : "OK");
+    return fails ? 1 : 0;
+}
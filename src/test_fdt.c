@@ -0,0 +1,282 @@
+/* util_fdt.c on a small blob made here, then cut short and corrupted,
+ * and util_dt.c falling back to the files for what the blob doesn't have */
+
+#include "util_dt.h"
+#include "util_fdt.h"
+#include "test_util.h"
+#include <sys/wait.h>
+
+typedef struct {
+    GByteArray *st, *strs;
+} dtb;
+
+static void put_be32(GByteArray *b, guint32 v) {
+    v = GUINT32_TO_BE(v);
+    g_byte_array_append(b, (guint8*)&v, 4);
+}
+
+static void put_pad(GByteArray *b) {
+    static const guint8 zero[4] = {0};
+    if (b->len & 3)
+        g_byte_array_append(b, zero, 4 - (b->len & 3));
+}
+
+static void begin(dtb *d, const gchar *name) {
+    put_be32(d->st, 1);
+    g_byte_array_append(d->st, (guint8*)name, strlen(name) + 1);
+    put_pad(d->st);
+}
+
+static void end(dtb *d) {
+    put_be32(d->st, 2);
+}
+
+static void prop(dtb *d, const gchar *name, const void *data, guint32 len) {
+    put_be32(d->st, 3);
+    put_be32(d->st, len);
+    put_be32(d->st, d->strs->len);
+    g_byte_array_append(d->strs, (guint8*)name, strlen(name) + 1);
+    g_byte_array_append(d->st, data, len);
+    put_pad(d->st);
+}
+
+static void prop_u32(dtb *d, const gchar *name, guint32 v) {
+    v = GUINT32_TO_BE(v);
+    prop(d, name, &v, 4);
+}
+
+static void prop_str(dtb *d, const gchar *name, const gchar *s) {
+    prop(d, name, s, strlen(s) + 1);
+}
+
+/* header, empty reserve map, struct, strings */
+static gchar *finish(dtb *d, gsize *len) {
+    put_be32(d->st, 9);
+    GByteArray *b = g_byte_array_new();
+    guint32 off_struct = 40 + 16;
+    guint32 off_strings = off_struct + d->st->len;
+    guint32 totalsize = off_strings + d->strs->len;
+    guint32 hdr[10] = { 0xd00dfeed, totalsize, off_struct, off_strings, 40,
+        17, 16, 0, d->strs->len, d->st->len };
+    for (int i = 0; i < 10; i++)
+        put_be32(b, hdr[i]);
+    for (int i = 0; i < 4; i++)
+        put_be32(b, 0);
+    g_byte_array_append(b, d->st->data, d->st->len);
+    g_byte_array_append(b, d->strs->data, d->strs->len);
+    g_byte_array_free(d->st, TRUE);
+    g_byte_array_free(d->strs, TRUE);
+    *len = b->len;
+    return (gchar*)g_byte_array_free(b, FALSE);
+}
+
+static gchar *test_blob(gsize *len) {
+    dtb d = { g_byte_array_new(), g_byte_array_new() };
+    begin(&d, "");
+      prop_str(&d, "model", "sysobj test");
+      prop_u32(&d, "#address-cells", 1);
+      begin(&d, "cpus");
+        begin(&d, "cpu@0");
+          prop_str(&d, "compatible", "arm,cortex-a53");
+        end(&d);
+      end(&d);
+      begin(&d, "intc@100");
+        prop_u32(&d, "phandle", 1);
+        prop_u32(&d, "#interrupt-cells", 3);
+      end(&d);
+      begin(&d, "aliases");
+        prop_str(&d, "cpu0", "/cpus/cpu@0");
+      end(&d);
+    end(&d);
+    return finish(&d, len);
+}
+
+static gchar *nested_blob(int depth, gsize *len) {
+    dtb d = { g_byte_array_new(), g_byte_array_new() };
+    begin(&d, "");
+    for (int i = 0; i < depth; i++)
+        begin(&d, "n");
+    for (int i = 0; i < depth; i++)
+        end(&d);
+    end(&d);
+    return finish(&d, len);
+}
+
+static fdt_tree *parse_copy(const gchar *blob, gsize len) {
+    return fdt_parse(g_memdup(blob, len), len);
+}
+
+static void set_be32(gchar *blob, gsize off, guint32 v) {
+    v = GUINT32_TO_BE(v);
+    memcpy(blob + off, &v, 4);
+}
+
+static int check_ok(const gchar *what, gboolean ok) {
+    printf("%s %s\n", ok ? "    " : "FAIL", what);
+    return ok ? 0 : 1;
+}
+
+static int test_parse() {
+    int fails = 0;
+    gsize len = 0;
+    gchar *blob = test_blob(&len);
+
+    fdt_tree *t = parse_copy(blob, len);
+    fails += check_ok("valid blob parses", t != NULL);
+    if (t) {
+        fails += check_ok("five nodes", fdt_node_count(t) == 5);
+        fails += check_ok("version 17", t->version == 17);
+        fails += check_ok("root by /", fdt_node_find(t, "/") == t->root);
+        const fdt_prop *p = fdt_prop_find(fdt_node_find(t, "/intc@100"), "#interrupt-cells");
+        fails += check_ok("/intc@100 #interrupt-cells = 3",
+            p && p->len == 4 && GUINT32_FROM_BE(*(guint32*)p->data) == 3);
+        p = fdt_prop_find(fdt_node_find(t, "/cpus/cpu@0/"), "compatible");
+        fails += check_ok("/cpus/cpu@0/ compatible",
+            p && SEQ((const gchar*)p->data, "arm,cortex-a53"));
+        fails += check_ok("no /nope", fdt_node_find(t, "/nope") == NULL);
+        fails += check_ok("no clock-frequency",
+            fdt_prop_find(fdt_node_find(t, "/cpus/cpu@0"), "clock-frequency") == NULL);
+        fdt_free(t);
+    }
+
+    /* cut anywhere */
+    int parsed = 0;
+    for (gsize n = 0; n < len; n++) {
+        t = parse_copy(blob, n);
+        if (t) parsed++;
+        fdt_free(t);
+    }
+    fails += check_ok("no truncated blob parses", parsed == 0);
+
+    /* cut, with a header that agrees, so the struct block is walked */
+    guint32 size_struct = GUINT32_FROM_BE(*(guint32*)(blob + 36));
+    parsed = 0;
+    for (guint32 n = 0; n < size_struct; n++) {
+        gchar *cut = g_memdup(blob, len);
+        set_be32(cut, 36, n);
+        t = fdt_parse(cut, len);
+        if (t) parsed++;
+        fdt_free(t);
+    }
+    fails += check_ok("no truncated struct block parses", parsed == 0);
+
+    /* anything can happen, only that it doesn't crash */
+    static const guint8 junk[] = { 0x00, 0x01, 0x02, 0x03, 0x04, 0x09, 0x7f, 0x80, 0xff };
+    parsed = 0;
+    for (gsize i = 0; i < len; i++) {
+        for (int j = 0; j < (int)G_N_ELEMENTS(junk); j++) {
+            gchar *bad = g_memdup(blob, len);
+            bad[i] = junk[j];
+            t = fdt_parse(bad, len);
+            if (t) parsed++;
+            fdt_free(t);
+        }
+    }
+    printf("     %d of %d corrupt blobs still parsed\n", parsed, (int)(len * G_N_ELEMENTS(junk)) );
+
+    static const struct { gsize off; guint32 v; const gchar *what; } hdr_bad[] = {
+        { 0, 0xfeedd00d, "bad magic" },
+        { 4, 0xffffffff, "totalsize past the end" },
+        { 8, 0xffffff00, "struct offset past the end" },
+        { 12, 0xffffff00, "strings offset past the end" },
+        { 20, 15, "version 15" },
+        { 32, 0x7fffffff, "strings size past the end" },
+        { 36, 0x7fffffff, "struct size past the end" },
+    };
+    for (int i = 0; i < (int)G_N_ELEMENTS(hdr_bad); i++) {
+        gchar *bad = g_memdup(blob, len);
+        set_be32(bad, hdr_bad[i].off, hdr_bad[i].v);
+        t = fdt_parse(bad, len);
+        fails += check_ok(hdr_bad[i].what, t == NULL);
+        fdt_free(t);
+    }
+
+    /* the first property: token, len, nameoff after the root's
+     * begin token and its empty name */
+    gsize prop0 = 40 + 16 + 8;
+    gchar *bad = g_memdup(blob, len);
+    set_be32(bad, prop0 + 4, 0x7fffffff);
+    t = fdt_parse(bad, len);
+    fails += check_ok("property longer than the blob", t == NULL);
+    fdt_free(t);
+    bad = g_memdup(blob, len);
+    set_be32(bad, prop0 + 8, 0x7fffffff);
+    t = fdt_parse(bad, len);
+    fails += check_ok("property name outside the strings", t == NULL);
+    fdt_free(t);
+    g_free(blob);
+
+    blob = nested_blob(32, &len);
+    t = fdt_parse(blob, len);
+    fails += check_ok("nested 32 deep parses", t != NULL);
+    fdt_free(t);
+    blob = nested_blob(10000, &len);
+    t = fdt_parse(blob, len);
+    fails += check_ok("nested 10000 deep doesn't", t == NULL);
+    fdt_free(t);
+    return fails;
+}
+
+/* the blob and the files, the files have a clock-frequency
+ * and a node the blob doesn't */
+static int test_live(gboolean overlays) {
+    int fails = 0;
+    gchar *root = g_dir_make_tmp("test_fdt-XXXXXX", NULL);
+    if (!root) return 1;
+
+    gsize len = 0;
+    gchar *blob = test_blob(&len);
+    put_data(root, "sys/firmware/fdt", blob, len);
+    g_free(blob);
+    guint32 v = GUINT32_TO_BE(1200000);
+    put_data(root, DTROOT "/cpus/cpu@0/clock-frequency", &v, 4);
+    put_data(root, DTROOT "/cpus/cpu@0/compatible", "arm,cortex-a53", sizeof("arm,cortex-a53"));
+    v = GUINT32_TO_BE(1);
+    put_data(root, DTROOT "/intc@100/phandle", &v, 4);
+    v = GUINT32_TO_BE(2);
+    put_data(root, DTROOT "/overlay@200/phandle", &v, 4);
+    if (overlays)
+        put_data(root, "sys/kernel/config/device-tree/overlays/ov0/status", "applied\n", -1);
+
+    sysobj_init(root);
+
+    gchar *msg = sysobj_raw_from_fn(":/devicetree/_messages", NULL);
+    gboolean used = msg && strstr(msg, "node(s) read from");
+    printf("%s", msg ? msg : "");
+    fails += check_ok(overlays ? "blob not used with overlays" : "blob used",
+        overlays ? !used : used);
+    g_free(msg);
+
+    dt_opp_range *opp = dtr_get_opp_range(DTROOT "/cpus/cpu@0");
+    fails += check_ok("clock-frequency from the file", opp && opp->khz_max == 1200000);
+    g_free(opp);
+
+    const char *ph1 = dtr_phandle_lookup(1);
+    fails += check_ok("phandle 1", ph1 && g_str_has_suffix(ph1, "/intc@100"));
+    const char *ph2 = dtr_phandle_lookup(2);
+    fails += check_ok("phandle 2, only in the files", ph2 && g_str_has_suffix(ph2, "/overlay@200"));
+
+    sysobj_cleanup();
+    rm_tree(root);
+    g_free(root);
+    return fails;
+}
+
+int main(int argc, char **argv) {
+    int fails = test_parse();
+
+    /* each in its own process for a fresh sysobj_init() */
+    for (int f = 0; f < 2; f++) {
+        pid_t pid = fork();
+        if (pid < 0) return 1;
+        if (pid == 0)
+            _exit(test_live(f == 1) ? 1 : 0);
+        int status = 0;
+        waitpid(pid, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            fails++;
+    }
+
+    printf("%s\n", fails ? "FAIL" : "OK");
+    return fails ? 1 : 0;
+}
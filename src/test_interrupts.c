@@ -0,0 +1,307 @@
+/* :/interrupts from canned /proc/interrupts under an alt root,
+ * each fixture in its own process for a fresh sysobj_init() */
+
+#include "test_util.h"
+#include <unistd.h>
+#include <sys/wait.h>
+
+static const char uptime[] = "100.00 50.00\n";
+
+static const char x86_boot[] =
+    "            CPU0       CPU1       CPU2       CPU3       \n"
+    "   0:         40          0          0          0   IO-APIC   2-edge      timer\n"
+    "   8:          0          0          0          0   IO-APIC   8-edge      rtc0\n"
+    "  16:        100        200        300        400   IO-APIC  16-fasteoi   ehci_hcd:usb1\n"
+    " 120:          0      50000          0          0   PCI-MSI 524288-edge      nvme0q0\n"
+    " NMI:         10         10         10         10   Non-maskable interrupts\n"
+    " LOC:     100000     100000     100000     100000   Local timer interrupts\n"
+    " ERR:          0\n"
+    " MIS:          0\n";
+
+/* 16: +100 on cpu2, 120: +25000 on cpu1, LOC: +1000 each, 121 is new */
+static const char x86_later[] =
+    "            CPU0       CPU1       CPU2       CPU3       \n"
+    "   0:         40          0          0          0   IO-APIC   2-edge      timer\n"
+    "   8:          0          0          0          0   IO-APIC   8-edge      rtc0\n"
+    "  16:        100        200        400        400   IO-APIC  16-fasteoi   ehci_hcd:usb1\n"
+    " 120:          0      75000          0          0   PCI-MSI 524288-edge      nvme0q0\n"
+    " 121:          0          0         70          0   PCI-MSI 524289-edge      nvme0q1\n"
+    " NMI:         10         10         10         10   Non-maskable interrupts\n"
+    " LOC:     101000     101000     101000     101000   Local timer interrupts\n"
+    " ERR:          0\n"
+    " MIS:          0\n";
+
+/* 121 went away, like an MSI vector after a driver unload */
+static const char x86_gone[] =
+    "            CPU0       CPU1       CPU2       CPU3       \n"
+    "   0:         40          0          0          0   IO-APIC   2-edge      timer\n"
+    " 120:          0      76000          0          0   PCI-MSI 524288-edge      nvme0q0\n"
+    " LOC:     102000     102000     102000     102000   Local timer interrupts\n";
+
+/* and came back with counts from 0 */
+static const char x86_back[] =
+    "            CPU0       CPU1       CPU2       CPU3       \n"
+    "   0:         40          0          0          0   IO-APIC   2-edge      timer\n"
+    " 120:          0      77000          0          0   PCI-MSI 524288-edge      nvme0q0\n"
+    " 121:          0          0          5          0   PCI-MSI 524289-edge      nvme0q1\n"
+    " LOC:     103000     103000     103000     103000   Local timer interrupts\n";
+
+/* cpu2 is offline */
+static const char arm_boot[] =
+    "           CPU0       CPU1       CPU3       \n"
+    " 11:       5000       6000       7000     GICv2  30 Level     arch_timer\n"
+    " 38:        300          0          0     GICv2 106 Level     e0900000.mailbox\n"
+    "IPI0:       100        200        300       Rescheduling interrupts\n"
+    "IPI1:         1          2          3       Function call interrupts\n"
+    "Err:          0\n";
+
+/* 11: +3000 on cpu3 */
+static const char arm_later[] =
+    "           CPU0       CPU1       CPU3       \n"
+    " 11:       5000       6000      10000     GICv2  30 Level     arch_timer\n"
+    " 38:        300          0          0     GICv2 106 Level     e0900000.mailbox\n"
+    "IPI0:       100        200        300       Rescheduling interrupts\n"
+    "IPI1:         1          2          3       Function call interrupts\n"
+    "Err:          0\n";
+
+static const char *x86_affinity[][3] = {
+    { "0", "0-3\n", "0\n" },
+    { "16", "0-3\n", "2\n" },
+    { "120", "1\n", "1\n" },
+    { NULL }
+};
+
+typedef struct {
+    const char *path;
+    const char *want;
+} expect;
+
+typedef struct {
+    const char *path;
+    double delta; /* real time interval, so a range */
+} expect_rate;
+
+static expect x86_expect_boot[] = {
+    { ":/interrupts/irq/0/rate", "0.4" },
+    { ":/interrupts/irq/16/total", "1000" },
+    { ":/interrupts/irq/16/rate", "10.0" },
+    { ":/interrupts/irq/16/desc", "IO-APIC 16-fasteoi ehci_hcd:usb1" },
+    { ":/interrupts/irq/16/active_cpus", "0-3" },
+    { ":/interrupts/irq/16/affinity", "0-3" },
+    { ":/interrupts/irq/16/effective_affinity", "2" },
+    { ":/interrupts/irq/120/rate", "500.0" },
+    { ":/interrupts/irq/120/active_cpus", "1" },
+    { ":/interrupts/irq/LOC/total", "400000" },
+    { ":/interrupts/irq/ERR/total", "0" },
+    { ":/interrupts/cpu/cpu0/total", "100150" },
+    { ":/interrupts/cpu/cpu1/total", "150210" },
+    { ":/interrupts/cpu/cpu0/rate", "1001.5" },
+    { ":/interrupts/top",
+      "LOC 4000.0 Local timer interrupts\n"
+      "120 500.0 PCI-MSI 524288-edge nvme0q0\n"
+      "16 10.0 IO-APIC 16-fasteoi ehci_hcd:usb1\n"
+      "0 0.4 IO-APIC 2-edge timer\n"
+      "NMI 0.4 Non-maskable interrupts" },
+    { NULL }
+};
+
+static expect x86_expect_later[] = {
+    { ":/interrupts/irq/16/active_cpus", "2" },
+    { ":/interrupts/irq/120/active_cpus", "1" },
+    { ":/interrupts/irq/0/rate", "0.0" },
+    { ":/interrupts/irq/121/total", "70" },
+    { ":/interrupts/irq/121/rate", "0.0" },
+    { NULL }
+};
+
+static expect_rate x86_rate_later[] = {
+    { ":/interrupts/irq/120/rate", 25000 },
+    { ":/interrupts/irq/16/rate", 100 },
+    { ":/interrupts/cpu/cpu1/rate", 26000 },
+    { ":/interrupts/cpu/cpu2/rate", 1100 },
+    { NULL }
+};
+
+static expect arm_expect_boot[] = {
+    { ":/interrupts/irq/11/total", "18000" },
+    { ":/interrupts/irq/11/rate", "180.0" },
+    { ":/interrupts/irq/11/desc", "GICv2 30 Level arch_timer" },
+    { ":/interrupts/irq/11/active_cpus", "0-1,3" },
+    { ":/interrupts/irq/IPI0/rate", "6.0" },
+    { ":/interrupts/irq/Err/total", "0" },
+    { ":/interrupts/cpu/cpu3/total", "7303" },
+    { ":/interrupts/cpu/cpu2/total", NULL },
+    { ":/interrupts/top",
+      "11 180.0 GICv2 30 Level arch_timer\n"
+      "IPI0 6.0 Rescheduling interrupts\n"
+      "38 3.0 GICv2 106 Level e0900000.mailbox\n"
+      "IPI1 0.1 Function call interrupts" },
+    { NULL }
+};
+
+static expect arm_expect_later[] = {
+    { ":/interrupts/irq/11/active_cpus", "3" },
+    { ":/interrupts/irq/38/rate", "0.0" },
+    { NULL }
+};
+
+static expect_rate arm_rate_later[] = {
+    { ":/interrupts/irq/11/rate", 3000 },
+    { ":/interrupts/cpu/cpu3/rate", 3000 },
+    { NULL }
+};
+
+static expect wide_expect_boot[] = {
+    { ":/interrupts/irq/1/total", "523776" }, /* 0 + 1 + ... + 1023 */
+    { ":/interrupts/irq/1/active_cpus", "1-1023" },
+    { ":/interrupts/cpu/cpu1023/total", "3069" },
+    { ":/interrupts/irq/LOC/rate", "10475.5" },
+    { NULL }
+};
+
+/* 1024 cpus, every count is its cpu number, LOC doubled */
+static gchar *wide_interrupts() {
+    GString *s = g_string_new("    ");
+    for (int c = 0; c < 1024; c++)
+        g_string_append_printf(s, "       CPU%d", c);
+    g_string_append(s, "\n  1:");
+    for (int c = 0; c < 1024; c++)
+        g_string_append_printf(s, " %10d", c);
+    g_string_append(s, "   IO-APIC   1-edge      i8042\nLOC:");
+    for (int c = 0; c < 1024; c++)
+        g_string_append_printf(s, " %10d", c * 2);
+    g_string_append(s, "   Local timer interrupts\n");
+    return g_string_free(s, FALSE);
+}
+
+static int check_list(const expect *e) {
+    int fails = 0;
+    for (; e->path; e++)
+        fails += check(e->path, e->want);
+    return fails;
+}
+
+/* slept 0.5s, but allow for a slow machine */
+static int check_rate(const expect_rate *e) {
+    int fails = 0;
+    for (; e->path; e++)
+        fails += check_range(e->path, e->delta / 2.0, e->delta / 0.5);
+    return fails;
+}
+
+/* an irq that was missing from the last sample has no previous,
+ * and its nodes go when it stays gone */
+static int run_churn() {
+    int fails = 0;
+    gchar *root = g_dir_make_tmp("test_interrupts-XXXXXX", NULL);
+    if (!root) return 1;
+    put_file(root, "proc/uptime", uptime);
+    put_file(root, "proc/interrupts", x86_boot);
+    sysobj_init(root);
+
+    const gchar *samples[] = { x86_later, x86_gone, x86_back };
+    for (int i = 0; i < (int)G_N_ELEMENTS(samples); i++) {
+        put_file(root, "proc/interrupts", samples[i]);
+        g_usleep(G_USEC_PER_SEC / 2); /* past the sample interval */
+        g_free(sysobj_raw_from_fn(":/interrupts/top", NULL));
+    }
+    static const expect back[] = {
+        { ":/interrupts/irq/121/total", "5" },
+        { ":/interrupts/irq/121/rate", "0.0" },
+        { NULL }
+    };
+    printf("msi churn back:\n");
+    fails += check_list(back);
+    gchar *top = sysobj_raw_from_fn(":/interrupts/top", NULL);
+    gboolean ok = top && g_str_has_prefix(top, "LOC ");
+    printf("%s :/interrupts/top starts with LOC\n", ok ? "    " : "FAIL");
+    if (!ok) fails++;
+    g_free(top);
+
+    put_file(root, "proc/interrupts", x86_gone);
+    for (int i = 0; i < 4; i++) {
+        g_usleep(G_USEC_PER_SEC / 2);
+        g_free(sysobj_raw_from_fn(":/interrupts/top", NULL));
+    }
+    static const expect gone[] = {
+        { ":/interrupts/irq/121/total", NULL },
+        { ":/interrupts/irq/121/desc", NULL },
+        { ":/interrupts/irq/120/total", "76000" },
+        { NULL }
+    };
+    printf("msi churn gone:\n");
+    fails += check_list(gone);
+
+    sysobj_cleanup();
+
+    rm_tree(root);
+    g_free(root);
+    return fails;
+}
+
+static int run(const char *name, const gchar *boot, const gchar *later, const char *(*affinity)[3],
+    const expect *e_boot, const expect *e_later, const expect_rate *r_later) {
+    int fails = 0;
+    gchar *root = g_dir_make_tmp("test_interrupts-XXXXXX", NULL);
+    if (!root) return 1;
+    put_file(root, "proc/uptime", uptime);
+    put_file(root, "proc/interrupts", boot);
+    for (int i = 0; affinity && affinity[i][0]; i++) {
+        gchar *fn = g_strdup_printf("proc/irq/%s/smp_affinity_list", affinity[i][0]);
+        put_file(root, fn, affinity[i][1]);
+        g_free(fn);
+        fn = g_strdup_printf("proc/irq/%s/effective_affinity_list", affinity[i][0]);
+        put_file(root, fn, affinity[i][2]);
+        g_free(fn);
+    }
+
+    sysobj_init(root);
+
+    printf("%s since boot:\n", name);
+    fails += check_list(e_boot);
+
+    if (later) {
+        put_file(root, "proc/interrupts", later);
+        g_usleep(G_USEC_PER_SEC / 2); /* past the sample interval */
+        printf("%s delta:\n", name);
+        fails += check_list(e_later);
+        fails += check_rate(r_later);
+    }
+
+    sysobj_cleanup();
+
+    rm_tree(root);
+    g_free(root);
+    return fails;
+}
+
+int main(int argc, char **argv) {
+    int fails = 0;
+    gchar *wide = wide_interrupts();
+
+    for (int f = 0; f < 4; f++) {
+        pid_t pid = fork();
+        if (pid < 0) return 1;
+        if (pid == 0) {
+            int r = 0;
+            switch (f) {
+                case 0: r = run("x86", x86_boot, x86_later, x86_affinity,
+                            x86_expect_boot, x86_expect_later, x86_rate_later); break;
+                case 1: r = run("arm", arm_boot, arm_later, NULL,
+                            arm_expect_boot, arm_expect_later, arm_rate_later); break;
+                case 2: r = run("1024 cpus", wide, NULL, NULL,
+                            wide_expect_boot, NULL, NULL); break;
+                case 3: r = run_churn(); break;
+            }
+            _exit(r ? 1 : 0);
+        }
+        int status = 0;
+        waitpid(pid, &status, 0);
+        if (!WIFEXITED(status) || WEXITSTATUS(status) != 0)
+            fails++;
+    }
+    g_free(wide);
+
+    printf("%s\n", fails ? "FAIL" : "OK");
+    return fails ? 1 : 0;
+}
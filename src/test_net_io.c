@@ -0,0 +1,82 @@
+/* :/net_io from canned /proc/net/dev under an alt root */
+
+#include "test_util.h"
+
+static const char uptime[] = "100.00 50.00\n";
+
+static const char dev_boot[] =
+    "Inter-|   Receive                                                |  Transmit\n"
+    " face |bytes    packets errs drop fifo frame compressed multicast|bytes    packets errs drop fifo colls carrier compressed\n"
+    "    lo:   10000     100    0    0    0     0          0         0    10000     100    0    0    0     0       0          0\n"
+    "  eth0: 2000000    2000   10    0    0     0          0        50 4294967000  1000    0    0    0     0       0          0\n"
+    " veth1:     500       5    0    0    0     0          0         0      500       5    0    0    0     0       0          0\n";
+
+/* lo: +100000 rx bytes, eth0: +500000 rx bytes and tx bytes
+ * went down, a reset counted from 0 (+200), veth1 is gone, wlan0 is new */
+static const char dev_later[] =
+    "Inter-|   Receive                                                |  Transmit\n"
+    " face |bytes    packets errs drop fifo frame compressed multicast|bytes    packets errs drop fifo colls carrier compressed\n"
+    "    lo:  110000     100    0    0    0     0          0         0    10000     100    0    0    0     0       0          0\n"
+    "  eth0: 2500000    2000   10    0    0     0          0        50      200    1000    0    0    0     0       0          0\n"
+    " wlan0:    9000      90    0    0    0     0          0         0     9000      90    0    0    0     0       0          0\n";
+
+static struct {
+    const char *path;
+    const char *want;
+} expect_boot[] = {
+    { ":/net_io/lo/rx_bytes_per_sec",       "100.0" },
+    { ":/net_io/lo/rx_packets_per_sec",     "1.0" },
+    { ":/net_io/eth0/rx_bytes_per_sec",     "20000.0" },
+    { ":/net_io/eth0/rx_errors_per_sec",    "0.1" },
+    { ":/net_io/eth0/rx_multicast_per_sec", "0.5" },
+    { ":/net_io/eth0/tx_bytes_per_sec",     "42949670.0" },
+    { ":/net_io/eth0/tx_packets_per_sec",   "10.0" },
+    { ":/net_io/veth1/rx_bytes_per_sec",    "5.0" },
+};
+
+/* the interval is real time, so a range: slept 0.5s,
+ * but allow for a slow machine */
+static struct {
+    const char *path;
+    double delta; /* < 0: expect no value */
+} expect_later[] = {
+    { ":/net_io/lo/rx_bytes_per_sec",     100000 },
+    { ":/net_io/lo/tx_bytes_per_sec",     0 },
+    { ":/net_io/eth0/rx_bytes_per_sec",   500000 },
+    { ":/net_io/eth0/tx_bytes_per_sec",   200 },
+    { ":/net_io/eth0/rx_errors_per_sec",  0 },
+    { ":/net_io/wlan0/rx_bytes_per_sec",  0 },
+    { ":/net_io/veth1/rx_bytes_per_sec",  -1 },
+};
+
+int main(int argc, char **argv) {
+    int fails = 0;
+    gchar *root = g_dir_make_tmp("test_net_io-XXXXXX", NULL);
+    if (!root) return 1;
+    put_file(root, "proc/uptime", uptime);
+    put_file(root, "proc/net/dev", dev_boot);
+
+    sysobj_init(root);
+
+    printf("since boot:\n");
+    for (int i = 0; i < (int)G_N_ELEMENTS(expect_boot); i++)
+        fails += check(expect_boot[i].path, expect_boot[i].want);
+
+    put_file(root, "proc/net/dev", dev_later);
+    g_usleep(G_USEC_PER_SEC / 2); /* past the sample interval */
+    printf("delta:\n");
+    for (int i = 0; i < (int)G_N_ELEMENTS(expect_later); i++) {
+        double d = expect_later[i].delta;
+        if (d < 0)
+            fails += check(expect_later[i].path, NULL);
+        else
+            fails += check_range(expect_later[i].path, d / 2.0, d / 0.5);
+    }
+
+    printf("%s\n", fails ? "FAIL" : "OK");
+    sysobj_cleanup();
+
+    rm_tree(root);
+    g_free(root);
+    return fails ? 1 : 0;
+}
@@ -0,0 +1,115 @@
+/* :/numa from a synthetic 8-node /sys/devices/system/node under an alt root */
+
+#include "test_util.h"
+
+#define NODES 8
+#define CPULESS 5 /* a node with memory, but no cpus */
+
+static gchar *node_dir(const gchar *root, int n) {
+    return g_strdup_printf("%s/sys/devices/system/node/node%d", root, n);
+}
+
+static void put_meminfo(const gchar *dir, int n, int mem_free) {
+    gchar *s = g_strdup_printf(
+        "Node %d MemTotal:       %8d kB\n"
+        "Node %d MemFree:        %8d kB\n"
+        "Node %d MemUsed:        %8d kB\n"
+        "Node %d Active(file):   %8d kB\n"
+        "Node %d FilePages:      %8d kB\n"
+        "Node %d AnonPages:      %8d kB\n"
+        "Node %d HugePages_Total:     8\n"
+        "Node %d HugePages_Free:      %d\n"
+        "Node %d HugePages_Surp:      0\n",
+        n, (n + 1) * 1048576, n, mem_free, n, (n + 1) * 1048576 - mem_free,
+        n, 999, n, 2000 + n, n, 3000 + n, n, n, n % 8, n);
+    put_file(dir, "meminfo", s);
+    g_free(s);
+}
+
+/* 10 local, 16 the other node on the same socket, 32 the rest */
+static int distance(int a, int b) {
+    return (a == b) ? 10 : (a / 2 == b / 2) ? 16 : 32;
+}
+
+static void make_nodes(const gchar *root) {
+    for (int n = 0; n < NODES; n++) {
+        gchar *dir = node_dir(root, n);
+        g_mkdir_with_parents(dir, 0755);
+
+        gchar *s = (n == CPULESS) ? g_strdup("\n")
+            : g_strdup_printf("%d-%d\n", n * 4, n * 4 + 3);
+        put_file(dir, "cpulist", s);
+        g_free(s);
+
+        s = NULL;
+        for (int m = 0; m < NODES; m++)
+            s = appfsp(s, "%d", distance(n, m));
+        s = appf(s, "", "\n");
+        put_file(dir, "distance", s);
+        g_free(s);
+
+        put_meminfo(dir, n, 500 + n * 1000);
+
+        s = g_strdup_printf(
+            "numa_hit %d\nnuma_miss %d\nnuma_foreign %d\n"
+            "interleave_hit %d\nlocal_node %d\nother_node %d\n",
+            n * 100, n, n * 2, 7, n * 100 - 1, n + 1);
+        put_file(dir, "numastat", s);
+        g_free(s);
+        g_free(dir);
+    }
+}
+
+int main(int argc, char **argv) {
+    int fails = 0;
+    gchar *root = g_dir_make_tmp("test_numa-XXXXXX", NULL);
+    if (!root) return 1;
+    make_nodes(root);
+
+    sysobj_init(root);
+
+    fails += check(":/numa/nodes", "8");
+    fails += check(":/numa/node0/cpus", "0-3");
+    fails += check(":/numa/node7/cpus", "28-31");
+    fails += check(":/numa/node7/cpu_count", "4");
+    fails += check(":/numa/node5/cpus", "");
+    fails += check(":/numa/node5/cpu_count", "0");
+    fails += check(":/numa/node3/mem_total", "4194304");
+    fails += check(":/numa/node3/mem_free", "3500");
+    fails += check(":/numa/node3/mem_used", "4190804");
+    fails += check(":/numa/node3/file", "2003");
+    fails += check(":/numa/node3/anon", "3003");
+    fails += check(":/numa/node3/hugepages_total", "8");
+    fails += check(":/numa/node3/hugepages_free", "3");
+    fails += check(":/numa/node6/numa_hit", "600");
+    fails += check(":/numa/node6/numa_foreign", "12");
+    fails += check(":/numa/node6/other_node", "7");
+    fails += check(":/numa/node2/distance", "32 32 10 16 32 32 32 32");
+
+    gchar *matrix = NULL;
+    for (int a = 0; a < NODES; a++) {
+        gchar *row = NULL;
+        for (int b = 0; b < NODES; b++)
+            row = appfsp(row, "%d", distance(a, b));
+        matrix = appfnl(matrix, "%s", row);
+        g_free(row);
+    }
+    fails += check(":/numa/distance", matrix);
+    g_free(matrix);
+
+    /* the dynamic counters are read again after the interval */
+    gchar *dir = node_dir(root, 3);
+    put_meminfo(dir, 3, 123456);
+    g_free(dir);
+    fails += check(":/numa/node3/mem_free", "3500");
+    g_usleep(G_USEC_PER_SEC * 11 / 10);
+    fails += check(":/numa/node3/mem_free", "123456");
+    fails += check(":/numa/node3/mem_total", "4194304");
+
+    printf("%s\n", fails ? "FAIL" : "OK");
+    sysobj_cleanup();
+
+    rm_tree(root);
+    g_free(root);
+    return fails ? 1 : 0;
+}
@@ -0,0 +1,90 @@
+/* :/power_supply from canned uevent files under an alt root */
+
+#include "test_util.h"
+
+static void put(const gchar *root, const gchar *name, const gchar *uevent) {
+    gchar *fn = g_strdup_printf("sys/class/power_supply/%s/uevent", name);
+    put_file(root, fn, uevent);
+    g_free(fn);
+}
+
+int main(int argc, char **argv) {
+    int fails = 0;
+    gchar *root = g_dir_make_tmp("test_power_supply-XXXXXX", NULL);
+    if (!root) return 1;
+
+    /* mains, nothing to measure */
+    put(root, "AC", "POWER_SUPPLY_NAME=AC\nPOWER_SUPPLY_ONLINE=0\n");
+    /* charge based, no power_now, current is negative while discharging */
+    put(root, "BAT0",
+        "POWER_SUPPLY_NAME=BAT0\n"
+        "POWER_SUPPLY_STATUS=Discharging\n"
+        "POWER_SUPPLY_VOLTAGE_NOW=12000000\n"
+        "POWER_SUPPLY_CURRENT_NOW=-1500000\n"
+        "POWER_SUPPLY_CHARGE_FULL=4000000\n"
+        "POWER_SUPPLY_CHARGE_NOW=3000000\n"
+        "POWER_SUPPLY_CAPACITY=75\n");
+    /* only energy, power is from the change between samples */
+    put(root, "BAT1",
+        "POWER_SUPPLY_NAME=BAT1\n"
+        "POWER_SUPPLY_STATUS=Charging\n"
+        "POWER_SUPPLY_ENERGY_FULL=50000000\n"
+        "POWER_SUPPLY_ENERGY_NOW=20000000\n");
+    put(root, "BAT2",
+        "POWER_SUPPLY_NAME=BAT2\n"
+        "POWER_SUPPLY_STATUS=Discharging\n"
+        "POWER_SUPPLY_POWER_NOW=10000000\n"
+        "POWER_SUPPLY_ENERGY_NOW=30000000\n");
+
+    sysobj_init(root);
+
+    printf("first:\n");
+    fails += check(":/power_supply/AC/status", NULL);
+    fails += check(":/power_supply/BAT0/power", "18000000");
+    fails += check(":/power_supply/BAT0/power_from", "voltage_now*current_now");
+    fails += check(":/power_supply/BAT0/power_avg", "18000000");
+    fails += check(":/power_supply/BAT0/energy", "36000000");
+    fails += check(":/power_supply/BAT0/time_to_empty", "7200");
+    fails += check(":/power_supply/BAT0/time_to_full", NULL);
+    fails += check(":/power_supply/BAT1/status", "Charging");
+    fails += check(":/power_supply/BAT1/power", NULL);
+    fails += check(":/power_supply/BAT1/time_to_full", NULL);
+    fails += check(":/power_supply/BAT2/power", "10000000");
+    fails += check(":/power_supply/BAT2/power_from", "power_now");
+    fails += check(":/power_supply/BAT2/time_to_empty", "10800");
+
+    put(root, "BAT1",
+        "POWER_SUPPLY_NAME=BAT1\n"
+        "POWER_SUPPLY_STATUS=Charging\n"
+        "POWER_SUPPLY_ENERGY_FULL=50000000\n"
+        "POWER_SUPPLY_ENERGY_NOW=20010000\n");
+    put(root, "BAT2",
+        "POWER_SUPPLY_NAME=BAT2\n"
+        "POWER_SUPPLY_STATUS=Discharging\n"
+        "POWER_SUPPLY_POWER_NOW=20000000\n"
+        "POWER_SUPPLY_ENERGY_NOW=30000000\n");
+    g_usleep(G_USEC_PER_SEC * 11 / 10); /* past the sample interval */
+
+    printf("later:\n");
+    /* 10000 uWh in 1.1s is 32.7W, allow for a slow machine */
+    fails += check_range(":/power_supply/BAT1/power", 14000000, 32800000);
+    fails += check(":/power_supply/BAT1/power_from", "energy_now");
+    fails += check_range(":/power_supply/BAT1/time_to_full", 3200, 7800);
+    fails += check(":/power_supply/BAT2/power", "20000000");
+    /* a step from 10W to 20W moves the average only a little */
+    fails += check_range(":/power_supply/BAT2/power_avg", 10100000, 10800000);
+
+    /* the gauge hasn't updated, the last power still holds */
+    g_usleep(G_USEC_PER_SEC * 11 / 10);
+    printf("unchanged:\n");
+    fails += check_range(":/power_supply/BAT1/power", 14000000, 32800000);
+    fails += check(":/power_supply/BAT1/power_from", "energy_now");
+    fails += check_range(":/power_supply/BAT1/time_to_full", 3200, 7800);
+
+    printf("%s\n", fails ? "FAIL" : "OK");
+    sysobj_cleanup();
+
+    rm_tree(root);
+    g_free(root);
+    return fails ? 1 : 0;
+}
@@ -0,0 +1,75 @@
+/* Hotplug a fake disk under an alt root and check :/storage follows,
+ * using the socket pair listener instead of netlink */
+
+#include "test_util.h"
+#include "uevent.h"
+#include <unistd.h> /* for close() */
+
+/* an event is counted once its handlers are done */
+static gboolean wait_for_events(guint64 count) {
+    for (int i = 0; i < 200; i++) {
+        if (sysobj_stats.uevent_count >= count)
+            return TRUE;
+        g_usleep(10000);
+    }
+    printf("timed out waiting for event %" G_GUINT64_FORMAT "\n", count);
+    return FALSE;
+}
+
+static int storage_count() {
+    int n = 0;
+    sysobj *obj = sysobj_new_from_fn(":/storage", NULL);
+    GSList *childs = sysobj_children(obj, "storage*", NULL, FALSE);
+    n = g_slist_length(childs);
+    g_slist_free_full(childs, g_free);
+    sysobj_free(obj);
+    return n;
+}
+
+int main(int argc, char **argv) {
+    int ret = 0;
+    gchar *root = g_dir_make_tmp("test_uevent-XXXXXX", NULL);
+    if (!root) return 1;
+
+    sysobj_init(root);
+    int before = storage_count(); /* also runs the lazy generator */
+
+    /* the disk shows up after the first scan, like a hotplug */
+    gchar *dev = g_build_filename(root, "sys/block/sdz/device", NULL);
+    g_mkdir_with_parents(dev, 0755);
+    g_free(dev);
+
+    int fd = uevent_listen_fake();
+    if (fd < 0) {
+        fprintf(stderr, "couldn't start the fake listener\n");
+        return 1;
+    }
+
+    uevent_inject(fd, "add", "/devices/virtual/block/sdz",
+        "SUBSYSTEM=block", "DEVTYPE=disk", "DEVNAME=sdz", NULL);
+    if (!wait_for_events(1)) ret = 1;
+    int added = storage_count();
+    printf("add: %d -> %d\n", before, added);
+    if (added != before + 1) ret = 1;
+
+    /* same disk again shouldn't make another */
+    uevent_inject(fd, "add", "/devices/virtual/block/sdz",
+        "SUBSYSTEM=block", "DEVTYPE=disk", "DEVNAME=sdz", NULL);
+    if (!wait_for_events(2)) ret = 1;
+    if (storage_count() != added) ret = 1;
+
+    uevent_inject(fd, "remove", "/devices/virtual/block/sdz",
+        "SUBSYSTEM=block", "DEVTYPE=disk", "DEVNAME=sdz", NULL);
+    if (!wait_for_events(3)) ret = 1;
+    int removed = storage_count();
+    printf("remove: %d -> %d\n", added, removed);
+    if (removed != before) ret = 1;
+
+    printf("%s\n", ret ? "FAIL" : "OK");
+    close(fd);
+    sysobj_cleanup();
+
+    rm_tree(root);
+    g_free(root);
+    return ret;
+}
@@ -0,0 +1,61 @@
+/* shared by the test_* programs that check sysobj against
+ * canned files under an alt root */
+
+#ifndef _TEST_UTIL_H_
+#define _TEST_UTIL_H_
+
+#include "sysobj.h"
+#include <glib/gstdio.h>
+
+/* root/file, and the dirs up to it, len -1 for a string */
+static inline void put_data(const gchar *root, const gchar *file, const void *data, gssize len) {
+    gchar *fn = g_build_filename(root, file, NULL);
+    gchar *dir = g_path_get_dirname(fn);
+    g_mkdir_with_parents(dir, 0755);
+    g_file_set_contents(fn, data, len, NULL);
+    g_free(dir);
+    g_free(fn);
+}
+
+static inline void put_file(const gchar *root, const gchar *file, const gchar *contents) {
+    put_data(root, file, contents, -1);
+}
+
+/* want NULL: expect no value */
+static inline int check(const gchar *path, const gchar *want) {
+    gchar *got = sysobj_raw_from_fn(path, NULL);
+    gboolean ok = SEQ(got, want);
+    printf("%s %s = %s%s%s\n", ok ? "    " : "FAIL", path, got ? got : "(none)",
+        ok ? "" : ", expected ", ok ? "" : (want ? want : "(none)") );
+    g_free(got);
+    return ok ? 0 : 1;
+}
+
+static inline int check_range(const gchar *path, double lo, double hi) {
+    gchar *got = sysobj_raw_from_fn(path, NULL);
+    double v = got ? g_ascii_strtod(got, NULL) : -1;
+    gboolean ok = got && v >= lo && v <= hi;
+    printf("%s %s = %s\n", ok ? "    " : "FAIL", path, got ? got : "(none)");
+    g_free(got);
+    return ok ? 0 : 1;
+}
+
+/* doesn't follow symlinks, g_remove() takes the link */
+static inline void rm_tree(const gchar *path) {
+    if (!g_file_test(path, G_FILE_TEST_IS_SYMLINK)) {
+        GDir *dir = g_dir_open(path, 0, NULL);
+        if (dir) {
+            const gchar *name;
+            while ((name = g_dir_read_name(dir))) {
+                gchar *fn = g_build_filename(path, name, NULL);
+                rm_tree(fn);
+                g_free(fn);
+            }
+            g_dir_close(dir);
+        }
+    }
+    if (g_remove(path) != 0)
+        printf("couldn't remove %s\n", path);
+}
+
+#endif
@@ -18,17 +18,39 @@
  *
  */
 
+#ifndef _CPUBITS_H_
+#define _CPUBITS_H_
+
 #include <stdint.h>
 
-typedef uint32_t cpubits;
-uint32_t cpubits_count(cpubits *b);
-int cpubits_min(cpubits *b);
-int cpubits_max(cpubits *b);
-int cpubits_next(cpubits *b, int start, int end);
-cpubits *cpubits_from_str(char *str);
-char *cpubits_to_str(cpubits *bits, char *str, int max_len);
+/* sized to the highest cpu that is wanted,
+ * allocated with malloc(), use free() */
+typedef struct {
+    int nwords;
+    uint64_t w[];
+} cpubits;
+
+cpubits *cpubits_new(int nbits); /* all clear */
+cpubits *cpubits_dup(const cpubits *b);
+uint32_t cpubits_count(const cpubits *b);
+int cpubits_min(const cpubits *b);
+int cpubits_max(const cpubits *b);
+int cpubits_next(const cpubits *b, int start, int end);
+int cpubits_rank(const cpubits *b, int bit); /* set bits below bit */
+/* new sets, the size of the larger */
+cpubits *cpubits_and(const cpubits *a, const cpubits *b);
+cpubits *cpubits_or(const cpubits *a, const cpubits *b);
+int cpubits_equal(const cpubits *a, const cpubits *b);
+/* list format, like 0-3,8-11 */
+cpubits *cpubits_from_str(const char *str);
+/* hex mask format, like 00000000,00000f0f */
+cpubits *cpubits_from_mask(const char *str);
+char *cpubits_to_str(const cpubits *bits, char *str, int max_len);
+
+#define CPUBITS_MAX 65536 /* bits, well over any NR_CPUS */
+#define CPUBITS_NBITS(BITS) ((BITS)->nwords * 64)
+#define CPUBIT_SET(BITS, BIT) do { if ((BIT) >= 0 && (BIT) < CPUBITS_NBITS(BITS)) (BITS)->w[(BIT)/64] |= (1ULL << (BIT)%64); } while(0)
+#define CPUBIT_GET(BITS, BIT) ((BIT) >= 0 && (BIT) < CPUBITS_NBITS(BITS) && (((BITS)->w[(BIT)/64] >> (BIT)%64) & 1))
+#define CPUBITS_CLEAR(BITS) memset((BITS)->w, 0, (BITS)->nwords * sizeof(uint64_t))
 
-#define CPUBITS_SIZE 4096 /* bytes, multiple of sizeof(uint32_t) */
-#define CPUBIT_SET(BITS, BIT) (BITS[(BIT)/32] |= (1 << (BIT)%32))
-#define CPUBIT_GET(BITS, BIT) ((BITS[(BIT)/32] & (1 << (BIT)%32)) >> (BIT)%32)
-#define CPUBITS_CLEAR(BITS) memset(BITS, 0, CPUBITS_SIZE)
+#endif
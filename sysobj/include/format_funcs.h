@@ -64,6 +64,7 @@ gchar *fmt_1yes0no(sysobj *obj, int fmt_opts);
 gchar *fmt_megabitspersecond(sysobj *obj, int fmt_opts);
 gchar *fmt_bytes(sysobj *obj, int fmt_opts);
 gchar *fmt_bytes_to_higher(sysobj *obj, int fmt_opts);
+gchar *fmt_bytes_per_second(sysobj *obj, int fmt_opts); /* up to KiB/s, MiB/s, etc */
 gchar *fmt_KiB(sysobj *obj, int fmt_opts);
 gchar *fmt_KiB_to_MiB(sysobj *obj, int fmt_opts);
 gchar *fmt_KiB_to_higher(sysobj *obj, int fmt_opts); /* up to MiB, GiB, etc */
@@ -0,0 +1,50 @@
+/*
+ * sysobj - https://github.com/bp0/verbose-spork
+ * Copyright (C) 2018  Burt P. <pburt0@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#ifndef _PATH_INTERN_H_
+#define _PATH_INTERN_H_
+
+#include <glib.h>
+
+/* One shared, reference-counted copy of each path string.
+ * Two interned paths are equal iff the pointers are equal. */
+typedef struct path_intern {
+    const struct path_intern *parent; /* dirname, NULL at the top */
+    guint hash;   /* g_str_hash(str) */
+    gsize len;    /* strlen(str) */
+    gint ref;
+    gchar str[];
+} path_intern;
+
+/* returns a new reference, interning path if needed */
+const path_intern *path_intern_get(const gchar *path);
+/* does not add a reference. The result is only good for
+ * comparing with held handles; NULL if path is not interned */
+const path_intern *path_intern_peek(const gchar *path);
+const path_intern *path_intern_ref(const path_intern *p);
+void path_intern_unref(const path_intern *p);
+/* TRUE if p is anc, or anc is one of p's parents */
+gboolean path_intern_is_within(const path_intern *p, const path_intern *anc);
+guint path_intern_count();
+void path_intern_cleanup();
+
+#define path_intern_eq(a, b) ((a) == (b))
+
+#endif
@@ -22,11 +22,13 @@
 #define _PIN_H_
 
 #include "sysobj.h"
+#include "path_intern.h"
 
 typedef struct pin {
     double update_interval; /* 0 = static, will never be re-read */
     double last_update;
     sysobj *obj;
+    const path_intern *ipath; /* of obj->path */
     sysobj_data **history;
     const sysobj_data *min; /* in history */
     const sysobj_data *max; /* in history */
@@ -158,11 +158,18 @@ typedef struct sysobj_class {
     long long unsigned hits;
 } sysobj_class;
 
+/* sysobj_data_num_type() */
+enum {
+    SO_NUM_NONE   = 0,
+    SO_NUM_INT64  = 1,
+    SO_NUM_UINT64 = 2,
+    SO_NUM_DOUBLE = 3,
+};
+
 typedef struct sysobj_data {
     gboolean was_read;
 
     gsize len;    /* bytes */
-    gsize lines;  /* 1 + newlines (-1 if the last line empty) */
     union {
         void *any;
         gchar *str;
@@ -175,12 +182,26 @@ typedef struct sysobj_data {
         uint32_t *uint32;
         uint64_t *uint64;
     };
-    gboolean is_utf8;
-    int maybe_num; /* looks like it might be a number, value is the base (10 or 16) */
     double stamp;  /* time last read, relative to sysobj_init() */
 
     gboolean is_dir;
     GSList *childs;
+
+    /* derived from str on first use by the sysobj_data_*() accessors
+     * below, reset by each read. Don't use directly. */
+    gboolean derived;
+    gboolean is_utf8;
+    gsize lines;  /* 1 + newlines (-1 if the last line empty) */
+    gboolean trailing_nl;
+    gboolean blank; /* empty or only whitespace */
+    int maybe_num; /* looks like it might be a number, value is the base (10 or 16) */
+    int num_type;  /* SO_NUM_* */
+    int num_base;
+    union {
+        int64_t i64;
+        uint64_t u64;
+        double dbl;
+    } num;
 } sysobj_data;
 
 struct sysobj {
@@ -192,18 +213,23 @@ struct sysobj {
     gchar *path;     /* canonical, points into path_fs */
     gchar *name;
 
-    gboolean exists;
-    gboolean req_is_link;
     gchar *req_link_target; /* readlink() */
 
-    gboolean root_can_read;
-    gboolean root_can_write;
-    gboolean others_can_read;
-    gboolean others_can_write;
-    gboolean write_only;
-    gboolean access_fail; /* permission denied */
+    /* all the path and name strings above are packed
+     * into this one block, it is the only one to free */
+    gchar *strings;
+
+    guint exists : 1;
+    guint req_is_link : 1;
 
-    gboolean fast_mode;
+    guint root_can_read : 1;
+    guint root_can_write : 1;
+    guint others_can_read : 1;
+    guint others_can_write : 1;
+    guint write_only : 1;
+    guint access_fail : 1; /* permission denied */
+
+    guint fast_mode : 1;
 
     sysobj_data data;
     const sysobj_class *cls;
@@ -221,10 +247,25 @@ extern GSList *sysobj_data_paths;
 gchar *sysobj_find_data_file(const gchar *file);
 
 gboolean sysobj_root_set(const gchar *alt_root);
+/* forget all cached path resolutions, for example
+ * after a device was added or removed */
+void sysobj_path_cache_invalidate();
 const gchar *sysobj_root_get();
 #define sysobj_using_alt_root() (strlen(sysobj_root_get())!=0)
 /* NULL will not change the root
  * if sysobj_root_set() was already used. */
+/* how the generators run in sysobj_init(), set *before* sysobj_init().
+ * SO_GEN_PARALLEL: on a thread per cpu, each after the ones it requires
+ * SO_GEN_SERIAL: one after another, in a fixed order
+ * SO_GEN_LAZY: most wait until their part of the virtual tree is
+ *   first used, without it all run in sysobj_init()
+ * default: SO_GEN_PARALLEL | SO_GEN_LAZY */
+enum {
+    SO_GEN_PARALLEL = 0,
+    SO_GEN_SERIAL   = 1,
+    SO_GEN_LAZY     = 1<<1,
+};
+extern int sysobj_gen_mode;
 void sysobj_init(const gchar *alt_root);
 void sysobj_cleanup();
 double sysobj_elapsed(); /* time since sysobj_init(), in seconds */
@@ -275,7 +316,7 @@ gboolean sysobj_has_flag(sysobj *s, guint flag);
 #define sysobj_read(o, f) sysobj_read_(o, f, __FUNCTION__);
 gboolean sysobj_read_(sysobj *s, gboolean force, const char *call_func); /* TRUE = data state updated, FALSE = data state not updated. Use data.was_read to see check for read error. */
 gboolean sysobj_data_expired(sysobj *s);
-void sysobj_unread_data(sysobj *s); /* frees data, but keeps is_utf8, len, lines, etc. */
+void sysobj_unread_data(sysobj *s); /* frees data, but keeps len and the sysobj_data_*() derived values */
 const gchar *sysobj_label(sysobj *s);
 const gchar *sysobj_halp(sysobj *s);
 const gchar *sysobj_suggest(sysobj *s);
@@ -307,6 +348,14 @@ GSList *sysobj_children(sysobj *s, const gchar *include_glob, const gchar *exclu
 GSList *sysobj_children_ex(sysobj *s, GSList *filters, gboolean sort);
 
 sysobj_data *sysobj_data_dup(const sysobj_data *src);
+gboolean sysobj_data_is_utf8(sysobj_data *d);
+gsize sysobj_data_lines(sysobj_data *d);
+gboolean sysobj_data_trailing_nl(sysobj_data *d);
+gboolean sysobj_data_blank(sysobj_data *d);
+int sysobj_data_maybe_num(sysobj_data *d);
+int sysobj_data_num_type(sysobj_data *d); /* SO_NUM_*, the whole value (trimmed) parsed as a number */
+int64_t sysobj_data_int64(sysobj_data *d, int nbase); /* as strtol(str, NULL, nbase) */
+double sysobj_data_double(sysobj_data *d); /* as strtod(str, NULL) */
 void sysobj_data_free(sysobj_data *d, gboolean and_self);
 
 typedef struct {
@@ -315,6 +364,9 @@ typedef struct {
         so_new_fast,
         so_clean,
         so_free,
+        so_slab_reuse,
+        so_path_cache_hit,
+        so_path_cache_miss,
         auto_freed,
         auto_free_len,
         classify_none,
@@ -325,6 +377,11 @@ typedef struct {
         so_read_not_expired,
         so_read_wo,
         so_read_bytes,
+        so_read_derived,
+        gen_init_time, /* microseconds */
+        gen_lazy_run,
+        uevent_count,
+        vcache_restored,
         so_virt_add,
         so_virt_replace,
         so_virt_getf,
@@ -0,0 +1,44 @@
+/*
+ * sysobj - https://github.com/bp0/verbose-spork
+ * Copyright (C) 2018  Burt P. <pburt0@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#ifndef _SYSOBJ_CACHE_H_
+#define _SYSOBJ_CACHE_H_
+
+#include "sysobj.h"
+
+/* Saved virtual subtrees for things that can't change until the next
+ * boot, like ids lookups, in $XDG_CACHE_HOME/sysobj/<name>.cache.
+ * A cache is only restored when its key matches: the boot_id, the
+ * running executable, and the data files it was made from.
+ * Only the objects that are all data (see sysobj_virt_dup_static())
+ * are saved. Nothing is cached when using an alt root. */
+
+extern gboolean sysobj_cache_enabled; /* set *before* sysobj_init() */
+
+/* data_files: NULL-terminated names for sysobj_find_data_file(),
+ * extra: anything else the contents depend on; either may be NULL */
+gchar *sysobj_cache_key(const gchar * const *data_files, const gchar *extra);
+/* TRUE if the cache existed for key and was added to the virtual tree */
+gboolean sysobj_cache_restore(const gchar *name, const gchar *key);
+gboolean sysobj_cache_save(const gchar *name, const gchar *key, const gchar *glob);
+/* the same from a list of sysobj_virt, for when the tree is already gone */
+gboolean sysobj_cache_save_list(const gchar *name, const gchar *key, GSList *vos);
+
+#endif
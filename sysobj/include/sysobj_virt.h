@@ -22,6 +22,7 @@
 #define _SYSOBJ_VIRT_H_
 
 #include "sysobj.h"
+#include "path_intern.h"
 
 enum {
     VSO_TYPE_NONE     = 0,    /* if returned from f_get_type(), signal not found */
@@ -45,11 +46,13 @@ enum {
 
 typedef struct sysobj_virt {
     gchar *path;
+    const path_intern *ipath; /* set by sysobj_virt_add() */
     int type;
     gchar *str; /* default f_get_data() uses str; */
     gchar *(*f_get_data)(const gchar *path); /* f_get_data(NULL) is called for cleanup */
     int (*f_get_type)(const gchar *path);
     gboolean (*f_set_data)(const gchar *path, const gchar *data, long length);
+    gint ref; /* one for the store, one for each sysobj_virt_find() */
 } sysobj_virt;
 
 void sysobj_virt_init();
@@ -57,15 +60,46 @@ void sysobj_virt_init();
 void sysobj_virt_free(sysobj_virt *s);
 gboolean sysobj_virt_add(sysobj_virt *vo); /* TRUE if added, FALSE if exists (was overwritten) or error */
 gboolean sysobj_virt_add_simple(const gchar *base, const gchar *name, const gchar *data, int type);
+/* Collect many, then add them under one lock. With mkpath,
+ * missing parent dirs are created, like sysobj_virt_add_simple_mkpath().
+ * commit frees the batch and returns the number that were new. */
+typedef struct {
+    GPtrArray *vos;
+    gboolean mkpath;
+} sysobj_virt_batch;
+sysobj_virt_batch *sysobj_virt_batch_new(gboolean mkpath);
+void sysobj_virt_batch_add(sysobj_virt_batch *b, sysobj_virt *vo);
+void sysobj_virt_batch_add_simple(sysobj_virt_batch *b, const gchar *base, const gchar *name, const gchar *data, int type);
+int sysobj_virt_batch_commit(sysobj_virt_batch *b);
+/* a batch of all in vos, vos itself is freed */
+int sysobj_virt_add_list(GSList *vos);
+/* copies of the objects matching glob that are only data,
+ * no .f_* functions or VSO_TYPE_CONST */
+GSList *sysobj_virt_dup_static(const gchar *glob);
 gboolean sysobj_virt_add_simple_mkpath(const gchar *base, const gchar *name, const gchar *data, int type);
 void sysobj_virt_remove(gchar *glob);
+/* the vo stays valid after it is removed or replaced,
+ * until released with sysobj_virt_unref() */
 sysobj_virt *sysobj_virt_find(const gchar *path);
+void sysobj_virt_unref(sysobj_virt *vo);
 gchar *sysobj_virt_get_data(const sysobj_virt *vo, const gchar *req);
 gboolean sysobj_virt_set_data(sysobj_virt *vo, const gchar *req, const gpointer data, long length);
 int sysobj_virt_get_type(const sysobj_virt *vo, const gchar *req);
 GSList *sysobj_virt_all_paths();
+/* changes whenever a virtual object is added, removed or written */
+guint sysobj_virt_gen();
+/* changes only when that could change where a path resolves,
+ * a symlink or DYN object added, removed or written */
+guint sysobj_virt_link_gen();
+/* f_trigger(data) is called before the first find of root or
+ * anything under it, or listing of anything above it. It must
+ * be safe to call more than once and from any thread, and
+ * return TRUE once everything under root is there. */
+void sysobj_virt_add_lazy(const gchar *root, gboolean (*f_trigger)(gpointer), gpointer data);
+/* for things outside the virtual tree that need what a lazy root provides */
+void sysobj_virt_lazy_trigger(const gchar *path);
 #define sysobj_virt_count() sysobj_virt_count_ex(0)
-int sysobj_virt_count_ex(int what); /* 0 = both, 1 = vo_tree, 2 = vo_list */
+int sysobj_virt_count_ex(int what); /* 0 = both, 1 = non-DYN, 2 = DYN */
 /* using the glib key-value file parser, create a tree of
  * base/group/name=value virtual sysobj's. Items before a first
  * group are put in base/name=value. */
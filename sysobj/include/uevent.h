@@ -0,0 +1,65 @@
+/*
+ * sysobj - https://github.com/bp0/verbose-spork
+ * Copyright (C) 2018  Burt P. <pburt0@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#ifndef _UEVENT_H_
+#define _UEVENT_H_
+
+#include "sysobj.h"
+
+/* Kernel hotplug events, so generators can update just the part of
+ * their tree for a device that was added or removed.
+ * Nothing listens until uevent_listen_start() is used. */
+
+typedef struct {
+    gchar *action;    /* add, remove, change, move, bind, unbind, ... */
+    gchar *devpath;   /* relative to /sys, like /devices/virtual/block/loop0 */
+    gchar *name;      /* last part of devpath */
+    gchar *subsystem;
+    gchar *devtype;   /* may be NULL */
+    gchar *devname;   /* may be NULL */
+    guint64 seqnum;
+} uevent;
+
+#define uevent_is(ev, act) SEQ((ev)->action, act)
+
+typedef void (*uevent_handler)(const uevent *ev, gpointer user_data);
+
+/* subsystem NULL for every event, called from the listener thread.
+ * When the listener overran and events were lost, each handler gets
+ * one with action "rescan", its own subsystem, and an empty name:
+ * look at everything again. */
+void uevent_handler_add(const gchar *subsystem, uevent_handler f, gpointer user_data);
+
+/* the kernel's "action@devpath\0KEY=value\0..." message */
+gboolean uevent_parse(const gchar *buff, gsize len, uevent *ev);
+void uevent_clear(uevent *ev);
+void uevent_dispatch(const uevent *ev);
+
+gboolean uevent_listen_start(); /* NETLINK_KOBJECT_UEVENT */
+/* listen on a socket pair instead, returns the other end for
+ * uevent_inject(), or -1 */
+int uevent_listen_fake();
+/* NULL-terminated list of KEY=value */
+gboolean uevent_inject(int fd, const gchar *action, const gchar *devpath, ...)
+    __attribute__ ((sentinel));
+void uevent_listen_stop();
+void uevent_cleanup();
+
+#endif
@@ -0,0 +1,64 @@
+/*
+ * sysobj - https://github.com/bp0/verbose-spork
+ * Copyright (C) 2018  Burt P. <pburt0@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#ifndef _UTIL_FDT_H_
+#define _UTIL_FDT_H_
+
+#include <glib.h>
+#include <stdint.h>
+
+/* The flattened devicetree blob (DTB, version 16 or 17), like the
+ * kernel's /sys/firmware/fdt, read once and indexed in memory.
+ * Property data points into the blob, and is big-endian like the
+ * files in /sys/firmware/devicetree/base. */
+
+typedef struct fdt_prop {
+    const gchar *name;   /* in the strings block */
+    const guint8 *data;
+    guint32 len;
+} fdt_prop;
+
+typedef struct fdt_node {
+    gchar *path;         /* "" for the root, then "/soc", "/soc/serial@0" ... */
+    const gchar *name;   /* points into path */
+    struct fdt_node *parent;
+    GPtrArray *childs;   /* fdt_node */
+    GArray *props;       /* fdt_prop */
+} fdt_node;
+
+typedef struct {
+    gchar *blob;
+    gsize len;
+    guint32 version;
+    fdt_node *root;
+    GHashTable *nodes;   /* path -> fdt_node */
+} fdt_tree;
+
+/* NULL if file can't be read or isn't a valid blob */
+fdt_tree *fdt_load(const gchar *file);
+fdt_tree *fdt_parse(gchar *blob, gsize len); /* takes blob */
+void fdt_free(fdt_tree *t);
+
+/* path like "/soc/serial@0", "" or "/" is the root */
+const fdt_node *fdt_node_find(const fdt_tree *t, const gchar *path);
+const fdt_prop *fdt_prop_find(const fdt_node *n, const gchar *name);
+guint fdt_node_count(const fdt_tree *t);
+
+#endif
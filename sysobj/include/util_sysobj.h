@@ -46,6 +46,12 @@ int util_maybe_num(gchar *str); /* returns the guessed base, 0 for not num */
 gchar *util_find_line_value(gchar *data, gchar *key, gchar delim);
 gchar *util_strchomp_float(gchar* str_float); /* in-place, must use , or . for decimal sep */
 gchar *util_safe_name(const gchar *name, gboolean lower_case); /* make a string into a name nice and safe for file name */
+guint64 util_counter_delta(guint64 cur, guint64 prev); /* cur - prev, or cur if it went down (reset) */
+guint64 util_counter32_delta(guint64 cur, guint64 prev); /* the same, but for an unsigned int that can wrap */
+double util_sample_dt(gint64 *last); /* seconds since *last, or since boot (/proc/uptime) if 0, then *last = now */
+/* one pass over "key: value" or "key value" lines, after skip_words leading words (ex: "Node 0"),
+ * values[i] is set for each keys[i] found, the rest are untouched. Returns the number found. */
+int util_key_table_scan(const gchar *data, int skip_words, const gchar * const *keys, int nkeys, guint64 *values);
 
 /* to quiet -Wunused-parameter nagging.  */
 #define PARAM_NOT_UNUSED(p) (void)p
@@ -39,11 +39,39 @@ static attr_tab aer_items[] = {
     ATTR_TAB_LAST
 };
 
+static attr_tab aer_rate_items[] = {
+    { "errors_per_sec", N_("errors of any type per second"), OF_NONE, NULL, 1.0 },
+    { "correctable_per_sec", N_("correctable errors per second"), OF_NONE, NULL, 1.0 },
+    { "nonfatal_per_sec", N_("uncorrectable non-fatal errors per second"), OF_NONE, NULL, 1.0 },
+    { "fatal_per_sec", N_("uncorrectable fatal errors per second"), OF_NONE, NULL, 1.0 },
+    { "correctable", N_("correctable errors per second, by kind") },
+    { "nonfatal", N_("uncorrectable non-fatal errors per second, by kind") },
+    { "fatal", N_("uncorrectable fatal errors per second, by kind") },
+    { "pci", N_("the PCI device") },
+    ATTR_TAB_LAST
+};
+
 static sysobj_class cls_aer[] = {
   { SYSOBJ_CLASS_DEF
     .tag = "aer:attr", .pattern = "/sys/devices/*aer_*", .flags = OF_CONST | OF_GLOB_PATTERN,
     .attributes = aer_items,
     .s_halp = aer_reference_markup_text },
+  { SYSOBJ_CLASS_DEF
+    .tag = "aer:rates", .pattern = ":/pci/aer", .flags = OF_CONST,
+    .s_label = N_("AER error rates"), .s_halp = aer_reference_markup_text },
+  { SYSOBJ_CLASS_DEF
+    .tag = "aer:rates:device", .pattern = ":/pci/aer/*", .flags = OF_GLOB_PATTERN | OF_CONST,
+    .v_parent_path_suffix = ":/pci/aer", .v_is_node = TRUE, .s_node_format = "{{errors_per_sec}}" },
+  { SYSOBJ_CLASS_DEF
+    .tag = "aer:rates:attr", .pattern = ":/pci/aer/*/*", .flags = OF_GLOB_PATTERN | OF_CONST,
+    .attributes = aer_rate_items, .s_halp = aer_reference_markup_text },
+  { SYSOBJ_CLASS_DEF
+    .tag = "aer:rates:kind", .pattern = ":/pci/aer/*/*/*", .flags = OF_GLOB_PATTERN | OF_CONST,
+    .s_label = N_("errors per second"), .s_update_interval = 1.0 },
+  { SYSOBJ_CLASS_DEF
+    .tag = "aer:hot", .pattern = ":/pci/aer_hot", .flags = OF_CONST,
+    .s_label = N_("devices with the most AER errors per second"),
+    .s_update_interval = 1.0, .s_halp = aer_reference_markup_text },
 };
 
 void class_aer() {
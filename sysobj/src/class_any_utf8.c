@@ -26,7 +26,7 @@ gboolean any_utf8_verify(sysobj *obj) {
     /* if (obj->fast_mode) return FALSE; */
     if (!was_read)
         sysobj_read(obj, TRUE);
-    if (obj->data.is_utf8 && obj->data.len)
+    if (sysobj_data_is_utf8(&obj->data) && obj->data.len)
         verified = TRUE;
     /* if (!was_read) sysobj_unread_data(obj); */
     return verified;
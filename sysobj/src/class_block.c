@@ -38,6 +38,21 @@ static attr_tab block_items[] = {
     ATTR_TAB_LAST
 };
 
+static attr_tab block_io_items[] = {
+    { "iops", N_("I/O operations per second, including discards") },
+    { "read_iops", N_("read operations per second") },
+    { "write_iops", N_("write operations per second") },
+    { "read_bytes_per_sec", N_("read throughput"), OF_NONE, fmt_bytes_per_second },
+    { "write_bytes_per_sec", N_("write throughput"), OF_NONE, fmt_bytes_per_second },
+    { "read_await", N_("average time for a read to complete"), OF_NONE, fmt_milliseconds },
+    { "write_await", N_("average time for a write to complete"), OF_NONE, fmt_milliseconds },
+    { "await", N_("average time for a read or write to complete"), OF_NONE, fmt_milliseconds },
+    { "in_flight", N_("requests issued but not yet complete") },
+    { "queue_depth", N_("average number of requests in the queue") },
+    { "util", N_("time the device was busy"), OF_NONE, fmt_percent },
+    ATTR_TAB_LAST
+};
+
 static sysobj_class cls_block[] = {
   { SYSOBJ_CLASS_DEF
     .tag = "block", .pattern = "/sys/devices/*", .flags = OF_GLOB_PATTERN | OF_CONST,
@@ -49,6 +64,17 @@ static sysobj_class cls_block[] = {
     .tag = "block:attr:stat", .pattern = "/sys/devices/*/stat", .flags = OF_GLOB_PATTERN | OF_CONST,
     .v_subsystem_parent = "/sys/class/block", .attributes = block_items,
     .s_halp = block_stat_reference_markup_text },
+  { SYSOBJ_CLASS_DEF
+    .tag = "block_io", .pattern = ":/block_io", .flags = OF_CONST,
+    .s_label = N_("block device I/O rates"), .s_update_interval = UPDATE_INTERVAL_NEVER },
+  { SYSOBJ_CLASS_DEF
+    .tag = "block_io:dev", .pattern = ":/block_io/*", .flags = OF_GLOB_PATTERN | OF_CONST,
+    .v_parent_path_suffix = ":/block_io", .v_is_node = TRUE, .s_node_format = "{{util}}",
+    .s_update_interval = 0.5, .s_halp = block_stat_reference_markup_text },
+  { SYSOBJ_CLASS_DEF
+    .tag = "block_io:attr", .pattern = ":/block_io/*/*", .flags = OF_GLOB_PATTERN | OF_CONST,
+    .attributes = block_io_items, .s_update_interval = 0.5,
+    .s_halp = block_stat_reference_markup_text },
 };
 
 static gchar *block_format(sysobj *obj, int fmt_opts) {
@@ -152,7 +152,7 @@ gboolean dmi_value_is_placeholder(sysobj *obj) {
     if (i == -1)
         return FALSE;
 
-    v = (obj->data.was_read && obj->data.is_utf8) ? obj->data.str : NULL;
+    v = (obj->data.was_read && sysobj_data_is_utf8(&obj->data)) ? obj->data.str : NULL;
     if (v) {
         v = strdup(v);
         g_strchomp(v);
@@ -0,0 +1,76 @@
+/*
+ * sysobj - https://github.com/bp0/verbose-spork
+ * Copyright (C) 2018  Burt P. <pburt0@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#include "sysobj.h"
+#include "format_funcs.h"
+
+const gchar interrupts_reference_markup_text[] =
+    "Reference:\n"
+    BULLET REFLINK("https://www.kernel.org/doc/Documentation/filesystems/proc.txt")
+    BULLET REFLINK("https://www.kernel.org/doc/Documentation/IRQ-affinity.txt")
+    "\n";
+
+static attr_tab intr_irq_items[] = {
+    { "total", N_("interrupts since boot, all cpus") },
+    { "rate", N_("interrupts per second, all cpus") },
+    { "desc", N_("interrupt controller, hardware irq, trigger and handlers") },
+    { "active_cpus", N_("cpus that handled it since the last sample") },
+    { "affinity", N_("cpus allowed to handle it"), OF_NONE, NULL, 1.0 },
+    { "effective_affinity", N_("cpus actually set to handle it"), OF_NONE, NULL, 1.0 },
+    ATTR_TAB_LAST
+};
+
+static attr_tab intr_cpu_items[] = {
+    { "total", N_("interrupts handled since boot") },
+    { "rate", N_("interrupts handled per second") },
+    { "cpu", N_("the logical cpu") },
+    ATTR_TAB_LAST
+};
+
+static sysobj_class cls_interrupts[] = {
+  { SYSOBJ_CLASS_DEF
+    .tag = "interrupts", .pattern = ":/interrupts", .flags = OF_CONST,
+    .s_label = N_("interrupt counts and rates"), .s_update_interval = UPDATE_INTERVAL_NEVER,
+    .s_halp = interrupts_reference_markup_text },
+  { SYSOBJ_CLASS_DEF
+    .tag = "interrupts:top", .pattern = ":/interrupts/top", .flags = OF_CONST,
+    .s_label = N_("busiest interrupts, by rate"), .s_update_interval = 0.5 },
+  { SYSOBJ_CLASS_DEF
+    .tag = "interrupts:irq", .pattern = ":/interrupts/irq/*", .flags = OF_GLOB_PATTERN | OF_CONST,
+    .v_parent_path_suffix = ":/interrupts/irq", .v_is_node = TRUE, .s_node_format = "{{rate}}{{; |desc}}",
+    .s_update_interval = 0.5, .s_halp = interrupts_reference_markup_text },
+  { SYSOBJ_CLASS_DEF
+    .tag = "interrupts:irq:attr", .pattern = ":/interrupts/irq/*/*", .flags = OF_GLOB_PATTERN | OF_CONST,
+    .attributes = intr_irq_items, .s_update_interval = 0.5,
+    .s_halp = interrupts_reference_markup_text },
+  { SYSOBJ_CLASS_DEF
+    .tag = "interrupts:cpu", .pattern = ":/interrupts/cpu/*", .flags = OF_GLOB_PATTERN | OF_CONST,
+    .v_parent_path_suffix = ":/interrupts/cpu", .v_is_node = TRUE, .s_node_format = "{{rate}}",
+    .s_update_interval = 0.5 },
+  { SYSOBJ_CLASS_DEF
+    .tag = "interrupts:cpu:attr", .pattern = ":/interrupts/cpu/*/*", .flags = OF_GLOB_PATTERN | OF_CONST,
+    .attributes = intr_cpu_items, .s_update_interval = 0.5 },
+};
+
+void class_interrupts() {
+    /* add classes */
+    for (int i = 0; i < (int)G_N_ELEMENTS(cls_interrupts); i++)
+        class_add(&cls_interrupts[i]);
+}
@@ -0,0 +1,106 @@
+/*
+ * sysobj - https://github.com/bp0/verbose-spork
+ * Copyright (C) 2018  Burt P. <pburt0@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#include "sysobj.h"
+#include "format_funcs.h"
+
+const gchar net_reference_markup_text[] =
+    "Reference:\n"
+    BULLET REFLINK("https://www.kernel.org/doc/Documentation/ABI/testing/sysfs-class-net")
+    BULLET REFLINK("https://www.kernel.org/doc/Documentation/ABI/testing/sysfs-class-net-statistics")
+    "\n";
+
+static attr_tab net_items[] = {
+    { "operstate", N_("operational state (RFC 2863)") },
+    { "carrier", N_("physical link is up"), OF_NONE, fmt_1yes0no, 1.0 },
+    { "carrier_changes", N_("number of times the link has gone up or down"), OF_NONE, NULL, 1.0 },
+    { "speed", N_("link speed"), OF_NONE, fmt_megabitspersecond, 1.0 },
+    { "duplex", N_("link duplex mode"), OF_NONE, NULL, 1.0 },
+    { "mtu", N_("maximum transmission unit, in bytes") },
+    { "address", N_("hardware address") },
+    { "broadcast", N_("hardware broadcast address") },
+    { "ifindex", N_("interface index") },
+    { "iflink", N_("interface index of the link it is on") },
+    { "type", N_("ARPHRD_* link type") },
+    { "tx_queue_len", N_("transmit queue length, in packets") },
+    { "dormant", N_("waiting for an external event"), OF_NONE, fmt_1yes0no },
+    { "device", N_("the device providing the interface") },
+    { "statistics", N_("interface counters") },
+    ATTR_TAB_LAST
+};
+
+static attr_tab net_stat_items[] = {
+    { "rx_bytes", N_("bytes received"), OF_NONE, NULL, 1.0 },
+    { "rx_packets", N_("packets received"), OF_NONE, NULL, 1.0 },
+    { "rx_errors", N_("bad packets received"), OF_NONE, NULL, 1.0 },
+    { "rx_dropped", N_("packets received but dropped"), OF_NONE, NULL, 1.0 },
+    { "multicast", N_("multicast packets received"), OF_NONE, NULL, 1.0 },
+    { "tx_bytes", N_("bytes transmitted"), OF_NONE, NULL, 1.0 },
+    { "tx_packets", N_("packets transmitted"), OF_NONE, NULL, 1.0 },
+    { "tx_errors", N_("packets that could not be transmitted"), OF_NONE, NULL, 1.0 },
+    { "tx_dropped", N_("packets dropped while transmitting"), OF_NONE, NULL, 1.0 },
+    { "collisions", N_("collisions while transmitting"), OF_NONE, NULL, 1.0 },
+    ATTR_TAB_LAST
+};
+
+static attr_tab net_io_items[] = {
+    { "rx_bytes_per_sec", N_("receive throughput"), OF_NONE, fmt_bytes_per_second },
+    { "rx_packets_per_sec", N_("packets received per second") },
+    { "rx_errors_per_sec", N_("bad packets received per second") },
+    { "rx_dropped_per_sec", N_("received packets dropped per second") },
+    { "rx_multicast_per_sec", N_("multicast packets received per second") },
+    { "tx_bytes_per_sec", N_("transmit throughput"), OF_NONE, fmt_bytes_per_second },
+    { "tx_packets_per_sec", N_("packets transmitted per second") },
+    { "tx_errors_per_sec", N_("transmit errors per second") },
+    { "tx_dropped_per_sec", N_("transmit packets dropped per second") },
+    { "collisions_per_sec", N_("collisions per second") },
+    { "net", N_("the network interface") },
+    ATTR_TAB_LAST
+};
+
+static sysobj_class cls_net[] = {
+  { SYSOBJ_CLASS_DEF
+    .tag = "net", .pattern = "/sys/devices/*", .flags = OF_GLOB_PATTERN | OF_CONST,
+    .v_subsystem = "/sys/class/net", .v_is_node = TRUE, .s_node_format = "{{operstate}}{{: |speed}}",
+    .s_halp = net_reference_markup_text },
+  { SYSOBJ_CLASS_DEF
+    .tag = "net:attr", .pattern = "/sys/devices/*", .flags = OF_GLOB_PATTERN | OF_CONST,
+    .v_subsystem_parent = "/sys/class/net", .attributes = net_items,
+    .s_halp = net_reference_markup_text },
+  { SYSOBJ_CLASS_DEF
+    .tag = "net:stat", .pattern = "/sys/devices/*/net/*/statistics/*", .flags = OF_GLOB_PATTERN | OF_CONST,
+    .attributes = net_stat_items, .s_halp = net_reference_markup_text },
+  { SYSOBJ_CLASS_DEF
+    .tag = "net_io", .pattern = ":/net_io", .flags = OF_CONST,
+    .s_label = N_("network interface rates"), .s_update_interval = UPDATE_INTERVAL_NEVER },
+  { SYSOBJ_CLASS_DEF
+    .tag = "net_io:if", .pattern = ":/net_io/*", .flags = OF_GLOB_PATTERN | OF_CONST,
+    .v_parent_path_suffix = ":/net_io", .v_is_node = TRUE, .s_node_format = "{{rx_bytes_per_sec}}{{ / |tx_bytes_per_sec}}",
+    .s_update_interval = 0.5 },
+  { SYSOBJ_CLASS_DEF
+    .tag = "net_io:attr", .pattern = ":/net_io/*/*", .flags = OF_GLOB_PATTERN | OF_CONST,
+    .attributes = net_io_items, .s_update_interval = 0.5 },
+};
+
+void class_net() {
+    /* add classes */
+    for (int i = 0; i < (int)G_N_ELEMENTS(cls_net); i++)
+        class_add(&cls_net[i]);
+}
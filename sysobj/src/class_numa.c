@@ -0,0 +1,79 @@
+/*
+ * sysobj - https://github.com/bp0/verbose-spork
+ * Copyright (C) 2018  Burt P. <pburt0@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#include "sysobj.h"
+#include "format_funcs.h"
+
+const gchar numa_reference_markup_text[] =
+    "Reference:\n"
+    BULLET REFLINK("https://www.kernel.org/doc/Documentation/ABI/stable/sysfs-devices-node")
+    BULLET REFLINK("https://www.kernel.org/doc/Documentation/numastat.txt")
+    "\n";
+
+static attr_tab numa_items[] = {
+    { "nodes", N_("number of NUMA nodes") },
+    { "distance", N_("relative distance between each pair of nodes, 10 is local") },
+    ATTR_TAB_LAST
+};
+
+static attr_tab numa_node_items[] = {
+    { "cpus", N_("logical cpus in the node") },
+    { "cpu_count", N_("number of logical cpus in the node") },
+    { "distance", N_("relative distance to each node, 10 is local") },
+    { "mem_total", N_("total memory"), OF_NONE, fmt_KiB_to_higher },
+    { "mem_free", N_("free memory"), OF_NONE, fmt_KiB_to_higher, 1.0 },
+    { "mem_used", N_("used memory"), OF_NONE, fmt_KiB_to_higher, 1.0 },
+    { "file", N_("file-backed pages"), OF_NONE, fmt_KiB_to_higher, 1.0 },
+    { "anon", N_("anonymous pages"), OF_NONE, fmt_KiB_to_higher, 1.0 },
+    { "hugepages_total", N_("number of huge pages") },
+    { "hugepages_free", N_("number of free huge pages"), OF_NONE, NULL, 1.0 },
+    { "numa_hit", N_("allocated here, as intended"), OF_NONE, NULL, 1.0 },
+    { "numa_miss", N_("allocated here, intended for another node"), OF_NONE, NULL, 1.0 },
+    { "numa_foreign", N_("intended here, allocated on another node"), OF_NONE, NULL, 1.0 },
+    { "interleave_hit", N_("interleaved allocations intended here"), OF_NONE, NULL, 1.0 },
+    { "local_node", N_("allocated here for a process running here"), OF_NONE, NULL, 1.0 },
+    { "other_node", N_("allocated here for a process running on another node"), OF_NONE, NULL, 1.0 },
+    { "node", N_("the node in sysfs") },
+    ATTR_TAB_LAST
+};
+
+static sysobj_class cls_numa[] = {
+  { SYSOBJ_CLASS_DEF
+    .tag = "numa", .pattern = ":/numa", .flags = OF_CONST,
+    .s_label = N_("NUMA topology"), .s_update_interval = UPDATE_INTERVAL_NEVER,
+    .s_halp = numa_reference_markup_text },
+  { SYSOBJ_CLASS_DEF
+    .tag = "numa:node", .pattern = ":/numa/node*", .flags = OF_GLOB_PATTERN | OF_CONST,
+    .v_lblnum = "node", .v_parent_path_suffix = ":/numa", .v_is_node = TRUE,
+    .s_node_format = "{{cpus}}{{; |mem_total}}", .s_halp = numa_reference_markup_text },
+  { SYSOBJ_CLASS_DEF
+    .tag = "numa:attr", .pattern = ":/numa/*", .flags = OF_GLOB_PATTERN | OF_CONST,
+    .v_parent_path_suffix = ":/numa", .attributes = numa_items,
+    .s_update_interval = UPDATE_INTERVAL_NEVER },
+  { SYSOBJ_CLASS_DEF
+    .tag = "numa:node:attr", .pattern = ":/numa/node*/*", .flags = OF_GLOB_PATTERN | OF_CONST,
+    .attributes = numa_node_items, .s_halp = numa_reference_markup_text },
+};
+
+void class_numa() {
+    /* add classes */
+    for (int i = 0; i < (int)G_N_ELEMENTS(cls_numa); i++)
+        class_add(&cls_numa[i]);
+}
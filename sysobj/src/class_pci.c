@@ -146,7 +146,7 @@ static gchar *pci_format(sysobj *obj, int fmt_opts) {
 }
 
 static vendor_list pci_vendor_lookup(sysobj *obj) {
-    if (obj->data.is_utf8) {
+    if (sysobj_data_is_utf8(&obj->data)) {
         gchar *vendor_str = sysobj_raw_from_printf(
             ":/lookup/pci.ids/%04lx/name", strtoul(obj->data.str, NULL, 16) );
         const Vendor *v  = vendor_match(vendor_str, NULL);
@@ -19,6 +19,7 @@
  */
 
 #include "sysobj.h"
+#include "format_funcs.h"
 
 const gchar power_supply_reference_markup_text[] =
     "Reference:\n"
@@ -39,6 +40,18 @@ static attr_tab power_supply_items[] = {
     ATTR_TAB_LAST
 };
 
+static attr_tab power_supply_derived_items[] = {
+    { "power", N_("power, as reported or derived"), OF_NONE, fmt_microwatt, 1.0 },
+    { "power_from", N_("what power is derived from") },
+    { "power_avg", N_("power, smoothed over about a minute"), OF_NONE, fmt_microwatt, 1.0 },
+    { "energy", N_("remaining energy in microwatt-hours"), OF_NONE, NULL, 1.0 },
+    { "time_to_empty", N_("estimated time until empty, at the smoothed rate"), OF_NONE, fmt_seconds_to_span, 1.0 },
+    { "time_to_full", N_("estimated time until full, at the smoothed rate"), OF_NONE, fmt_seconds_to_span, 1.0 },
+    { "status" },
+    { "supply", N_("the power supply") },
+    ATTR_TAB_LAST
+};
+
 static sysobj_class cls_power_supply[] = {
   { SYSOBJ_CLASS_DEF
     .tag = "power_supply", .pattern = "/sys/devices/*", .flags = OF_CONST | OF_GLOB_PATTERN | OF_HAS_VENDOR,
@@ -49,6 +62,16 @@ static sysobj_class cls_power_supply[] = {
     .tag = "power_supply:attr", .pattern = "/sys/devices/*", .flags = OF_CONST | OF_GLOB_PATTERN,
     .v_subsystem_parent = "/sys/class/power_supply", .attributes = power_supply_items,
     .s_halp = power_supply_reference_markup_text },
+  { SYSOBJ_CLASS_DEF
+    .tag = "power_supply:derived", .pattern = ":/power_supply", .flags = OF_CONST,
+    .s_label = N_("Power supply rates and estimates"), .s_halp = power_supply_reference_markup_text },
+  { SYSOBJ_CLASS_DEF
+    .tag = "power_supply:derived:supply", .pattern = ":/power_supply/*", .flags = OF_GLOB_PATTERN | OF_CONST,
+    .v_parent_path_suffix = ":/power_supply", .v_is_node = TRUE, .s_node_format = "{{power_avg}}{{; |status}}" },
+  { SYSOBJ_CLASS_DEF
+    .tag = "power_supply:derived:attr", .pattern = ":/power_supply/*/*", .flags = OF_GLOB_PATTERN | OF_CONST,
+    .attributes = power_supply_derived_items, .s_update_interval = 1.0,
+    .s_halp = power_supply_reference_markup_text },
 };
 
 void class_power_supply() {
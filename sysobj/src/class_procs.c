@@ -35,6 +35,34 @@ static attr_tab procs_items[] = {
     ATTR_TAB_LAST
 };
 
+static attr_tab usage_items[] = {
+    { "user", N_("time in user mode"), OF_NONE, fmt_percent },
+    { "nice", N_("time in user mode with low priority"), OF_NONE, fmt_percent },
+    { "system", N_("time in kernel mode"), OF_NONE, fmt_percent },
+    { "idle", N_("idle time"), OF_NONE, fmt_percent },
+    { "iowait", N_("idle time waiting for I/O"), OF_NONE, fmt_percent },
+    { "irq", N_("time servicing interrupts"), OF_NONE, fmt_percent },
+    { "softirq", N_("time servicing softirqs"), OF_NONE, fmt_percent },
+    { "steal", N_("time taken by the hypervisor for other guests"), OF_NONE, fmt_percent },
+    { "busy", N_("time not idle or waiting for I/O"), OF_NONE, fmt_percent },
+    ATTR_TAB_LAST
+};
+
+static attr_tab residency_items[] = {
+    { "idle", N_("time in any idle state"), OF_NONE, fmt_percent },
+    { "idle_entries_per_sec", N_("idle state entries per second") },
+    { "residency", N_("time in this idle state"), OF_NONE, fmt_percent },
+    { "entries_per_sec", N_("entries into this idle state per second") },
+    { "name", N_("name of the idle state") },
+    { "cpus", N_("logical cpus") },
+    { "time_in_state", N_("percent of the time at each frequency, in kHz") },
+    { "avg_freq", N_("average frequency, weighted by time"), OF_NONE, fmt_khz_to_mhz },
+    { "transitions_per_sec", N_("frequency changes per second") },
+    { "cpu", N_("the logical cpu") },
+    { "policy", N_("the frequency scaling policy") },
+    ATTR_TAB_LAST
+};
+
 static sysobj_class cls_procs[] = {
   { SYSOBJ_CLASS_DEF
     .tag = "procs", .pattern = ":/cpu", .flags = OF_CONST | OF_HAS_VENDOR,
@@ -56,6 +84,32 @@ static sysobj_class cls_procs[] = {
     .tag = "procs:attr", .pattern = ":/cpu/*", .flags = OF_GLOB_PATTERN | OF_CONST,
     .v_parent_path_suffix = ":/cpu", .attributes = procs_items,
     .s_update_interval = UPDATE_INTERVAL_NEVER },
+  { SYSOBJ_CLASS_DEF
+    .tag = "procs:usage", .pattern = ":/cpu/usage", .flags = OF_CONST,
+    .s_label = N_("processor utilization from /proc/stat"),
+    .s_update_interval = UPDATE_INTERVAL_NEVER },
+  { SYSOBJ_CLASS_DEF
+    .tag = "procs:usage:cpu", .pattern = ":/cpu/usage/*", .flags = OF_GLOB_PATTERN | OF_CONST,
+    .v_parent_path_suffix = ":/cpu/usage", .v_is_node = TRUE, .s_node_format = "{{busy}}",
+    .s_update_interval = 1.0 },
+  { SYSOBJ_CLASS_DEF
+    .tag = "procs:usage:stat", .pattern = ":/cpu/usage/*/*", .flags = OF_GLOB_PATTERN | OF_CONST,
+    .attributes = usage_items, .s_update_interval = 1.0 },
+  { SYSOBJ_CLASS_DEF
+    .tag = "procs:residency", .pattern = ":/cpu/residency", .flags = OF_CONST,
+    .s_label = N_("idle state and frequency residency from cpuidle and cpufreq stats"),
+    .s_update_interval = UPDATE_INTERVAL_NEVER },
+  { SYSOBJ_CLASS_DEF
+    .tag = "procs:residency:item", .pattern = ":/cpu/residency/*", .flags = OF_GLOB_PATTERN | OF_CONST,
+    .v_parent_path_suffix = ":/cpu/residency", .v_is_node = TRUE, .s_node_format = "{{idle}}",
+    .s_update_interval = 1.0 },
+  { SYSOBJ_CLASS_DEF
+    .tag = "procs:residency:state", .pattern = ":/cpu/residency/cpu*/state*", .flags = OF_GLOB_PATTERN | OF_CONST,
+    .v_lblnum = "state", .v_is_node = TRUE, .s_node_format = "{{name}}{{: |residency}}",
+    .s_update_interval = 1.0 },
+  { SYSOBJ_CLASS_DEF
+    .tag = "procs:residency:attr", .pattern = ":/cpu/residency/*", .flags = OF_GLOB_PATTERN | OF_CONST,
+    .attributes = residency_items, .s_update_interval = 1.0 },
 };
 
 static gchar *procs_summarize_topology(int packs, int cores, int threads, int logical) {
@@ -79,6 +79,7 @@ static attr_tab sysobj_items[] = {
     { "virt_count", N_("number of objects in the sysobj virtual tree") },
     { "vo_tree_count" },
     { "vo_list_count" },
+    { "intern_count", N_("number of interned path strings") },
     { "virt_iter", N_("steps through the dynamic virtual object list") },
     { "virt_rm" },
     { "virt_add" },
@@ -95,13 +96,21 @@ static attr_tab sysobj_items[] = {
     { "sysobj_new_fast", N_("sysobj created without sysobj_classify()") },
     { "sysobj_clean", N_("sysobj cleared") },
     { "sysobj_free", N_("sysobj freed") },
+    { "sysobj_slab_reuse", N_("sysobj_new() that reused a freed sysobj") },
+    { "path_cache_hit", N_("requested paths resolved from the cache") },
+    { "path_cache_miss", N_("requested paths resolved through the filesystem and virtual tree") },
     { "gg_file_total_wait", N_("time spent waiting for read() in gg_file_get_contents_non_blocking()"), OF_NONE, fmt_microseconds_to_milliseconds },
+    { "gen_init_time", N_("time spent running the generators in sysobj_init()"), OF_NONE, fmt_microseconds_to_milliseconds },
+    { "gen_lazy_run", N_("generators run on first use of their virtual tree") },
+    { "uevent_count", N_("hotplug events received") },
+    { "vcache_restored", N_("virtual objects restored from the on-disk cache") },
     { "sysobj_read_first" },
     { "sysobj_read_force" },
     { "sysobj_read_expired" },
     { "sysobj_read_not_expired" },
     { "sysobj_read_wo" },
     { "sysobj_read_bytes", NULL, OF_NONE, fmt_bytes_to_higher },
+    { "sysobj_read_derived", N_("reads that needed utf8/lines/number info computed") },
     { "ven_iter", N_("steps through the vendors list") },
     { "filter_iter" },
     { "filter_pattern_cmp" },
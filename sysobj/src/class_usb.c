@@ -169,7 +169,7 @@ static gchar *usb_format(sysobj *obj, int fmt_opts) {
 }
 
 static vendor_list usb_vendor_lookup(sysobj *obj) {
-    if (obj->data.is_utf8) {
+    if (sysobj_data_is_utf8(&obj->data)) {
         gchar *vendor_str = sysobj_raw_from_printf(
             ":/lookup/usb.ids/%04lx/name", strtoul(obj->data.str, NULL, 16) );
         const Vendor *v = vendor_match(vendor_str, NULL);
@@ -23,7 +23,8 @@
 
 /*
  * - generators create virtual sysobj's
- *    - can't use sysobj_format, only sysobj_raw as there are no classes yet.
+ *    - can't use sysobj_format, only sysobj_raw as there are no classes yet
+ *      (or, if lazy, there may be).
  * - classes provide interpretation and formatting of sysobj's
  */
 
@@ -43,29 +44,238 @@ void gen_mobo(); /* requires :/extern/dmidecode :/raspberry_pi */
 void gen_cpuinfo(); /* creates in :/cpu, before it exists */
 void gen_meminfo();
 void gen_procs(); /* requires :/cpu/cpuinfo */
+void gen_cpu_usage();
+void gen_cpu_residency();
 void gen_gpu();   /* requires gen_*_ids, gen_dt */
 void gen_storage();
+void gen_block_io();
+void gen_net_io();
+void gen_interrupts();
+void gen_numa();
+void gen_power_supply();
+void gen_aer();
+void gen_aer_hot(); /* requires gen_aer */
+
+/* generators and what they need to have run first. Without
+ * requirements they can run in any order, or at the same time.
+ * Listed in the order they run with SO_GEN_SERIAL.
+ * With SO_GEN_LAZY, one with a lazy_root waits until something
+ * under that root is used. */
+#define GEN_REQ_MAX 6
+typedef struct {
+    const gchar *name;
+    void (*f_gen)();
+    const gchar *lazy_root;
+    const gchar *requires[GEN_REQ_MAX]; /* by name */
+} gen_tab;
+
+static const gen_tab generators[] = {
+    { "gen_dt", gen_dt, ":/devicetree" },
+    { "gen_pci_ids", gen_pci_ids, ":/lookup/pci.ids" },
+    { "gen_usb_ids", gen_usb_ids, ":/lookup/usb.ids" },
+    { "gen_arm_ids", gen_arm_ids, ":/lookup/arm.ids" },
+    { "gen_sdio_ids", gen_sdio_ids, ":/lookup/sdio.ids" },
+    { "gen_sdcard_ids", gen_sdcard_ids, ":/lookup/sdcard.ids" },
+    { "gen_dt_ids", gen_dt_ids, ":/lookup/dt.ids" },
+    { "gen_edid_ids", gen_edid_ids, ":/lookup/edid.ids" },
+    { "gen_os_release", gen_os_release, ":/os" },
+    { "gen_dmidecode", gen_dmidecode, ":/extern/dmidecode" },
+    { "gen_rpi", gen_rpi }, /* adds to ":" */
+    { "gen_mobo", gen_mobo, ":/mobo", { "gen_dmidecode", "gen_rpi" } },
+    { "gen_cpuinfo", gen_cpuinfo, ":/cpu/cpuinfo", { "gen_arm_ids" } }, /* arm part names at scan */
+    { "gen_meminfo", gen_meminfo, ":/meminfo" },
+    { "gen_procs", gen_procs, ":/cpu", { "gen_cpuinfo", "gen_dt_ids", "gen_usb_ids" } }, /* find_soc() */
+    { "gen_cpu_usage", gen_cpu_usage, ":/cpu/usage" },
+    { "gen_cpu_residency", gen_cpu_residency, ":/cpu/residency" },
+    { "gen_gpu", gen_gpu, ":/gpu", { "gen_pci_ids", "gen_usb_ids", "gen_dt_ids", "gen_edid_ids", "gen_dt" } },
+    { "gen_storage", gen_storage, ":/storage" },
+    { "gen_block_io", gen_block_io, ":/block_io" },
+    { "gen_net_io", gen_net_io, ":/net_io" },
+    { "gen_interrupts", gen_interrupts, ":/interrupts" },
+    { "gen_numa", gen_numa, ":/numa" },
+    { "gen_power_supply", gen_power_supply, ":/power_supply" },
+    { "gen_aer", gen_aer, ":/pci/aer" },
+    { "gen_aer_hot", gen_aer_hot, ":/pci/aer_hot", { "gen_aer" } },
+};
+#define GEN_COUNT ((int)G_N_ELEMENTS(generators))
+
+int sysobj_gen_mode = SO_GEN_PARALLEL | SO_GEN_LAZY;
+
+enum { GEN_WAITING, GEN_RUNNING, GEN_DONE };
+
+#define gen_is_lazy(i) (sysobj_gen_mode & SO_GEN_LAZY && generators[i].lazy_root)
+
+/* a generator runs once, any other thread that needs it waits
+ * on its lock until it is done. Recursive, because a generator's
+ * own lookups under its lazy_root trigger it again. */
+static GRecMutex gen_lock[GEN_COUNT];
+static gint gen_state[GEN_COUNT];
+
+typedef struct {
+    GMutex lock;
+    GCond cond;
+    int state[GEN_COUNT];
+    int running, done;
+} gen_run;
+
+#define gen_msg(fmt, ...) fprintf (stderr, "[%s] " fmt "\n", __FUNCTION__, ##__VA_ARGS__)
+
+static int gen_lookup(const gchar *name) {
+    for (int i = 0; i < GEN_COUNT; i++)
+        if (SEQ(generators[i].name, name))
+            return i;
+    return -1;
+}
+
+/* requirements first, if they haven't run yet. Those run before
+ * taking this one's lock, so no thread ever holds one generator's
+ * lock while it waits on another's, whatever root it came in from.
+ * depth is only to stop a requirement loop. */
+static void gen_once_depth(int i, int depth) {
+    if (g_atomic_int_get(&gen_state[i]) == GEN_DONE)
+        return;
+    if (depth > GEN_COUNT) {
+        gen_msg("%s is in a requirement loop", generators[i].name);
+        return;
+    }
+    for (int d = 0; d < GEN_REQ_MAX && generators[i].requires[d]; d++) {
+        int di = gen_lookup(generators[i].requires[d]);
+        if (di >= 0)
+            gen_once_depth(di, depth + 1);
+    }
+    g_rec_mutex_lock(&gen_lock[i]);
+    if (gen_state[i] == GEN_WAITING) {
+        gen_state[i] = GEN_RUNNING;
+        generators[i].f_gen();
+        if (gen_is_lazy(i))
+            sysobj_stats.gen_lazy_run++;
+        g_atomic_int_set(&gen_state[i], GEN_DONE);
+    }
+    /* else GEN_RUNNING in this thread, already underway */
+    g_rec_mutex_unlock(&gen_lock[i]);
+}
+
+static void gen_once(int i) {
+    gen_once_depth(i, 0);
+}
+
+static gboolean gen_lazy_trigger(gpointer data) {
+    int i = GPOINTER_TO_INT(data);
+    gen_once(i);
+    return (g_atomic_int_get(&gen_state[i]) == GEN_DONE);
+}
+
+/* requires r->lock held */
+static int gen_next_ready(gen_run *r) {
+    for (int i = 0; i < GEN_COUNT; i++) {
+        if (r->state[i] != GEN_WAITING) continue;
+        gboolean ready = TRUE;
+        for (int d = 0; d < GEN_REQ_MAX && generators[i].requires[d]; d++) {
+            int di = gen_lookup(generators[i].requires[d]);
+            if (di < 0) {
+                gen_msg("%s requires unknown %s", generators[i].name, generators[i].requires[d]);
+                continue;
+            }
+            if (r->state[di] != GEN_DONE) {
+                ready = FALSE;
+                break;
+            }
+        }
+        if (ready) return i;
+    }
+    return -1;
+}
+
+static gpointer gen_worker(gen_run *r) {
+    g_mutex_lock(&r->lock);
+    while (r->done < GEN_COUNT) {
+        int i = gen_next_ready(r);
+        if (i < 0) {
+            if (!r->running)
+                break; /* nothing left can run, a requirement loop */
+            g_cond_wait(&r->cond, &r->lock);
+            continue;
+        }
+        r->state[i] = GEN_RUNNING;
+        r->running++;
+        g_mutex_unlock(&r->lock);
+        gen_once(i);
+        g_mutex_lock(&r->lock);
+        r->state[i] = GEN_DONE;
+        r->running--;
+        r->done++;
+        g_cond_broadcast(&r->cond);
+    }
+    g_mutex_unlock(&r->lock);
+    return NULL;
+}
+
+/* generators auto_free() on whatever thread they run on,
+ * what a worker thread left goes with it */
+static gpointer gen_worker_thread(gen_run *r) {
+    gen_worker(r);
+    free_auto_free_thread_final();
+    return NULL;
+}
+
+static void generators_run_parallel() {
+    gen_run r;
+    GThread *threads[GEN_COUNT];
+    int i, nt = g_get_num_processors();
+    if (nt > GEN_COUNT) nt = GEN_COUNT;
+
+    memset(&r, 0, sizeof(gen_run));
+    g_mutex_init(&r.lock);
+    g_cond_init(&r.cond);
+
+    /* lazy ones are out of the graph */
+    for (i = 0; i < GEN_COUNT; i++) {
+        if (gen_is_lazy(i)) {
+            r.state[i] = GEN_DONE;
+            r.done++;
+        }
+    }
+
+    /* this thread is one of the workers */
+    for (i = 1; i < nt; i++)
+        threads[i] = g_thread_new(NULL, (GThreadFunc)gen_worker_thread, &r);
+    gen_worker(&r);
+    for (i = 1; i < nt; i++)
+        g_thread_join(threads[i]);
+
+    if (r.done < GEN_COUNT) {
+        for (i = 0; i < GEN_COUNT; i++) {
+            if (r.state[i] != GEN_DONE) {
+                gen_msg("%s requirements never finished, running anyway", generators[i].name);
+                gen_once(i);
+            }
+        }
+    }
+
+    g_cond_clear(&r.cond);
+    g_mutex_clear(&r.lock);
+}
 
 void generators_init() {
+    gint64 start = g_get_monotonic_time();
+    int i;
+
     gen_sysobj(); /* internals, like vsysfs root (":") */
 
-    gen_dt();
-    gen_pci_ids();
-    gen_usb_ids();
-    gen_arm_ids();
-    gen_sdio_ids();
-    gen_sdcard_ids();
-    gen_dt_ids();
-    gen_edid_ids();
-    gen_os_release();
-    gen_dmidecode();
-    gen_rpi();
-    gen_mobo();
-    gen_cpuinfo();
-    gen_meminfo();
-    gen_procs();
-    gen_gpu();
-    gen_storage();
+    for (i = 0; i < GEN_COUNT; i++) {
+        gen_state[i] = GEN_WAITING;
+        if (gen_is_lazy(i))
+            sysobj_virt_add_lazy(generators[i].lazy_root, gen_lazy_trigger, GINT_TO_POINTER(i));
+    }
+
+    if (sysobj_gen_mode & SO_GEN_SERIAL) {
+        for (i = 0; i < GEN_COUNT; i++)
+            if (!gen_is_lazy(i))
+                gen_once(i);
+    } else
+        generators_run_parallel();
+
+    sysobj_stats.gen_init_time = g_get_monotonic_time() - start;
 }
 
 void class_sysobj();
@@ -92,6 +302,9 @@ void class_nvme();
 void class_storage();
 void class_aer();
 void class_power_supply();
+void class_net();
+void class_interrupts();
+void class_numa();
 
 void class_uptime();
 void class_dmi_id();
@@ -138,6 +351,9 @@ void class_init() {
     class_storage();
     class_aer();
     class_power_supply();
+    class_net();
+    class_interrupts();
+    class_numa();
 
     class_cpu();
     class_cpufreq();
@@ -21,111 +21,211 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <ctype.h>
 #include "cpubits.h"
 
-uint32_t cpubits_count(cpubits *b) {
-    static const uint32_t max = CPUBITS_SIZE * 8;
-    uint32_t count = 0, i = 0;
-    while (i < max) {
-        count += CPUBIT_GET(b, i);
-        i++;
-    }
+#define WORD_BITS 64
+#define WORDS_FOR(N) (((N) + WORD_BITS - 1) / WORD_BITS)
+
+static const char *list_item_end(const char *v) {
+    const char *nv = strchr(v, ',');   /* strchrnul() */
+    return nv ? nv : strchr(v, 0);     /* equivalent  */
+}
+
+cpubits *cpubits_new(int nbits) {
+    if (nbits < 1) nbits = 1;
+    if (nbits > CPUBITS_MAX) nbits = CPUBITS_MAX;
+    int nwords = WORDS_FOR(nbits);
+    cpubits *b = calloc(1, sizeof(cpubits) + nwords * sizeof(uint64_t));
+    if (b)
+        b->nwords = nwords;
+    return b;
+}
+
+cpubits *cpubits_dup(const cpubits *b) {
+    size_t sz = sizeof(cpubits) + b->nwords * sizeof(uint64_t);
+    cpubits *newbits = malloc(sz);
+    if (newbits)
+        memcpy(newbits, b, sz);
+    return newbits;
+}
+
+uint32_t cpubits_count(const cpubits *b) {
+    uint32_t count = 0;
+    for (int i = 0; i < b->nwords; i++)
+        count += __builtin_popcountll(b->w[i]);
     return count;
 }
 
-int cpubits_min(cpubits *b) {
-    int i = 0;
-    while (i < CPUBITS_SIZE * 8) {
-        if (CPUBIT_GET(b, i))
-            return i;
-        i++;
-    }
+int cpubits_min(const cpubits *b) {
+    for (int i = 0; i < b->nwords; i++)
+        if (b->w[i])
+            return i * WORD_BITS + __builtin_ctzll(b->w[i]);
     return -1;
 }
 
-int cpubits_max(cpubits *b) {
-    int i = CPUBITS_SIZE * 8 - 1;
-    while (i >= 0) {
-        if (CPUBIT_GET(b, i))
-            return i;
-        i--;
-    }
-    return i;
+int cpubits_max(const cpubits *b) {
+    for (int i = b->nwords - 1; i >= 0; i--)
+        if (b->w[i])
+            return i * WORD_BITS + (WORD_BITS - 1 - __builtin_clzll(b->w[i]));
+    return -1;
 }
 
-int cpubits_next(cpubits *b, int start, int end) {
+int cpubits_next(const cpubits *b, int start, int end) {
     start++; /* not including the start bit */
-    if (start >= 0) {
-        int i = start;
-        if (end == -1)
-            end = CPUBITS_SIZE * 8;
-        while (i < end) {
-            if (CPUBIT_GET(b, i))
-                return i;
-            i++;
+    if (start < 0 || start >= CPUBITS_NBITS(b))
+        return -1;
+    if (end == -1 || end > CPUBITS_NBITS(b))
+        end = CPUBITS_NBITS(b);
+    int i = start / WORD_BITS;
+    uint64_t w = b->w[i] & (~0ULL << (start % WORD_BITS));
+    while (1) {
+        if (w) {
+            int bit = i * WORD_BITS + __builtin_ctzll(w);
+            return (bit < end) ? bit : -1;
         }
+        if (++i >= b->nwords || i * WORD_BITS >= end)
+            return -1;
+        w = b->w[i];
     }
-    return -1;
 }
 
-cpubits *cpubits_from_str(char *str) {
-    char *v, *nv, *hy;
-    int r0, r1;
-    cpubits *newbits = malloc(CPUBITS_SIZE);
-    if (newbits) {
-        memset(newbits, 0, CPUBITS_SIZE);
-        if (str != NULL) {
-            v = (char*)str;
-            while ( *v != 0 ) {
-                nv = strchr(v, ',');                /* strchrnul() */
-                if (nv == NULL) nv = strchr(v, 0);  /* equivalent  */
-                hy = strchr(v, '-');
-                if (hy && hy < nv) {
-                    r0 = strtol(v, NULL, 0);
-                    r1 = strtol(hy + 1, NULL, 0);
-                } else {
-                    r0 = r1 = strtol(v, NULL, 0);
-                }
-                for (; r0 <= r1; r0++) {
-                    CPUBIT_SET(newbits, r0);
-                }
-                v = (*nv == ',') ? nv + 1 : nv;
-            }
+int cpubits_rank(const cpubits *b, int bit) {
+    int count = 0, i;
+    if (bit <= 0) return 0;
+    if (bit > CPUBITS_NBITS(b)) bit = CPUBITS_NBITS(b);
+    for (i = 0; i < bit / WORD_BITS; i++)
+        count += __builtin_popcountll(b->w[i]);
+    if (bit % WORD_BITS)
+        count += __builtin_popcountll(b->w[i] & ((1ULL << (bit % WORD_BITS)) - 1));
+    return count;
+}
+
+/* the compiler can vectorize these */
+cpubits *cpubits_and(const cpubits *a, const cpubits *b) {
+    const cpubits *big = (a->nwords >= b->nwords) ? a : b;
+    const cpubits *small = (big == a) ? b : a;
+    cpubits *r = cpubits_new(CPUBITS_NBITS(big));
+    if (r)
+        for (int i = 0; i < small->nwords; i++)
+            r->w[i] = a->w[i] & b->w[i];
+    return r;
+}
+
+cpubits *cpubits_or(const cpubits *a, const cpubits *b) {
+    const cpubits *big = (a->nwords >= b->nwords) ? a : b;
+    const cpubits *small = (big == a) ? b : a;
+    cpubits *r = cpubits_dup(big);
+    if (r)
+        for (int i = 0; i < small->nwords; i++)
+            r->w[i] |= small->w[i];
+    return r;
+}
+
+int cpubits_equal(const cpubits *a, const cpubits *b) {
+    const cpubits *big = (a->nwords >= b->nwords) ? a : b;
+    const cpubits *small = (big == a) ? b : a;
+    int i;
+    for (i = 0; i < small->nwords; i++)
+        if (a->w[i] != b->w[i])
+            return 0;
+    for (; i < big->nwords; i++)
+        if (big->w[i])
+            return 0;
+    return 1;
+}
+
+cpubits *cpubits_from_str(const char *str) {
+    const char *v, *nv, *hy;
+    int r0, r1, max = 0;
+
+    /* first pass for the size */
+    for (v = str; v && *v; v = (*nv == ',') ? nv + 1 : nv) {
+        nv = list_item_end(v);
+        hy = strchr(v, '-');
+        r1 = strtol((hy && hy < nv) ? hy + 1 : v, NULL, 0);
+        if (r1 > max) max = r1;
+    }
+
+    cpubits *newbits = cpubits_new(max + 1);
+    if (!newbits) return NULL;
+    for (v = str; v && *v; v = (*nv == ',') ? nv + 1 : nv) {
+        nv = list_item_end(v);
+        hy = strchr(v, '-');
+        if (hy && hy < nv) {
+            r0 = strtol(v, NULL, 0);
+            r1 = strtol(hy + 1, NULL, 0);
+        } else {
+            r0 = r1 = strtol(v, NULL, 0);
+        }
+        if (r0 < 0) r0 = 0;
+        if (r1 >= CPUBITS_NBITS(newbits)) r1 = CPUBITS_NBITS(newbits) - 1;
+        for (; r0 <= r1; r0++) {
+            /* whole words at a time where it can */
+            if (r0 % WORD_BITS == 0 && r1 - r0 >= WORD_BITS - 1) {
+                newbits->w[r0 / WORD_BITS] = ~0ULL;
+                r0 += WORD_BITS - 1;
+            } else
+                CPUBIT_SET(newbits, r0);
         }
     }
     return newbits;
 }
 
-char *cpubits_to_str(cpubits *bits, char *str, int max_len) {
-    static const uint32_t max = CPUBITS_SIZE * 8;
-    uint32_t i = 1, seq_start = 0, seq_last = 0, seq = 0, l = 0;
-    char buffer[65536] = "";
-    if (CPUBIT_GET(bits, 0)) {
-        seq = 1;
-        strcpy(buffer, "0");
+cpubits *cpubits_from_mask(const char *str) {
+    int digits = 0, bit = 0;
+    const char *p;
+    if (!str) return cpubits_new(1);
+    for (p = str; *p && *p != '\n'; p++)
+        if (isxdigit((unsigned char)*p)) digits++;
+    cpubits *newbits = cpubits_new(digits * 4);
+    if (!newbits) return NULL;
+    /* least significant last */
+    while (p > str && bit < CPUBITS_NBITS(newbits)) {
+        p--;
+        if (!isxdigit((unsigned char)*p)) continue;
+        uint64_t nib = (*p <= '9') ? *p - '0' : (*p | 0x20) - 'a' + 10;
+        newbits->w[bit / WORD_BITS] |= nib << (bit % WORD_BITS);
+        bit += 4;
     }
-    while (i < max) {
-        if (CPUBIT_GET(bits, i) ) {
-            seq_last = i;
-            if (!seq) {
-                seq = 1;
-                seq_start = i;
-                l = strlen(buffer);
-                sprintf(buffer + l, "%s%d", l ? "," : "", i);
-            }
-        } else {
-            if (seq && seq_last != seq_start) {
-                l = strlen(buffer);
-                sprintf(buffer + l, "-%d", seq_last);
-            }
-            seq = 0;
+    return newbits;
+}
+
+char *cpubits_to_str(const cpubits *bits, char *str, int max_len) {
+    size_t alloc = 64, l = 0;
+    char *buffer = malloc(alloc);
+    int r0, r1;
+    if (!buffer) return NULL;
+    *buffer = 0;
+
+    r0 = cpubits_min(bits);
+    while (r0 >= 0) {
+        /* end of the run, the first clear bit after r0 */
+        r1 = r0;
+        int i = r0 / WORD_BITS;
+        uint64_t w = ~bits->w[i] & (~0ULL << (r0 % WORD_BITS));
+        while (!w && ++i < bits->nwords)
+            w = ~bits->w[i];
+        r1 = (i < bits->nwords) ? i * WORD_BITS + __builtin_ctzll(w) - 1 : CPUBITS_NBITS(bits) - 1;
+
+        if (alloc - l < 32) {
+            alloc *= 2;
+            char *nb = realloc(buffer, alloc);
+            if (!nb) break;
+            buffer = nb;
         }
-        i++;
+        if (r1 != r0)
+            l += sprintf(buffer + l, "%s%d-%d", l ? "," : "", r0, r1);
+        else
+            l += sprintf(buffer + l, "%s%d", l ? "," : "", r0);
+        r0 = cpubits_next(bits, r1, -1);
     }
+
     if (str == NULL)
-        return strdup(buffer);
+        return buffer;
     else {
         strncpy(str, buffer, max_len);
+        free(buffer);
         return str;
     }
 }
@@ -61,25 +61,21 @@ gchar *fmt_opts_str(int fmt_opts) {
 #define CHECK_OBJ()  \
     if ( !(obj && obj->data.was_read && obj->data.str) ) \
         return simple_format(obj, fmt_opts);
+/* the value comes from sysobj_data_double(), parsed once per read,
+ * so the string is only copied when it is returned as-is */
 #define PREP_RAW() \
-    gchar *raw = g_strstrip(g_strdup(obj->data.str));    \
     if (fmt_opts & FMT_OPT_NO_UNIT                       \
         && (!fmt_opts & FMT_OPT_PART) )                  \
-        return raw;
+        return g_strstrip(g_strdup(obj->data.str));
 #define PREP_RAW_RJ(reject) \
-    gchar *raw = g_strstrip(g_strdup(obj->data.str));    \
-    if (fmt_opts & FMT_OPT_NO_UNIT                       \
-        && (!fmt_opts & FMT_OPT_PART) )                  \
-        return raw;                                      \
+    PREP_RAW();                                          \
     if (fmt_opts & reject)                               \
-        return raw;
-#define FINISH_RAW() g_free(raw);
+        return g_strstrip(g_strdup(obj->data.str));
 
 gchar *fmt_nanoseconds(sysobj *obj, int fmt_opts) {
     CHECK_OBJ();
     PREP_RAW();
-    double ns = strtod(raw, NULL);
-    FINISH_RAW();
+    double ns = sysobj_data_double(&obj->data);
     return fmt_opts & FMT_OPT_NO_UNIT
         ? g_strdup_printf("%.1lf", ns)
         : g_strdup_printf("%.1lf %s", ns, _("ns"));
@@ -88,9 +84,8 @@ gchar *fmt_nanoseconds(sysobj *obj, int fmt_opts) {
 gchar *fmt_khz_to_mhz(sysobj *obj, int fmt_opts) {
     CHECK_OBJ();
     PREP_RAW();
-    double mhz = strtod(raw, NULL);
+    double mhz = sysobj_data_double(&obj->data);
     mhz /= 1000; /* raw is khz */
-    FINISH_RAW();
     return fmt_opts & FMT_OPT_NO_UNIT
         ? g_strdup_printf("%.3f", mhz)
         : g_strdup_printf("%.3f %s", mhz, _("MHz"));
@@ -99,8 +94,7 @@ gchar *fmt_khz_to_mhz(sysobj *obj, int fmt_opts) {
 gchar *fmt_mhz(sysobj *obj, int fmt_opts) {
     CHECK_OBJ();
     PREP_RAW();
-    double mhz = strtod(raw, NULL);
-    FINISH_RAW();
+    double mhz = sysobj_data_double(&obj->data);
     return fmt_opts & FMT_OPT_NO_UNIT
         ? g_strdup_printf("%.3f", mhz)
         : g_strdup_printf("%.3f %s", mhz, _("MHz"));
@@ -109,17 +103,15 @@ gchar *fmt_mhz(sysobj *obj, int fmt_opts) {
 gchar *fmt_millidegree_c(sysobj *obj, int fmt_opts) {
     CHECK_OBJ();
     PREP_RAW();
-    double degc = strtod(raw, NULL);
+    double degc = sysobj_data_double(&obj->data);
     degc /= 1000;
-    FINISH_RAW();
     return g_strdup_printf("%.3lf %s", degc, _("\u00B0C") );
 }
 
 gchar *fmt_milliampere(sysobj *obj, int fmt_opts) {
     CHECK_OBJ();
     PREP_RAW();
-    double mA = strtod(raw, NULL);
-    FINISH_RAW();
+    double mA = sysobj_data_double(&obj->data);
     if (mA > 2000)
         return g_strdup_printf("%.3lf %s", (mA/1000), _("A") );
     else
@@ -129,25 +121,22 @@ gchar *fmt_milliampere(sysobj *obj, int fmt_opts) {
 gchar *fmt_microwatt(sysobj *obj, int fmt_opts) {
     CHECK_OBJ();
     PREP_RAW();
-    double mW = strtod(raw, NULL);
+    double mW = sysobj_data_double(&obj->data);
     mW /= 1000;
-    FINISH_RAW();
     return g_strdup_printf("%.3lf %s", mW, _("mW") );
 }
 
 gchar *fmt_milliwatt(sysobj *obj, int fmt_opts) {
     CHECK_OBJ();
     PREP_RAW();
-    double mW = strtod(raw, NULL);
-    FINISH_RAW();
+    double mW = sysobj_data_double(&obj->data);
     return g_strdup_printf("%.3lf %s", mW, _("mW") );
 }
 
 gchar *fmt_milliwatt_to_higher(sysobj *obj, int fmt_opts) {
     CHECK_OBJ();
     PREP_RAW();
-    double mW = strtod(raw, NULL);
-    FINISH_RAW();
+    double mW = sysobj_data_double(&obj->data);
 
     if (mW > (2000 * 1000 * 1000) )
         return no_unit_check_chomp(mW / (1000 * 1000 * 1000), _("MW"));
@@ -161,52 +150,46 @@ gchar *fmt_milliwatt_to_higher(sysobj *obj, int fmt_opts) {
 gchar *fmt_microseconds_to_milliseconds(sysobj *obj, int fmt_opts) {
     CHECK_OBJ();
     PREP_RAW();
-    double ms = strtod(raw, NULL);
+    double ms = sysobj_data_double(&obj->data);
     ms /= 1000;
-    FINISH_RAW();
     return g_strdup_printf("%.1lf %s", ms, _("ms") );
 }
 
 gchar *fmt_milliseconds(sysobj *obj, int fmt_opts) {
     CHECK_OBJ();
     PREP_RAW();
-    double ms = strtod(raw, NULL);
-    FINISH_RAW();
+    double ms = sysobj_data_double(&obj->data);
     return g_strdup_printf("%.1lf %s", ms, _("ms") );
 }
 
 gchar *fmt_microjoule(sysobj *obj, int fmt_opts) {
     CHECK_OBJ();
     PREP_RAW();
-    double mJ = strtod(raw, NULL);
+    double mJ = sysobj_data_double(&obj->data);
     mJ /= 1000;
-    FINISH_RAW();
     return g_strdup_printf("%.3lf %s", mJ, _("mJ") );
 }
 
 gchar *fmt_percent(sysobj *obj, int fmt_opts) {
     CHECK_OBJ();
     PREP_RAW();
-    double perc = strtod(raw, NULL);
-    FINISH_RAW();
+    double perc = sysobj_data_double(&obj->data);
     return g_strdup_printf("%.1lf%s", perc, _("%") );
 }
 
 gchar *fmt_millepercent(sysobj *obj, int fmt_opts) {
     CHECK_OBJ();
     PREP_RAW();
-    double perc = strtod(raw, NULL);
+    double perc = sysobj_data_double(&obj->data);
     perc /= 1000;
-    FINISH_RAW();
     return g_strdup_printf("%.3lf%s", perc, _("%") );
 }
 
 gchar *fmt_hz_to_mhz(sysobj *obj, int fmt_opts) {
     CHECK_OBJ();
     PREP_RAW();
-    double mhz = strtod(raw, NULL);
+    double mhz = sysobj_data_double(&obj->data);
     mhz /= 1000000;
-    FINISH_RAW();
     return fmt_opts & FMT_OPT_NO_UNIT
         ? g_strdup_printf("%.3f", mhz)
         : g_strdup_printf("%.3f %s", mhz, _("MHz"));
@@ -215,8 +198,7 @@ gchar *fmt_hz_to_mhz(sysobj *obj, int fmt_opts) {
 gchar *fmt_hz(sysobj *obj, int fmt_opts) {
     CHECK_OBJ();
     PREP_RAW();
-    double hz = strtod(raw, NULL);
-    FINISH_RAW();
+    double hz = sysobj_data_double(&obj->data);
     return fmt_opts & FMT_OPT_NO_UNIT
         ? g_strdup_printf("%.1f", hz)
         : g_strdup_printf("%.1f %s", hz, _("Hz"));
@@ -225,33 +207,29 @@ gchar *fmt_hz(sysobj *obj, int fmt_opts) {
 gchar *fmt_millivolt(sysobj *obj, int fmt_opts) {
     CHECK_OBJ();
     PREP_RAW();
-    double volt = strtod(raw, NULL);
+    double volt = sysobj_data_double(&obj->data);
     volt /= 1000;
-    FINISH_RAW();
     return g_strdup_printf("%.3lf %s", volt, _("V") );
 }
 
 gchar *fmt_rpm(sysobj *obj, int fmt_opts) {
     CHECK_OBJ();
     PREP_RAW();
-    double rpm = strtod(raw, NULL);
-    FINISH_RAW();
+    double rpm = sysobj_data_double(&obj->data);
     return g_strdup_printf("%.1lf %s", rpm, _("RPM") );
 }
 
 gchar *fmt_1yes0no(sysobj *obj, int fmt_opts) {
     CHECK_OBJ();
     PREP_RAW();
-    int value = strtod(raw, NULL);
-    FINISH_RAW();
+    int value = sysobj_data_double(&obj->data);
     return g_strdup_printf("[%d] %s", value, value ? _("Yes") : _("No") );
 }
 
 gchar *fmt_megabitspersecond(sysobj *obj, int fmt_opts) {
     CHECK_OBJ();
     PREP_RAW();
-    double mbps = strtod(raw, NULL);
-    FINISH_RAW();
+    double mbps = sysobj_data_double(&obj->data);
     return fmt_opts & FMT_OPT_NO_UNIT
         ? g_strdup_printf("%.1f", mbps)
         : g_strdup_printf("%.1f %s", mbps, _("Mbps"));
@@ -260,8 +238,7 @@ gchar *fmt_megabitspersecond(sysobj *obj, int fmt_opts) {
 gchar *fmt_bytes(sysobj *obj, int fmt_opts) {
     CHECK_OBJ();
     PREP_RAW();
-    double bytes = strtod(raw, NULL);
-    FINISH_RAW();
+    double bytes = sysobj_data_double(&obj->data);
     return
         util_strchomp_float(fmt_opts & FMT_OPT_NO_UNIT
         ? g_strdup_printf("%.1f", bytes)
@@ -277,8 +254,7 @@ gchar *fmt_bytes(sysobj *obj, int fmt_opts) {
 gchar *fmt_bytes_to_higher(sysobj *obj, int fmt_opts) {
     CHECK_OBJ();
     PREP_RAW();
-    double v = strtod(raw, NULL);
-    FINISH_RAW();
+    double v = sysobj_data_double(&obj->data);
 
     if (v > 2 * bytes_PiB)
         return no_unit_check_chomp(v / bytes_PiB, _("PiB"));
@@ -294,20 +270,33 @@ gchar *fmt_bytes_to_higher(sysobj *obj, int fmt_opts) {
     return no_unit_check_chomp(v, _("bytes"));
 }
 
+gchar *fmt_bytes_per_second(sysobj *obj, int fmt_opts) {
+    CHECK_OBJ();
+    PREP_RAW();
+    double v = sysobj_data_double(&obj->data);
+
+    if (v > 2 * bytes_GiB)
+        return no_unit_check_chomp(v / bytes_GiB, _("GiB/s"));
+    if (v > 2 * bytes_MiB)
+        return no_unit_check_chomp(v / bytes_MiB, _("MiB/s"));
+    if (v > 2 * bytes_KiB)
+        return no_unit_check_chomp(v / bytes_KiB, _("KiB/s"));
+
+    return no_unit_check_chomp(v, _("bytes/s"));
+}
+
 gchar *fmt_KiB(sysobj *obj, int fmt_opts) {
     CHECK_OBJ();
     PREP_RAW();
-    double v = strtod(raw, NULL);
-    FINISH_RAW();
+    double v = sysobj_data_double(&obj->data);
     return g_strdup_printf("%0.1f %s", v, _("KiB") );
 }
 
 gchar *fmt_KiB_to_MiB(sysobj *obj, int fmt_opts) {
     CHECK_OBJ();
     PREP_RAW();
-    double v = strtod(raw, NULL);
+    double v = sysobj_data_double(&obj->data);
     v *= bytes_KiB; /* v is KiB */
-    FINISH_RAW();
 
     if (v > 2 * bytes_MiB)
         return g_strdup_printf("%0.3f %s", v / bytes_MiB, _("MiB") );
@@ -318,9 +307,8 @@ gchar *fmt_KiB_to_MiB(sysobj *obj, int fmt_opts) {
 gchar *fmt_KiB_to_higher(sysobj *obj, int fmt_opts) {
     CHECK_OBJ();
     PREP_RAW();
-    double v = strtod(raw, NULL);
+    double v = sysobj_data_double(&obj->data);
     v *= bytes_KiB; /* v is KiB */
-    FINISH_RAW();
 
     if (v > 2 * bytes_PiB)
         return no_unit_check_chomp(v / bytes_PiB, _("PiB"));
@@ -337,8 +325,7 @@ gchar *fmt_KiB_to_higher(sysobj *obj, int fmt_opts) {
 gchar *fmt_megatransferspersecond(sysobj *obj, int fmt_opts) {
     CHECK_OBJ();
     PREP_RAW();
-    double mbps = strtod(raw, NULL);
-    FINISH_RAW();
+    double mbps = sysobj_data_double(&obj->data);
     return fmt_opts & FMT_OPT_NO_UNIT
         ? g_strdup_printf("%.1f", mbps)
         : g_strdup_printf("%.1f %s", mbps, _("MT/s"));
@@ -347,8 +334,7 @@ gchar *fmt_megatransferspersecond(sysobj *obj, int fmt_opts) {
 gchar *fmt_gigatransferspersecond(sysobj *obj, int fmt_opts) {
     CHECK_OBJ();
     PREP_RAW();
-    double mbps = strtod(raw, NULL);
-    FINISH_RAW();
+    double mbps = sysobj_data_double(&obj->data);
     return fmt_opts & FMT_OPT_NO_UNIT
         ? g_strdup_printf("%.1f", mbps)
         : g_strdup_printf("%.1f %s", mbps, _("GT/s"));
@@ -357,8 +343,7 @@ gchar *fmt_gigatransferspersecond(sysobj *obj, int fmt_opts) {
 gchar *fmt_lanes_x(sysobj *obj, int fmt_opts) {
     CHECK_OBJ();
     PREP_RAW();
-    double lanes = strtod(raw, NULL);
-    FINISH_RAW();
+    double lanes = sysobj_data_double(&obj->data);
     return util_strchomp_float(g_strdup_printf("x%.0lf", lanes));
 }
 
@@ -461,16 +446,14 @@ gchar *fmt_word_list_spaces(sysobj *obj, int fmt_opts) {
 gchar *fmt_seconds(sysobj *obj, int fmt_opts) {
     CHECK_OBJ();
     PREP_RAW();
-    double seconds = strtod(raw, NULL);
-    FINISH_RAW();
+    double seconds = sysobj_data_double(&obj->data);
     return g_strdup_printf("%.3lf %s", seconds, _("s"));
 }
 
 gchar *fmt_seconds_to_span(sysobj *obj, int fmt_opts) {
     CHECK_OBJ();
     PREP_RAW_RJ(FMT_OPT_NO_TRANSLATE);
-    double seconds = strtod(raw, NULL);
-    FINISH_RAW();
+    double seconds = sysobj_data_double(&obj->data);
     if (fmt_opts & FMT_OPT_PART
         || fmt_opts & FMT_OPT_SHORT)
         return formatted_time_span(seconds, TRUE, TRUE); /* short */
@@ -525,7 +508,7 @@ gchar *sysobj_format_table(sysobj *obj, gchar **table, int table_len, int nbase,
     FMT_OPTS_IGNORE(); //TODO:
 
     if (obj && obj->data.str && isxdigit(*(obj->data.str)) ) {
-        index = strtol(obj->data.str, NULL, nbase);
+        index = sysobj_data_int64(&obj->data, nbase);
         if (table_len) {
             if (index < table_len)
                 val = table[index];
@@ -832,6 +815,7 @@ STD_FORMAT_FUNC(fmt_1yes0no)
 STD_FORMAT_FUNC(fmt_megabitspersecond)
 STD_FORMAT_FUNC(fmt_bytes)
 STD_FORMAT_FUNC(fmt_bytes_to_higher)
+STD_FORMAT_FUNC(fmt_bytes_per_second)
 STD_FORMAT_FUNC(fmt_KiB)
 STD_FORMAT_FUNC(fmt_KiB_to_MiB)
 STD_FORMAT_FUNC(fmt_KiB_to_higher)
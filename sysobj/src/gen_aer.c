@@ -0,0 +1,424 @@
+/*
+ * sysobj - https://github.com/bp0/verbose-spork
+ * Copyright (C) 2018  Burt P. <pburt0@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+/* Generator for PCI Express AER error rates, from the aer_dev_* counters
+ * of every device in one sweep
+ *  :/pci/aer
+ *  :/pci/aer_hot
+ */
+#include "sysobj.h"
+#include "gg_file.h"
+#include "uevent.h"
+
+#define PCI_DEVICES "/sys/bus/pci/devices"
+#define AER_ROOT ":/pci/aer"
+#define AER_HOT ":/pci/aer_hot"
+#define AER_INTERVAL 1.0 /* seconds, the devices are read at most this often */
+#define AER_HOT_N 10
+
+/* the aer_dev_<file> "Key count" blobs, and the key of each one's total */
+enum { AER_COR, AER_NONFATAL, AER_FATAL, AER_TYPES };
+static const struct {
+    const gchar *file;
+    const gchar *name;
+    const gchar *total;
+} aer_types[] = {
+    { "aer_dev_correctable", "correctable", "TOTAL_ERR_COR" },
+    { "aer_dev_nonfatal", "nonfatal", "TOTAL_ERR_NONFATAL" },
+    { "aer_dev_fatal", "fatal", "TOTAL_ERR_FATAL" },
+};
+
+typedef struct {
+    gchar *key;  /* "RxErr", "BadTLP", ... */
+    guint64 prev;
+    double rate;
+} aer_counter;
+
+typedef struct {
+    gchar *fs;
+    GArray *counters; /* aer_counter, without the total */
+    guint64 prev_total;
+    double rate;
+} aer_blob;
+
+typedef struct {
+    gchar *slot; /* 0000:01:00.0 */
+    aer_blob blob[AER_TYPES];
+    double rate; /* all types */
+    gboolean present; /* was read in the last sample */
+} aer_dev;
+
+static struct {
+    GMutex lock;
+    gint64 last;
+    GPtrArray *devs;
+} aer;
+
+static gchar *aer_read(const gchar *path);
+
+static void aer_dev_free(aer_dev *d) {
+    for (int t = 0; t < AER_TYPES; t++) {
+        aer_blob *b = &d->blob[t];
+        for (guint i = 0; b->counters && i < b->counters->len; i++)
+            g_free(g_array_index(b->counters, aer_counter, i).key);
+        if (b->counters)
+            g_array_free(b->counters, TRUE);
+        g_free(b->fs);
+    }
+    g_free(d->slot);
+    g_free(d);
+}
+
+/* requires aer.lock */
+static aer_dev *aer_find(const gchar *slot) {
+    for (guint i = 0; aer.devs && i < aer.devs->len; i++) {
+        aer_dev *d = g_ptr_array_index(aer.devs, i);
+        if (SEQ(d->slot, slot)) return d;
+    }
+    return NULL;
+}
+
+/* one read of a blob, dt = 0 only keeps the counts.
+ * Returns FALSE if it couldn't be read. */
+static gboolean aer_blob_sample(aer_blob *b, int type, double dt) {
+    gchar *data = NULL;
+    gg_file_get_contents_non_blocking(b->fs, &data, NULL, NULL);
+    if (!data) return FALSE;
+
+    guint64 total = 0, sum = 0;
+    gboolean have_total = FALSE;
+    gchar *next = data;
+    while (next) {
+        gchar *line = next;
+        next = strchr(line, '\n');
+        if (next) *next++ = 0;
+        gchar *sp = strchr(line, ' ');
+        if (!sp) continue;
+        *sp = 0;
+        guint64 v = g_ascii_strtoull(sp + 1, NULL, 10);
+        if (SEQ(line, aer_types[type].total)) {
+            total = v;
+            have_total = TRUE;
+            continue;
+        }
+        sum += v;
+
+        aer_counter *c = NULL;
+        for (guint i = 0; i < b->counters->len && !c; i++)
+            if (SEQ(g_array_index(b->counters, aer_counter, i).key, line))
+                c = &g_array_index(b->counters, aer_counter, i);
+        if (!c) {
+            /* nothing to compare with until the next sample */
+            aer_counter nc = { g_strdup(line), v, 0 };
+            g_array_append_val(b->counters, nc);
+            continue;
+        }
+        if (dt > 0)
+            c->rate = util_counter_delta(v, c->prev) / dt;
+        c->prev = v;
+    }
+    g_free(data);
+
+    if (!have_total)
+        total = sum;
+    if (dt > 0)
+        b->rate = util_counter_delta(total, b->prev_total) / dt;
+    b->prev_total = total;
+    return TRUE;
+}
+
+/* every device in one sweep, the rates are from the previous
+ * sample, or since boot for the first. requires aer.lock */
+static void aer_sample_locked() {
+    double dt = util_sample_dt(&aer.last);
+
+    for (guint i = 0; i < aer.devs->len; i++) {
+        aer_dev *d = g_ptr_array_index(aer.devs, i);
+        d->present = TRUE;
+        d->rate = 0;
+        for (int t = 0; t < AER_TYPES; t++) {
+            if (aer_blob_sample(&d->blob[t], t, dt))
+                d->rate += d->blob[t].rate;
+            else
+                d->present = FALSE;
+        }
+    }
+}
+
+static void aer_update() {
+    g_mutex_lock(&aer.lock);
+    if (aer.devs
+        && (g_get_monotonic_time() - aer.last) >= AER_INTERVAL * G_USEC_PER_SEC)
+        aer_sample_locked();
+    g_mutex_unlock(&aer.lock);
+}
+
+static void aer_add_value(sysobj_virt_batch *b, const gchar *base, const gchar *name) {
+    sysobj_virt *vo = sysobj_virt_new();
+    vo->path = g_strdup_printf("%s/%s", base, name);
+    vo->type = VSO_TYPE_STRING;
+    vo->f_get_data = aer_read;
+    sysobj_virt_batch_add(b, vo);
+}
+
+/* only a device with all the aer_dev_* files, the first sample
+ * happens here, so each key is known. requires aer.lock */
+static void aer_dev_new(const gchar *slot, sysobj_virt_batch *b) {
+    if (aer_find(slot)) return;
+    gchar *dev_path = g_strdup_printf(PCI_DEVICES "/%s", slot);
+    sysobj *obj = sysobj_new_fast(dev_path);
+    aer_dev *d = g_new0(aer_dev, 1);
+    d->slot = g_strdup(slot);
+    for (int t = 0; t < AER_TYPES; t++) {
+        d->blob[t].fs = g_build_filename(obj->path_fs, aer_types[t].file, NULL);
+        d->blob[t].counters = g_array_new(FALSE, TRUE, sizeof(aer_counter));
+    }
+    for (int t = 0; t < AER_TYPES && d; t++)
+        if (!aer_blob_sample(&d->blob[t], t, 0) ) {
+            aer_dev_free(d);
+            d = NULL;
+        }
+
+    if (d) {
+        d->present = TRUE;
+        g_ptr_array_add(aer.devs, d);
+        gchar *base = g_strdup_printf(AER_ROOT "/%s", slot);
+        sysobj_virt_batch_add_simple(b, base, NULL, "*", VSO_TYPE_DIR);
+        sysobj_virt_batch_add_simple(b, base, "pci", dev_path, VSO_TYPE_SYMLINK | VSO_TYPE_AUTOLINK | VSO_TYPE_DYN);
+        aer_add_value(b, base, "errors_per_sec");
+        for (int t = 0; t < AER_TYPES; t++) {
+            /* also from the uevent thread, so no auto_free() */
+            gchar *rate = g_strdup_printf("%s_per_sec", aer_types[t].name);
+            aer_add_value(b, base, rate);
+            g_free(rate);
+            gchar *tbase = g_strdup_printf("%s/%s", base, aer_types[t].name);
+            sysobj_virt_batch_add_simple(b, tbase, NULL, "*", VSO_TYPE_DIR);
+            GArray *ca = d->blob[t].counters;
+            for (guint i = 0; i < ca->len; i++)
+                aer_add_value(b, tbase, g_array_index(ca, aer_counter, i).key);
+            g_free(tbase);
+        }
+        g_free(base);
+    }
+    sysobj_free(obj);
+    g_free(dev_path);
+}
+
+/* requires aer.lock */
+static gchar *aer_value(aer_dev *d, gchar **parts, int n) {
+    const gchar *field = parts[n - 1];
+    if (n == 2) {
+        if (SEQ(field, "errors_per_sec"))
+            return g_strdup_printf("%.1lf", d->rate);
+        for (int t = 0; t < AER_TYPES; t++)
+            if (g_str_has_prefix(field, aer_types[t].name)
+                && SEQ(field + strlen(aer_types[t].name), "_per_sec") )
+                return g_strdup_printf("%.1lf", d->blob[t].rate);
+    } else if (n == 3) {
+        for (int t = 0; t < AER_TYPES; t++) {
+            if (!SEQ(parts[1], aer_types[t].name)) continue;
+            GArray *ca = d->blob[t].counters;
+            for (guint i = 0; i < ca->len; i++) {
+                aer_counter *c = &g_array_index(ca, aer_counter, i);
+                if (SEQ(c->key, field))
+                    return g_strdup_printf("%.1lf", c->rate);
+            }
+        }
+    }
+    return NULL;
+}
+
+static gchar *aer_read(const gchar *path) {
+    if (!g_str_has_prefix(path, AER_ROOT "/"))
+        return NULL;
+    gchar *ret = NULL;
+    gchar **parts = g_strsplit(path + strlen(AER_ROOT "/"), "/", -1);
+    int n = g_strv_length(parts);
+    aer_update();
+    g_mutex_lock(&aer.lock);
+    aer_dev *d = (n >= 2) ? aer_find(parts[0]) : NULL;
+    if (d && d->present)
+        ret = aer_value(d, parts, n);
+    g_mutex_unlock(&aer.lock);
+    g_strfreev(parts);
+    return ret;
+}
+
+static gint aer_rate_cmp(gconstpointer a, gconstpointer b) {
+    const aer_dev *da = *(aer_dev**)a, *db = *(aer_dev**)b;
+    if (da->rate != db->rate)
+        return (da->rate < db->rate) ? 1 : -1;
+    return g_strcmp0(da->slot, db->slot);
+}
+
+/* "slot errors correctable nonfatal fatal" lines of
+ * errors per second, hottest first */
+static gchar *aer_hot_read(const gchar *path) {
+    gchar *ret = NULL;
+    aer_update();
+    g_mutex_lock(&aer.lock);
+    if (aer.devs) {
+        GPtrArray *hot = g_ptr_array_new();
+        for (guint i = 0; i < aer.devs->len; i++) {
+            aer_dev *d = g_ptr_array_index(aer.devs, i);
+            if (d->present && d->rate > 0)
+                g_ptr_array_add(hot, d);
+        }
+        g_ptr_array_sort(hot, aer_rate_cmp);
+        ret = g_strdup("");
+        for (guint i = 0; i < hot->len && i < AER_HOT_N; i++) {
+            aer_dev *d = g_ptr_array_index(hot, i);
+            ret = appfnl(ret, "%s %.1lf %.1lf %.1lf %.1lf", d->slot, d->rate,
+                d->blob[AER_COR].rate, d->blob[AER_NONFATAL].rate, d->blob[AER_FATAL].rate);
+        }
+        g_ptr_array_free(hot, TRUE);
+    }
+    g_mutex_unlock(&aer.lock);
+    return ret;
+}
+
+static void aer_remove(const gchar *slot) {
+    g_mutex_lock(&aer.lock);
+    aer_dev *d = aer_find(slot);
+    if (d)
+        g_ptr_array_remove(aer.devs, d);
+    g_mutex_unlock(&aer.lock);
+
+    gchar *glob = g_strdup_printf(AER_ROOT "/%s", slot);
+    sysobj_virt_remove(glob);
+    glob = appf(glob, "", "/*");
+    sysobj_virt_remove(glob);
+    g_free(glob);
+}
+
+/* requires aer.lock */
+static void aer_scan(sysobj *obj, sysobj_virt_batch *b) {
+    GSList *childs = sysobj_children(obj, NULL, NULL, TRUE);
+    for (GSList *l = childs; l; l = l->next)
+        aer_dev_new(l->data, b);
+    g_slist_free_full(childs, g_free);
+}
+
+/* events were lost, new devices and the ones that are gone */
+static void aer_rescan() {
+    sysobj *obj = sysobj_new_fast(PCI_DEVICES);
+    sysobj_virt_batch *b = sysobj_virt_batch_new(FALSE);
+    GSList *gone = NULL;
+    g_mutex_lock(&aer.lock);
+    if (aer.devs) {
+        aer_scan(obj, b);
+        for (guint i = 0; i < aer.devs->len; i++) {
+            aer_dev *d = g_ptr_array_index(aer.devs, i);
+            sysobj *dobj = sysobj_new_from_fn(obj->path, d->slot);
+            if (!dobj->exists)
+                gone = g_slist_prepend(gone, g_strdup(d->slot));
+            sysobj_free(dobj);
+        }
+    }
+    g_mutex_unlock(&aer.lock);
+    sysobj_virt_batch_commit(b);
+    sysobj_free(obj);
+
+    for (GSList *l = gone; l; l = l->next)
+        aer_remove(l->data);
+    g_slist_free_full(gone, g_free);
+}
+
+static void aer_uevent(const uevent *ev, gpointer user_data) {
+    if (uevent_is(ev, "rescan"))
+        aer_rescan();
+    else if (uevent_is(ev, "add")) {
+        sysobj_virt_batch *b = sysobj_virt_batch_new(FALSE);
+        g_mutex_lock(&aer.lock);
+        if (aer.devs)
+            aer_dev_new(ev->name, b);
+        g_mutex_unlock(&aer.lock);
+        sysobj_virt_batch_commit(b);
+    } else if (uevent_is(ev, "remove"))
+        aer_remove(ev->name);
+}
+
+static gchar *aer_root(const gchar *path) {
+    if (!path) {
+        /* cleanup */
+        g_mutex_lock(&aer.lock);
+        if (aer.devs)
+            g_ptr_array_free(aer.devs, TRUE);
+        aer.devs = NULL;
+        aer.last = 0;
+        g_mutex_unlock(&aer.lock);
+        return NULL;
+    }
+    return NULL; /* auto dir */
+}
+
+static sysobj_virt vol[] = {
+    { .path = AER_ROOT, .str = "*",
+      .f_get_data = aer_root,
+      .type = VSO_TYPE_DIR | VSO_TYPE_CONST | VSO_TYPE_CLEANUP },
+};
+
+static sysobj_virt vol_hot[] = {
+    { .path = AER_HOT, .str = "",
+      .f_get_data = aer_hot_read,
+      .type = VSO_TYPE_STRING | VSO_TYPE_CONST },
+};
+
+void gen_aer() {
+    sysobj *obj = sysobj_new_fast(PCI_DEVICES);
+    if (!obj->exists) {
+        sysobj_free(obj);
+        return;
+    }
+
+    for (int i = 0; i < (int)G_N_ELEMENTS(vol); i++)
+        sysobj_virt_add(&vol[i]);
+
+    sysobj_virt_batch *b = sysobj_virt_batch_new(FALSE);
+    g_mutex_lock(&aer.lock);
+    aer.devs = g_ptr_array_new_with_free_func((GDestroyNotify)aer_dev_free);
+    aer_scan(obj, b);
+    /* the first sample is since boot, the counts were kept as found */
+    for (guint i = 0; i < aer.devs->len; i++) {
+        aer_dev *d = g_ptr_array_index(aer.devs, i);
+        for (int t = 0; t < AER_TYPES; t++) {
+            aer_blob *ab = &d->blob[t];
+            ab->prev_total = 0;
+            for (guint j = 0; j < ab->counters->len; j++)
+                g_array_index(ab->counters, aer_counter, j).prev = 0;
+        }
+    }
+    aer_sample_locked();
+    g_mutex_unlock(&aer.lock);
+    sysobj_virt_batch_commit(b);
+    sysobj_free(obj);
+
+    uevent_handler_add("pci", aer_uevent, NULL);
+}
+
+/* its own lazy root, it needs the sampler */
+void gen_aer_hot() {
+    g_mutex_lock(&aer.lock);
+    gboolean have = (aer.devs != NULL);
+    g_mutex_unlock(&aer.lock);
+    if (have)
+        for (int i = 0; i < (int)G_N_ELEMENTS(vol_hot); i++)
+            sysobj_virt_add(&vol_hot[i]);
+}
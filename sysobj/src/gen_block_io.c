@@ -0,0 +1,278 @@
+/*
+ * sysobj - https://github.com/bp0/verbose-spork
+ * Copyright (C) 2018  Burt P. <pburt0@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+/* Generator for block device I/O rates from /sys/block/<dev>/stat
+ *  :/block_io
+ */
+#include "sysobj.h"
+#include "gg_file.h"
+#include "uevent.h"
+
+#define BLOCK_IO_ROOT ":/block_io"
+#define BLOCK_IO_INTERVAL 0.5 /* seconds, same as class_block's stat */
+#define SECTOR_SIZE 512       /* stat is always in 512-byte sectors */
+
+/* https://www.kernel.org/doc/Documentation/block/stat.txt */
+enum {
+    ST_READ_IOS, ST_READ_MERGES, ST_READ_SECTORS, ST_READ_TICKS,
+    ST_WRITE_IOS, ST_WRITE_MERGES, ST_WRITE_SECTORS, ST_WRITE_TICKS,
+    ST_IN_FLIGHT, ST_IO_TICKS, ST_TIME_IN_QUEUE,
+    ST_DISCARD_IOS, ST_DISCARD_MERGES, ST_DISCARD_SECTORS, ST_DISCARD_TICKS,
+    ST_FLUSH_IOS, ST_FLUSH_TICKS,
+    ST_FIELDS
+};
+/* the kernel prints the ms counters as unsigned int, so they wrap */
+#define ST_IS_TICKS(i) ((i) == ST_READ_TICKS || (i) == ST_WRITE_TICKS \
+    || (i) == ST_IO_TICKS || (i) == ST_TIME_IN_QUEUE \
+    || (i) == ST_DISCARD_TICKS || (i) == ST_FLUSH_TICKS)
+
+enum {
+    BIO_IOPS, BIO_READ_IOPS, BIO_WRITE_IOPS,
+    BIO_READ_BPS, BIO_WRITE_BPS,
+    BIO_READ_AWAIT, BIO_WRITE_AWAIT, BIO_AWAIT,
+    BIO_IN_FLIGHT, BIO_QUEUE_DEPTH, BIO_UTIL,
+    BIO_FIELDS
+};
+static const gchar *bio_names[] = {
+    "iops", "read_iops", "write_iops",
+    "read_bytes_per_sec", "write_bytes_per_sec",
+    "read_await", "write_await", "await",
+    "in_flight", "queue_depth", "util",
+};
+
+typedef struct {
+    gchar *name;
+    gchar *stat_fs;
+    guint64 prev[ST_FIELDS];
+    gint64 t_prev; /* monotonic usec */
+    double rate[BIO_FIELDS];
+} block_io;
+
+static struct {
+    GMutex lock;
+    GHashTable *devs; /* name -> block_io */
+} bio;
+
+static gchar *block_io_read(const gchar *path);
+
+static void block_io_free(block_io *b) {
+    g_free(b->name);
+    g_free(b->stat_fs);
+    g_free(b);
+}
+
+static gboolean block_io_stat(block_io *b, guint64 *v) {
+    gchar *data = NULL;
+    gg_file_get_contents_non_blocking(b->stat_fs, &data, NULL, NULL);
+    if (!data) return FALSE;
+    const gchar *p = data;
+    for (int i = 0; i < ST_FIELDS; i++) {
+        gchar *end = NULL;
+        v[i] = g_ascii_strtoull(p, &end, 10);
+        if (end == p) break; /* older kernels have fewer */
+        p = end;
+    }
+    g_free(data);
+    return TRUE;
+}
+
+/* rates from the previous sample, or since boot for the first,
+ * requires bio.lock. FALSE if the device is gone. */
+static gboolean block_io_sample(block_io *b) {
+    guint64 v[ST_FIELDS] = {}, d[ST_FIELDS];
+    if (!block_io_stat(b, v))
+        return FALSE;
+
+    double dt = util_sample_dt(&b->t_prev);
+    for (int i = 0; i < ST_FIELDS; i++) {
+        if (i == ST_IN_FLIGHT)
+            d[i] = v[i];
+        else if (ST_IS_TICKS(i))
+            d[i] = util_counter32_delta(v[i], b->prev[i]);
+        else
+            d[i] = util_counter_delta(v[i], b->prev[i]);
+    }
+    memcpy(b->prev, v, sizeof(v));
+
+    b->rate[BIO_IN_FLIGHT] = v[ST_IN_FLIGHT];
+    if (dt <= 0)
+        return TRUE;
+
+    double *r = b->rate;
+    guint64 ios = d[ST_READ_IOS] + d[ST_WRITE_IOS];
+    r[BIO_READ_IOPS] = d[ST_READ_IOS] / dt;
+    r[BIO_WRITE_IOPS] = d[ST_WRITE_IOS] / dt;
+    r[BIO_IOPS] = (ios + d[ST_DISCARD_IOS]) / dt;
+    r[BIO_READ_BPS] = d[ST_READ_SECTORS] * SECTOR_SIZE / dt;
+    r[BIO_WRITE_BPS] = d[ST_WRITE_SECTORS] * SECTOR_SIZE / dt;
+    /* ticks are ms */
+    r[BIO_READ_AWAIT] = d[ST_READ_IOS] ? (double)d[ST_READ_TICKS] / d[ST_READ_IOS] : 0;
+    r[BIO_WRITE_AWAIT] = d[ST_WRITE_IOS] ? (double)d[ST_WRITE_TICKS] / d[ST_WRITE_IOS] : 0;
+    r[BIO_AWAIT] = ios ? (double)(d[ST_READ_TICKS] + d[ST_WRITE_TICKS]) / ios : 0;
+    r[BIO_QUEUE_DEPTH] = d[ST_TIME_IN_QUEUE] / (dt * 1000);
+    r[BIO_UTIL] = MIN(100.0, d[ST_IO_TICKS] / (dt * 10) );
+    return TRUE;
+}
+
+/* requires bio.lock */
+static block_io *block_io_new(const gchar *name) {
+    gchar *stat_path = g_strdup_printf("/sys/block/%s/stat", name);
+    sysobj *obj = sysobj_new_fast(stat_path);
+    block_io *b = NULL;
+    if (obj->exists) {
+        b = g_new0(block_io, 1);
+        b->name = g_strdup(name);
+        b->stat_fs = g_strdup(obj->path_fs);
+        block_io_sample(b);
+        g_hash_table_insert(bio.devs, b->name, b);
+    }
+    sysobj_free(obj);
+    g_free(stat_path);
+    return b;
+}
+
+static void block_io_add_nodes(const gchar *name) {
+    sysobj_virt_batch *b = sysobj_virt_batch_new(FALSE);
+    gchar *base = g_strdup_printf(BLOCK_IO_ROOT "/%s", name);
+    gchar *blk_path = g_strdup_printf("/sys/block/%s", name);
+    sysobj_virt_batch_add_simple(b, base, NULL, "*", VSO_TYPE_DIR);
+    sysobj_virt_batch_add_simple(b, base, "block", blk_path, VSO_TYPE_SYMLINK | VSO_TYPE_AUTOLINK | VSO_TYPE_DYN);
+    for (int i = 0; i < BIO_FIELDS; i++) {
+        sysobj_virt *vo = sysobj_virt_new();
+        vo->path = g_strdup_printf("%s/%s", base, bio_names[i]);
+        vo->type = VSO_TYPE_STRING;
+        vo->f_get_data = block_io_read;
+        sysobj_virt_batch_add(b, vo);
+    }
+    sysobj_virt_batch_commit(b);
+    g_free(blk_path);
+    g_free(base);
+}
+
+static void block_io_remove(const gchar *name) {
+    g_mutex_lock(&bio.lock);
+    if (bio.devs)
+        g_hash_table_remove(bio.devs, name);
+    g_mutex_unlock(&bio.lock);
+
+    gchar *glob = g_strdup_printf(BLOCK_IO_ROOT "/%s", name);
+    sysobj_virt_remove(glob);
+    glob = appf(glob, "", "/*");
+    sysobj_virt_remove(glob);
+    g_free(glob);
+}
+
+static gchar *block_io_read(const gchar *path) {
+    gchar *ret = NULL;
+    gchar *field = g_path_get_basename(path);
+    gchar *dev_path = g_path_get_dirname(path);
+    gchar *dev = g_path_get_basename(dev_path);
+    gboolean gone = FALSE;
+
+    g_mutex_lock(&bio.lock);
+    block_io *b = bio.devs ? g_hash_table_lookup(bio.devs, dev) : NULL;
+    if (b) {
+        if (g_get_monotonic_time() - b->t_prev >= BLOCK_IO_INTERVAL * G_USEC_PER_SEC)
+            gone = !block_io_sample(b);
+        /* removed without a uevent, the nodes stay until
+         * one comes, as this one is in use */
+        if (gone)
+            g_hash_table_remove(bio.devs, dev);
+        for (int i = 0; !gone && i < BIO_FIELDS; i++)
+            if (SEQ(field, bio_names[i]) ) {
+                ret = g_strdup_printf("%.1lf", b->rate[i]);
+                break;
+            }
+    }
+    g_mutex_unlock(&bio.lock);
+
+    g_free(field);
+    g_free(dev_path);
+    g_free(dev);
+    return ret;
+}
+
+/* the ones not already known, the gone ones go on their next read */
+static void block_io_scan() {
+    GSList *added = NULL;
+    g_mutex_lock(&bio.lock);
+    sysobj *blist = sysobj_new_fast("/sys/block");
+    GSList *childs = sysobj_children(blist, NULL, NULL, TRUE);
+    for (GSList *l = childs; bio.devs && l; l = l->next)
+        if (!g_hash_table_contains(bio.devs, l->data) && block_io_new(l->data))
+            added = g_slist_prepend(added, l->data);
+    g_mutex_unlock(&bio.lock);
+    sysobj_free(blist);
+
+    for (GSList *l = added; l; l = l->next)
+        block_io_add_nodes(l->data);
+    g_slist_free(added);
+    g_slist_free_full(childs, g_free);
+}
+
+static void block_io_uevent(const uevent *ev, gpointer user_data) {
+    if (uevent_is(ev, "rescan")) {
+        block_io_scan();
+        return;
+    }
+    if (!SEQ(ev->devtype, "disk"))
+        return; /* only what is in /sys/block */
+
+    if (uevent_is(ev, "add")) {
+        g_mutex_lock(&bio.lock);
+        block_io *b = bio.devs && !g_hash_table_contains(bio.devs, ev->name)
+            ? block_io_new(ev->name) : NULL;
+        g_mutex_unlock(&bio.lock);
+        if (b)
+            block_io_add_nodes(ev->name);
+    } else if (uevent_is(ev, "remove"))
+        block_io_remove(ev->name);
+}
+
+static gchar *block_io_root(const gchar *path) {
+    if (!path) {
+        /* cleanup */
+        g_mutex_lock(&bio.lock);
+        if (bio.devs)
+            g_hash_table_destroy(bio.devs);
+        bio.devs = NULL;
+        g_mutex_unlock(&bio.lock);
+        return NULL;
+    }
+    return NULL; /* auto dir */
+}
+
+static sysobj_virt vol[] = {
+    { .path = BLOCK_IO_ROOT, .str = "*",
+      .f_get_data = block_io_root,
+      .type = VSO_TYPE_DIR | VSO_TYPE_CONST | VSO_TYPE_CLEANUP },
+};
+
+void gen_block_io() {
+    for (int i = 0; i < (int)G_N_ELEMENTS(vol); i++)
+        sysobj_virt_add(&vol[i]);
+
+    g_mutex_lock(&bio.lock);
+    bio.devs = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, (GDestroyNotify)block_io_free);
+    g_mutex_unlock(&bio.lock);
+    block_io_scan();
+
+    uevent_handler_add("block", block_io_uevent, NULL);
+}
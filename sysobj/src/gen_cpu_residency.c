@@ -0,0 +1,540 @@
+/*
+ * sysobj - https://github.com/bp0/verbose-spork
+ * Copyright (C) 2018  Burt P. <pburt0@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+/* Generator for idle state and frequency residency over an interval,
+ * from the cumulative cpuidle and cpufreq stats counters
+ *  :/cpu/residency
+ */
+#include "sysobj.h"
+#include "gg_file.h"
+#include "cpubits.h"
+#include "uevent.h"
+
+#define CPU_ROOT "/sys/devices/system/cpu"
+#define RES_ROOT ":/cpu/residency"
+#define RES_INTERVAL 1.0 /* seconds, every counter is read at most this often */
+
+typedef struct {
+    gchar *time_fs;  /* us */
+    gchar *usage_fs;
+    guint64 time, usage;
+    double residency; /* percent of the interval */
+    double entries_per_sec;
+} res_state;
+
+typedef struct {
+    int id;
+    int package;
+    int nstates;
+    res_state *states;
+    double idle; /* all states */
+    double entries_per_sec;
+    gboolean online; /* was read in the last sample */
+} res_cpu;
+
+typedef struct {
+    int id;
+    gchar *tis_fs;   /* stats/time_in_state */
+    gchar *trans_fs; /* stats/total_trans */
+    cpubits *cpus;
+    int nfreqs;
+    guint64 *freq;   /* kHz */
+    guint64 *time;   /* 10ms */
+    double *residency;
+    guint64 trans;
+    double avg_freq;
+    double trans_per_sec;
+    double idle;     /* average of its cpus */
+} res_policy;
+
+typedef struct {
+    int id;
+    double idle;
+    double avg_freq;
+} res_package;
+
+static struct {
+    GMutex lock;
+    gint64 last;
+    GPtrArray *cpus;
+    GPtrArray *policies;
+    GPtrArray *packages;
+} res;
+
+static gchar *res_read(const gchar *path);
+
+static void res_cpu_free(res_cpu *c) {
+    for (int i = 0; i < c->nstates; i++) {
+        g_free(c->states[i].time_fs);
+        g_free(c->states[i].usage_fs);
+    }
+    g_free(c->states);
+    g_free(c);
+}
+
+static void res_policy_free(res_policy *p) {
+    g_free(p->tis_fs);
+    g_free(p->trans_fs);
+    free(p->cpus);
+    g_free(p->freq);
+    g_free(p->time);
+    g_free(p->residency);
+    g_free(p);
+}
+
+static gboolean res_read_u64(const gchar *fs, guint64 *v) {
+    gchar *data = NULL;
+    gg_file_get_contents_non_blocking(fs, &data, NULL, NULL);
+    if (!data) return FALSE;
+    *v = g_ascii_strtoull(data, NULL, 10);
+    g_free(data);
+    return TRUE;
+}
+
+static void *res_find(GPtrArray *a, int id) {
+    /* id is the first member of each */
+    for (guint i = 0; a && i < a->len; i++)
+        if (*(int*)g_ptr_array_index(a, i) == id)
+            return g_ptr_array_index(a, i);
+    return NULL;
+}
+
+static void res_sample_cpu(res_cpu *c, double dt) {
+    c->online = FALSE;
+    double idle = 0, entries = 0;
+    for (int i = 0; i < c->nstates; i++) {
+        res_state *s = &c->states[i];
+        guint64 t, u;
+        if (!res_read_u64(s->time_fs, &t) || !res_read_u64(s->usage_fs, &u))
+            return; /* offline */
+        if (dt > 0) {
+            s->residency = MIN(100.0, util_counter_delta(t, s->time) / (dt * 10000) );
+            s->entries_per_sec = util_counter_delta(u, s->usage) / dt;
+        }
+        s->time = t;
+        s->usage = u;
+        idle += s->residency;
+        entries += s->entries_per_sec;
+    }
+    c->idle = MIN(100.0, idle);
+    c->entries_per_sec = entries;
+    c->online = TRUE;
+}
+
+static void res_sample_policy(res_policy *p, double dt) {
+    gchar *data = NULL;
+    gg_file_get_contents_non_blocking(p->tis_fs, &data, NULL, NULL);
+    if (data) {
+        int n = util_count_lines(data);
+        guint64 *freq = g_new0(guint64, n + 1);
+        guint64 *time = g_new0(guint64, n + 1);
+        int nf = 0;
+        gchar *l = data;
+        while (l && *l && nf < n) {
+            gchar *end = NULL;
+            freq[nf] = g_ascii_strtoull(l, &end, 10);
+            if (end != l) {
+                time[nf] = g_ascii_strtoull(end, NULL, 10);
+                nf++;
+            }
+            l = strchr(l, '\n');
+            if (l) l++;
+        }
+        g_free(data);
+
+        gboolean first = !p->freq;
+        if (nf != p->nfreqs || (nf && memcmp(freq, p->freq, nf * sizeof(guint64)) ) ) {
+            g_free(p->freq);
+            g_free(p->time);
+            g_free(p->residency);
+            p->nfreqs = nf;
+            p->freq = freq;
+            p->time = g_new0(guint64, nf + 1);
+            p->residency = g_new0(double, nf + 1);
+            p->avg_freq = 0;
+            freq = NULL;
+            /* the table changed, like boost was toggled, start over;
+             * or the first, which is since boot */
+            if (!first)
+                memcpy(p->time, time, nf * sizeof(guint64));
+        }
+
+        guint64 total = 0;
+        double fsum = 0;
+        for (int i = 0; i < nf; i++) {
+            guint64 d = util_counter_delta(time[i], p->time[i]);
+            total += d;
+            fsum += (double)d * p->freq[i];
+        }
+        for (int i = 0; total && i < nf; i++)
+            p->residency[i] = 100.0 * util_counter_delta(time[i], p->time[i]) / total;
+        if (total)
+            p->avg_freq = fsum / total;
+        memcpy(p->time, time, nf * sizeof(guint64));
+        g_free(freq);
+        g_free(time);
+    }
+
+    guint64 trans;
+    if (res_read_u64(p->trans_fs, &trans)) {
+        if (dt > 0)
+            p->trans_per_sec = util_counter32_delta(trans, p->trans) / dt;
+        p->trans = trans;
+    }
+}
+
+/* every cpu's idle states and every policy's time_in_state,
+ * in one pass, and then the aggregates. requires res.lock */
+static void res_sample_locked() {
+    double dt = util_sample_dt(&res.last);
+
+    for (guint i = 0; i < res.cpus->len; i++)
+        res_sample_cpu(g_ptr_array_index(res.cpus, i), dt);
+
+    for (guint i = 0; i < res.policies->len; i++) {
+        res_policy *p = g_ptr_array_index(res.policies, i);
+        res_sample_policy(p, dt);
+        double idle = 0;
+        int n = 0;
+        for (int c = cpubits_min(p->cpus); c >= 0; c = cpubits_next(p->cpus, c, -1)) {
+            res_cpu *rc = res_find(res.cpus, c);
+            if (rc && rc->online) {
+                idle += rc->idle;
+                n++;
+            }
+        }
+        p->idle = n ? idle / n : 0;
+    }
+
+    for (guint i = 0; i < res.packages->len; i++) {
+        res_package *pk = g_ptr_array_index(res.packages, i);
+        double idle = 0, freq = 0;
+        int n = 0, nf = 0;
+        for (guint j = 0; j < res.cpus->len; j++) {
+            res_cpu *rc = g_ptr_array_index(res.cpus, j);
+            if (rc->package != pk->id || !rc->online) continue;
+            idle += rc->idle;
+            n++;
+            for (guint k = 0; k < res.policies->len; k++) {
+                res_policy *p = g_ptr_array_index(res.policies, k);
+                if (CPUBIT_GET(p->cpus, rc->id) && p->avg_freq > 0) {
+                    freq += p->avg_freq;
+                    nf++;
+                    break;
+                }
+            }
+        }
+        pk->idle = n ? idle / n : 0;
+        pk->avg_freq = nf ? freq / nf : 0;
+    }
+}
+
+static void res_update() {
+    g_mutex_lock(&res.lock);
+    if (res.cpus
+        && (g_get_monotonic_time() - res.last) >= RES_INTERVAL * G_USEC_PER_SEC)
+        res_sample_locked();
+    g_mutex_unlock(&res.lock);
+}
+
+static void res_add_value(sysobj_virt_batch *b, const gchar *base, const gchar *name) {
+    sysobj_virt *vo = sysobj_virt_new();
+    vo->path = g_strdup_printf("%s/%s", base, name);
+    vo->type = VSO_TYPE_STRING;
+    vo->f_get_data = res_read;
+    sysobj_virt_batch_add(b, vo);
+}
+
+/* NULL if it has no cpuidle, requires res.lock */
+static res_cpu *res_cpu_new(int id, sysobj_virt_batch *b) {
+    gchar *idle_path = g_strdup_printf(CPU_ROOT "/cpu%d/cpuidle", id);
+    sysobj *obj = sysobj_new_fast(idle_path);
+    GSList *childs = obj->exists ? sysobj_children(obj, "state*", NULL, TRUE) : NULL;
+    res_cpu *c = NULL;
+    if (childs) {
+        c = g_new0(res_cpu, 1);
+        c->id = id;
+        /* also from the uevent thread, so no auto_free() */
+        gchar *pkg_fn = g_strdup_printf("cpu%d/topology/physical_package_id", id);
+        gchar *pkg = sysobj_raw_from_fn(CPU_ROOT, pkg_fn);
+        c->package = pkg ? atoi(pkg) : 0;
+        g_free(pkg);
+        g_free(pkg_fn);
+        c->nstates = g_slist_length(childs);
+        c->states = g_new0(res_state, c->nstates);
+
+        gchar *base = g_strdup_printf(RES_ROOT "/cpu%d", id);
+        gchar *cpu_path = g_strdup_printf(CPU_ROOT "/cpu%d", id);
+        sysobj_virt_batch_add_simple(b, base, NULL, "*", VSO_TYPE_DIR);
+        sysobj_virt_batch_add_simple(b, base, "cpu", cpu_path, VSO_TYPE_SYMLINK | VSO_TYPE_AUTOLINK | VSO_TYPE_DYN);
+        g_free(cpu_path);
+        res_add_value(b, base, "idle");
+        res_add_value(b, base, "idle_entries_per_sec");
+
+        int i = 0;
+        for (GSList *l = childs; l; l = l->next, i++) {
+            res_state *s = &c->states[i];
+            s->time_fs = g_strdup_printf("%s/%s/time", obj->path_fs, (gchar*)l->data);
+            s->usage_fs = g_strdup_printf("%s/%s/usage", obj->path_fs, (gchar*)l->data);
+            gchar *sbase = g_strdup_printf("%s/state%d", base, i);
+            gchar *name_fn = g_strdup_printf("%s/name", (gchar*)l->data);
+            gchar *name = sysobj_raw_from_fn(idle_path, name_fn);
+            g_free(name_fn);
+            sysobj_virt_batch_add_simple(b, sbase, NULL, "*", VSO_TYPE_DIR);
+            sysobj_virt_batch_add_simple(b, sbase, "name", name ? g_strstrip(name) : "", VSO_TYPE_STRING);
+            res_add_value(b, sbase, "residency");
+            res_add_value(b, sbase, "entries_per_sec");
+            g_free(name);
+            g_free(sbase);
+        }
+        g_free(base);
+        g_ptr_array_add(res.cpus, c);
+
+        if (!res_find(res.packages, c->package)) {
+            res_package *pk = g_new0(res_package, 1);
+            pk->id = c->package;
+            g_ptr_array_add(res.packages, pk);
+            gchar *pbase = g_strdup_printf(RES_ROOT "/package%d", pk->id);
+            sysobj_virt_batch_add_simple(b, pbase, NULL, "*", VSO_TYPE_DIR);
+            res_add_value(b, pbase, "cpus");
+            res_add_value(b, pbase, "idle");
+            res_add_value(b, pbase, "avg_freq");
+            g_free(pbase);
+        }
+    }
+    g_slist_free_full(childs, g_free);
+    sysobj_free(obj);
+    g_free(idle_path);
+    return c;
+}
+
+/* requires res.lock */
+static void res_policy_new(const gchar *name, sysobj_virt_batch *b) {
+    int id = util_get_did((gchar*)name, "policy");
+    if (id < 0) return;
+    gchar *pol_path = g_strdup_printf(CPU_ROOT "/cpufreq/%s", name);
+    gchar *tis_path = g_strdup_printf("%s/stats/time_in_state", pol_path);
+    sysobj *obj = sysobj_new_fast(tis_path);
+    if (obj->exists) {
+        res_policy *p = g_new0(res_policy, 1);
+        p->id = id;
+        gchar *stats_fs = g_path_get_dirname(obj->path_fs);
+        p->tis_fs = g_strdup(obj->path_fs);
+        p->trans_fs = g_build_filename(stats_fs, "total_trans", NULL);
+        g_free(stats_fs);
+        gchar *list = sysobj_raw_from_fn(pol_path, "related_cpus");
+        /* related_cpus is space-separated */
+        if (list) g_strdelimit(g_strstrip(list), " ", ',');
+        p->cpus = cpubits_from_str(list ? list : "");
+        g_free(list);
+        g_ptr_array_add(res.policies, p);
+
+        gchar *base = g_strdup_printf(RES_ROOT "/policy%d", id);
+        sysobj_virt_batch_add_simple(b, base, NULL, "*", VSO_TYPE_DIR);
+        sysobj_virt_batch_add_simple(b, base, "policy", pol_path, VSO_TYPE_SYMLINK | VSO_TYPE_AUTOLINK | VSO_TYPE_DYN);
+        res_add_value(b, base, "cpus");
+        res_add_value(b, base, "time_in_state");
+        res_add_value(b, base, "avg_freq");
+        res_add_value(b, base, "transitions_per_sec");
+        res_add_value(b, base, "idle");
+        g_free(base);
+    }
+    sysobj_free(obj);
+    g_free(tis_path);
+    g_free(pol_path);
+}
+
+static gchar *res_cpus_str(const cpubits *b) {
+    char *s = cpubits_to_str(b, NULL, 0);
+    gchar *ret = g_strdup(s);
+    free(s);
+    return ret;
+}
+
+/* requires res.lock */
+static gchar *res_read_locked(gchar **parts) {
+    int n = g_strv_length(parts);
+    if (n < 2) return NULL;
+    const gchar *field = parts[n - 1];
+    int id;
+
+    if ( (id = util_get_did(parts[0], "cpu")) >= 0) {
+        res_cpu *c = res_find(res.cpus, id);
+        if (!c || !c->online) return NULL;
+        if (n == 2 && SEQ(field, "idle"))
+            return g_strdup_printf("%.1lf", c->idle);
+        if (n == 2 && SEQ(field, "idle_entries_per_sec"))
+            return g_strdup_printf("%.1lf", c->entries_per_sec);
+        int si = util_get_did(parts[1], "state");
+        if (n == 3 && si >= 0 && si < c->nstates) {
+            if (SEQ(field, "residency"))
+                return g_strdup_printf("%.1lf", c->states[si].residency);
+            if (SEQ(field, "entries_per_sec"))
+                return g_strdup_printf("%.1lf", c->states[si].entries_per_sec);
+        }
+    } else if ( (id = util_get_did(parts[0], "policy")) >= 0) {
+        res_policy *p = res_find(res.policies, id);
+        if (!p) return NULL;
+        if (SEQ(field, "cpus"))
+            return res_cpus_str(p->cpus);
+        if (SEQ(field, "avg_freq"))
+            return g_strdup_printf("%.0lf", p->avg_freq);
+        if (SEQ(field, "transitions_per_sec"))
+            return g_strdup_printf("%.1lf", p->trans_per_sec);
+        if (SEQ(field, "idle"))
+            return g_strdup_printf("%.1lf", p->idle);
+        if (SEQ(field, "time_in_state")) {
+            /* "kHz percent" lines, like stats/time_in_state */
+            gchar *ret = g_strdup("");
+            for (int i = 0; i < p->nfreqs; i++)
+                ret = appfnl(ret, "%" G_GUINT64_FORMAT " %.1lf", p->freq[i], p->residency[i]);
+            return ret;
+        }
+    } else if ( (id = util_get_did(parts[0], "package")) >= 0) {
+        res_package *pk = res_find(res.packages, id);
+        if (!pk) return NULL;
+        if (SEQ(field, "idle"))
+            return g_strdup_printf("%.1lf", pk->idle);
+        if (SEQ(field, "avg_freq"))
+            return g_strdup_printf("%.0lf", pk->avg_freq);
+        if (SEQ(field, "cpus")) {
+            int max = 0;
+            for (guint j = 0; j < res.cpus->len; j++)
+                max = MAX(max, ((res_cpu*)g_ptr_array_index(res.cpus, j))->id);
+            cpubits *b = cpubits_new(max + 1);
+            for (guint j = 0; j < res.cpus->len; j++) {
+                res_cpu *c = g_ptr_array_index(res.cpus, j);
+                if (c->package == id)
+                    CPUBIT_SET(b, c->id);
+            }
+            gchar *ret = res_cpus_str(b);
+            free(b);
+            return ret;
+        }
+    }
+    return NULL;
+}
+
+static gchar *res_read(const gchar *path) {
+    if (!g_str_has_prefix(path, RES_ROOT "/"))
+        return NULL;
+    gchar **parts = g_strsplit(path + strlen(RES_ROOT "/"), "/", -1);
+    res_update();
+    g_mutex_lock(&res.lock);
+    gchar *ret = res.cpus ? res_read_locked(parts) : NULL;
+    g_mutex_unlock(&res.lock);
+    g_strfreev(parts);
+    return ret;
+}
+
+/* a cpu that was offline when the generator ran, requires res.lock */
+static void res_cpu_hotplug(int id, sysobj_virt_batch *b) {
+    if (id < 0 || !res.cpus || res_find(res.cpus, id))
+        return;
+    res_cpu *c = res_cpu_new(id, b);
+    /* counters for the next sample to compare with, or its
+     * first interval would have all the idle time since boot */
+    if (c)
+        res_sample_cpu(c, 0);
+}
+
+static void res_uevent(const uevent *ev, gpointer user_data) {
+    gboolean rescan = uevent_is(ev, "rescan");
+    if (!rescan && !uevent_is(ev, "online") && !uevent_is(ev, "add"))
+        return;
+    sysobj_virt_batch *b = sysobj_virt_batch_new(FALSE);
+    g_mutex_lock(&res.lock);
+    if (rescan) {
+        sysobj *obj = sysobj_new_fast(CPU_ROOT);
+        GSList *childs = obj->exists ? sysobj_children(obj, "cpu*", NULL, TRUE) : NULL;
+        for (GSList *l = childs; l; l = l->next)
+            res_cpu_hotplug(util_get_did(l->data, "cpu"), b);
+        g_slist_free_full(childs, g_free);
+        sysobj_free(obj);
+    } else
+        res_cpu_hotplug(util_get_did(ev->name, "cpu"), b);
+    g_mutex_unlock(&res.lock);
+    sysobj_virt_batch_commit(b);
+}
+
+static gchar *res_root(const gchar *path) {
+    if (!path) {
+        /* cleanup */
+        g_mutex_lock(&res.lock);
+        if (res.cpus)
+            g_ptr_array_free(res.cpus, TRUE);
+        if (res.policies)
+            g_ptr_array_free(res.policies, TRUE);
+        if (res.packages)
+            g_ptr_array_free(res.packages, TRUE);
+        res.cpus = res.policies = res.packages = NULL;
+        res.last = 0;
+        g_mutex_unlock(&res.lock);
+        return NULL;
+    }
+    return NULL; /* auto dir */
+}
+
+static sysobj_virt vol[] = {
+    { .path = RES_ROOT, .str = "*",
+      .f_get_data = res_root,
+      .type = VSO_TYPE_DIR | VSO_TYPE_CONST | VSO_TYPE_CLEANUP },
+};
+
+void gen_cpu_residency() {
+    sysobj *obj = sysobj_new_fast(CPU_ROOT);
+    if (!obj->exists) {
+        sysobj_free(obj);
+        return;
+    }
+
+    for (int i = 0; i < (int)G_N_ELEMENTS(vol); i++)
+        sysobj_virt_add(&vol[i]);
+
+    sysobj_virt_batch *b = sysobj_virt_batch_new(FALSE);
+    g_mutex_lock(&res.lock);
+    res.cpus = g_ptr_array_new_with_free_func((GDestroyNotify)res_cpu_free);
+    res.policies = g_ptr_array_new_with_free_func((GDestroyNotify)res_policy_free);
+    res.packages = g_ptr_array_new_with_free_func(g_free);
+
+    GSList *childs = sysobj_children(obj, "cpu*", NULL, TRUE);
+    for (GSList *l = childs; l; l = l->next) {
+        int id = util_get_did(l->data, "cpu");
+        if (id >= 0)
+            res_cpu_new(id, b);
+    }
+    g_slist_free_full(childs, g_free);
+
+    sysobj *pols = sysobj_new_fast(CPU_ROOT "/cpufreq");
+    childs = pols->exists ? sysobj_children(pols, "policy*", NULL, TRUE) : NULL;
+    for (GSList *l = childs; l; l = l->next)
+        res_policy_new(l->data, b);
+    g_slist_free_full(childs, g_free);
+    sysobj_free(pols);
+
+    /* the first sample is since boot */
+    res_sample_locked();
+    g_mutex_unlock(&res.lock);
+    sysobj_virt_batch_commit(b);
+    free_auto_free();
+    sysobj_free(obj);
+
+    uevent_handler_add("cpu", res_uevent, NULL);
+}
@@ -0,0 +1,217 @@
+/*
+ * sysobj - https://github.com/bp0/verbose-spork
+ * Copyright (C) 2018  Burt P. <pburt0@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+/* Generator for cpu utilization from /proc/stat
+ *  :/cpu/usage
+ */
+#include "sysobj.h"
+#include "gg_file.h"
+
+#define PROC_STAT "/proc/stat"
+#define USAGE_ROOT ":/cpu/usage"
+#define USAGE_INTERVAL 0.25 /* seconds, /proc/stat is read at most this often */
+
+/* the order of the columns in /proc/stat,
+ * guest and guest_nice are already in user and nice */
+static const gchar *usage_fields[] = {
+    "user", "nice", "system", "idle", "iowait", "irq", "softirq", "steal",
+};
+#define USAGE_FIELDS ((int)G_N_ELEMENTS(usage_fields))
+#define USAGE_IDLE 3
+#define USAGE_IOWAIT 4
+
+typedef struct {
+    gchar *name;   /* "all" or cpuN */
+    guint64 prev[USAGE_FIELDS];
+    double pct[USAGE_FIELDS + 1]; /* + busy */
+    gboolean online; /* was in the last sample */
+} usage_cpu;
+
+static struct {
+    GMutex lock;
+    gchar *path_fs;
+    gint64 last;
+    GHashTable *cpus; /* name -> usage_cpu */
+} usage;
+
+static gchar *usage_read(const gchar *path);
+
+static void usage_cpu_free(usage_cpu *uc) {
+    g_free(uc->name);
+    g_free(uc);
+}
+
+static void usage_add_nodes(const gchar *name) {
+    sysobj_virt_batch *b = sysobj_virt_batch_new(FALSE);
+    gchar *base = g_strdup_printf(USAGE_ROOT "/%s", name);
+    sysobj_virt_batch_add_simple(b, base, NULL, "*", VSO_TYPE_DIR);
+    for (int i = 0; i <= USAGE_FIELDS; i++) {
+        sysobj_virt *vo = sysobj_virt_new();
+        vo->path = g_strdup_printf("%s/%s", base, i < USAGE_FIELDS ? usage_fields[i] : "busy");
+        vo->type = VSO_TYPE_STRING;
+        vo->f_get_data = usage_read;
+        sysobj_virt_batch_add(b, vo);
+    }
+    sysobj_virt_batch_commit(b);
+    g_free(base);
+}
+
+/* one read of /proc/stat for every cpu, the percentages are from
+ * the previous sample, or since boot for the first.
+ * Returns the names of cpus not seen before, requires usage.lock. */
+static GSList *usage_sample_locked() {
+    GSList *new_cpus = NULL;
+    gchar *data = NULL;
+
+    gg_file_get_contents_non_blocking(usage.path_fs, &data, NULL, NULL);
+    if (!data) return NULL;
+    usage.last = g_get_monotonic_time();
+
+    GHashTableIter iter;
+    gpointer value;
+    g_hash_table_iter_init(&iter, usage.cpus);
+    while (g_hash_table_iter_next(&iter, NULL, &value))
+        ((usage_cpu*)value)->online = FALSE;
+
+    for (gchar *line = data; line && g_str_has_prefix(line, "cpu"); line = strchr(line, '\n'), line = line ? line + 1 : NULL) {
+        gchar name[32] = "all";
+        guint64 v[USAGE_FIELDS] = {};
+        const gchar *p = line + 3;
+        if (isdigit((unsigned char)*p) ) {
+            int n = 0;
+            while (isdigit((unsigned char)p[n]) && n < 24) n++;
+            snprintf(name, sizeof(name), "cpu%.*s", n, p);
+            p += n;
+        }
+        for (int i = 0; i < USAGE_FIELDS; i++) {
+            gchar *end = NULL;
+            v[i] = g_ascii_strtoull(p, &end, 10);
+            if (end == p) break; /* older kernels have fewer */
+            p = end;
+        }
+
+        usage_cpu *uc = g_hash_table_lookup(usage.cpus, name);
+        if (!uc) {
+            uc = g_new0(usage_cpu, 1);
+            uc->name = g_strdup(name);
+            g_hash_table_insert(usage.cpus, uc->name, uc);
+            new_cpus = g_slist_prepend(new_cpus, g_strdup(name));
+        }
+        uc->online = TRUE;
+
+        guint64 d[USAGE_FIELDS], total = 0;
+        for (int i = 0; i < USAGE_FIELDS; i++) {
+            /* counters can go backwards for a cpu that was offline */
+            d[i] = (v[i] >= uc->prev[i]) ? v[i] - uc->prev[i] : 0;
+            total += d[i];
+        }
+        if (total) {
+            for (int i = 0; i < USAGE_FIELDS; i++)
+                uc->pct[i] = 100.0 * d[i] / total;
+            uc->pct[USAGE_FIELDS] = 100.0 - uc->pct[USAGE_IDLE] - uc->pct[USAGE_IOWAIT];
+        }
+        /* else no ticks since the last, keep the last percentages */
+        memcpy(uc->prev, v, sizeof(v));
+    }
+    g_free(data);
+    return new_cpus;
+}
+
+static void usage_update() {
+    GSList *new_cpus = NULL;
+    g_mutex_lock(&usage.lock);
+    if (usage.path_fs
+        && (g_get_monotonic_time() - usage.last) >= USAGE_INTERVAL * G_USEC_PER_SEC)
+        new_cpus = usage_sample_locked();
+    g_mutex_unlock(&usage.lock);
+
+    /* a cpu that was offline before */
+    for (GSList *l = new_cpus; l; l = l->next)
+        usage_add_nodes(l->data);
+    g_slist_free_full(new_cpus, g_free);
+}
+
+static gchar *usage_read(const gchar *path) {
+    gchar *ret = NULL;
+    gchar *field = g_path_get_basename(path);
+    gchar *cpu_path = g_path_get_dirname(path);
+    gchar *cpu = g_path_get_basename(cpu_path);
+
+    usage_update();
+    g_mutex_lock(&usage.lock);
+    usage_cpu *uc = usage.cpus ? g_hash_table_lookup(usage.cpus, cpu) : NULL;
+    if (uc && uc->online) {
+        for (int i = 0; i <= USAGE_FIELDS; i++)
+            if (SEQ(field, i < USAGE_FIELDS ? usage_fields[i] : "busy") ) {
+                ret = g_strdup_printf("%.1lf", uc->pct[i]);
+                break;
+            }
+    }
+    g_mutex_unlock(&usage.lock);
+
+    g_free(field);
+    g_free(cpu_path);
+    g_free(cpu);
+    return ret;
+}
+
+static gchar *usage_root(const gchar *path) {
+    if (!path) {
+        /* cleanup */
+        g_mutex_lock(&usage.lock);
+        if (usage.cpus)
+            g_hash_table_destroy(usage.cpus);
+        usage.cpus = NULL;
+        g_free(usage.path_fs);
+        usage.path_fs = NULL;
+        usage.last = 0;
+        g_mutex_unlock(&usage.lock);
+        return NULL;
+    }
+    return NULL; /* auto dir */
+}
+
+static sysobj_virt vol[] = {
+    { .path = USAGE_ROOT, .str = "*",
+      .f_get_data = usage_root,
+      .type = VSO_TYPE_DIR | VSO_TYPE_CONST | VSO_TYPE_CLEANUP },
+};
+
+void gen_cpu_usage() {
+    sysobj *obj = sysobj_new_fast(PROC_STAT);
+    if (!obj->exists) {
+        sysobj_free(obj);
+        return;
+    }
+
+    for (int i = 0; i < (int)G_N_ELEMENTS(vol); i++)
+        sysobj_virt_add(&vol[i]);
+
+    g_mutex_lock(&usage.lock);
+    usage.path_fs = g_strdup(obj->path_fs);
+    usage.cpus = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, (GDestroyNotify)usage_cpu_free);
+    GSList *cpus = usage_sample_locked();
+    g_mutex_unlock(&usage.lock);
+    sysobj_free(obj);
+
+    for (GSList *l = cpus; l; l = l->next)
+        usage_add_nodes(l->data);
+    g_slist_free_full(cpus, g_free);
+}
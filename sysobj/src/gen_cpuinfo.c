@@ -28,9 +28,11 @@
 #include "arm_data.h"
 #include "x86_data.h"
 #include "riscv_data.h"
+#include "cpubits.h"
 
 #define PROC_CPUINFO "/proc/cpuinfo"
 static gchar *x86_funfacts_path = NULL;
+static void x86_funfacts_cleanup();
 
 /* guess from what appears in the cpuinfo, because we
  * could be testing on a different arch. */
@@ -42,11 +44,22 @@ enum {
 };
 static const gchar *cpu_types[] = { "unknown", "arm", "x86", "risc-v" };
 
+/* every flag name seen, once, each lcpu has a bitset of ids */
+static GHashTable *flag_ids = NULL;  /* name -> id + 1 */
+static GPtrArray *flag_names = NULL; /* id -> name */
+
 static int cpuinfo_was_found = 0;
 static gchar *cpuinfo_found(const gchar *path) {
     if (!path) {
         /* generator cleanup */
         g_free(x86_funfacts_path);
+        x86_funfacts_cleanup();
+        if (flag_ids) {
+            g_ptr_array_free(flag_names, TRUE);
+            g_hash_table_destroy(flag_ids);
+            flag_names = NULL;
+            flag_ids = NULL;
+        }
         return NULL;
     }
     return g_strdup(cpuinfo_was_found ? "1" : "0");
@@ -64,7 +77,7 @@ static GList *lcpus = NULL;
 typedef struct {
     int id, type;
     gchar *model_name;
-    GSList *flags; /* includes flags, bugs, pm, etc */
+    cpubits *flags; /* ids in flag_names, includes flags, bugs, pm, etc */
     gchar *bogomips;
     /* arm */
     gchar *linux_name;
@@ -93,7 +106,7 @@ typedef struct {
 
 void lcpu_free(lcpu *s) {
     if (!s) return;
-    g_slist_free_full(s->flags, g_free);
+    free(s->flags);
     g_free(s->bogomips);
     /* arm */
     g_free(s->linux_name);
@@ -124,30 +137,59 @@ void lcpu_free(lcpu *s) {
     g_free(s);
 }
 
-static void x86_funfacts(lcpu *s) {
+/* x86.funfacts, read once, each match line is a record
+ * of the values set so far */
+typedef struct {
+    int order;
+    gchar *arch, *codename, *process, *socket, *bus, *tdp, *release, *url;
+} x86_ff;
+
+static GHashTable *x86_ff_index = NULL; /* "vendor[/f[/m[/s]]]" -> first x86_ff */
+static GSList *x86_ff_list = NULL;
+
+static void x86_ff_clear(x86_ff *ff) {
+    g_free(ff->arch);
+    g_free(ff->codename);
+    g_free(ff->process);
+    g_free(ff->socket);
+    g_free(ff->bus);
+    g_free(ff->tdp);
+    g_free(ff->release);
+    g_free(ff->url);
+    memset(ff, 0, sizeof(x86_ff));
+}
+
+static void x86_ff_free(x86_ff *ff) {
+    x86_ff_clear(ff);
+    g_free(ff);
+}
+
+static void x86_funfacts_cleanup() {
+    if (x86_ff_index)
+        g_hash_table_destroy(x86_ff_index);
+    g_slist_free_full(x86_ff_list, (GDestroyNotify)x86_ff_free);
+    x86_ff_index = NULL;
+    x86_ff_list = NULL;
+}
+
+static void x86_funfacts_load() {
 #define X86F_BUFF_SIZE 128
 #define X86F_FFWD() while(isspace((unsigned char)*p)) p++;
 #define X86F_CHK(TOK) (strncmp(p, TOK, tl = strlen(TOK)) == 0)
-    gchar *chunk = g_malloc0(X86F_BUFF_SIZE*9);
-    char *buff     = chunk;
-    char *arch     = chunk + X86F_BUFF_SIZE;
-    char *codename = chunk + X86F_BUFF_SIZE*2;
-    char *process  = chunk + X86F_BUFF_SIZE*3;
-    char *socket   = chunk + X86F_BUFF_SIZE*4;
-    char *bus      = chunk + X86F_BUFF_SIZE*5;
-    char *tdp      = chunk + X86F_BUFF_SIZE*6;
-    char *release  = chunk + X86F_BUFF_SIZE*7;
-    char *url      = chunk + X86F_BUFF_SIZE*8;
-
+#define X86F_SET(f) if (X86F_CHK(#f " ")) { g_free(cur.f); cur.f = g_strndup(p + tl, X86F_BUFF_SIZE - 1); }
+    char buff[X86F_BUFF_SIZE];
+    x86_ff cur = {};
     FILE *fd;
     char *p, *b;
-    int tl;
+    int tl, order = 0;
+
+    x86_ff_index = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
 
     if (!x86_funfacts_path)
         x86_funfacts_path = sysobj_find_data_file("x86.funfacts");
 
-    fd = fopen(x86_funfacts_path, "r");
-    if (!fd) goto x86_funfacts_bail;
+    fd = x86_funfacts_path ? fopen(x86_funfacts_path, "r") : NULL;
+    if (!fd) return;
 
     while (fgets(buff, X86F_BUFF_SIZE, fd)) {
         b = strchr(buff, '\n');
@@ -155,62 +197,94 @@ static void x86_funfacts(lcpu *s) {
         p = buff;
         X86F_FFWD();
         if (X86F_CHK("arch ")) {
-            memset(arch, 0, X86F_BUFF_SIZE * 8);
-            strncpy(arch, p + tl, X86F_BUFF_SIZE - 1);
+            /* clears the set */
+            gchar *arch = g_strndup(p + tl, X86F_BUFF_SIZE - 1);
+            x86_ff_clear(&cur);
+            cur.arch = arch;
         }
-        if (X86F_CHK("codename "))
-            strncpy(codename, p + tl, X86F_BUFF_SIZE - 1);
-        if (X86F_CHK("process "))
-            strncpy(process, p + tl, X86F_BUFF_SIZE - 1);
-        if (X86F_CHK("socket "))
-            strncpy(socket, p + tl, X86F_BUFF_SIZE - 1);
-        if (X86F_CHK("bus "))
-            strncpy(bus, p + tl, X86F_BUFF_SIZE - 1);
-        if (X86F_CHK("tdp "))
-            strncpy(tdp, p + tl, X86F_BUFF_SIZE - 1);
-        if (X86F_CHK("release "))
-            strncpy(release, p + tl, X86F_BUFF_SIZE - 1);
-        if (X86F_CHK("url "))
-            strncpy(url, p + tl, X86F_BUFF_SIZE - 1);
+        X86F_SET(codename);
+        X86F_SET(process);
+        X86F_SET(socket);
+        X86F_SET(bus);
+        X86F_SET(tdp);
+        X86F_SET(release);
+        X86F_SET(url);
 
         if (X86F_CHK("match ")) {
             /* match <vendor>/<family>/<model>/<stepping>:name glob */
-            gboolean ok = TRUE;
             char *id = p + tl;
             char *nglob = strrchr(id, ':');
             char ven[X86F_BUFF_SIZE] = "";
-            unsigned int family, model, stepping;
+            unsigned int fms[3];
             if (nglob) { *nglob = 0; nglob++; }
-            int mc = sscanf(id, "%[^/]/%x/%x/%x", ven, &family, &model, &stepping);
-            switch(mc) {
-                case 4: if (stepping != atoi(s->stepping)) { ok = FALSE; break; }
-                case 3: if (model != atoi(s->model)) { ok = FALSE; break; }
-                case 2: if (family != atoi(s->family)) { ok = FALSE; break; }
-                case 1: if (!SEQ(ven, s->vendor_id)) { ok = FALSE; break; }
-            }
+            int mc = sscanf(id, "%[^/]/%x/%x/%x", ven, &fms[0], &fms[1], &fms[2]);
+            if (mc < 1) continue;
             if (nglob && strlen(nglob)) {
                 //TODO:
             }
-            if (ok) {
-                gchar *ffpath = g_strdup_printf(":/cpu/cpuinfo/logical_cpu%d/x86_details", s->id);
-#define virt_if_not_empty(attr) if (strlen(attr)) sysobj_virt_add_simple_mkpath(ffpath, #attr, attr, VSO_TYPE_STRING);
-                virt_if_not_empty(arch);
-                virt_if_not_empty(codename);
-                virt_if_not_empty(process);
-                virt_if_not_empty(socket);
-                virt_if_not_empty(bus);
-                virt_if_not_empty(tdp);
-                virt_if_not_empty(release);
-                virt_if_not_empty(url);
-                g_free(ffpath);
-                goto x86_funfacts_bail;
-            }
+            GString *key = g_string_new(ven);
+            for (int i = 0; i < mc - 1; i++)
+                g_string_append_printf(key, "/%x", fms[i]);
+
+            x86_ff *ff = g_new0(x86_ff, 1);
+            ff->order = order++;
+#define X86F_COPY(f) ff->f = g_strdup(cur.f)
+            X86F_COPY(arch);
+            X86F_COPY(codename);
+            X86F_COPY(process);
+            X86F_COPY(socket);
+            X86F_COPY(bus);
+            X86F_COPY(tdp);
+            X86F_COPY(release);
+            X86F_COPY(url);
+            x86_ff_list = g_slist_prepend(x86_ff_list, ff);
+            if (!g_hash_table_contains(x86_ff_index, key->str))
+                g_hash_table_insert(x86_ff_index, g_string_free(key, FALSE), ff);
+            else
+                g_string_free(key, TRUE);
         }
     }
+    x86_ff_clear(&cur);
+    fclose(fd);
+}
+
+/* the first match in the file, as if it were scanned; borrowed */
+static const x86_ff *x86_funfacts_lookup(const gchar *vendor_id, int family, int model, int stepping) {
+    const x86_ff *ret = NULL;
+    if (!x86_ff_index)
+        x86_funfacts_load();
+    gchar *key[4] = {
+        g_strdup_printf("%s", vendor_id),
+        g_strdup_printf("%s/%x", vendor_id, family),
+        g_strdup_printf("%s/%x/%x", vendor_id, family, model),
+        g_strdup_printf("%s/%x/%x/%x", vendor_id, family, model, stepping),
+    };
+    for (int i = 0; i < 4; i++) {
+        const x86_ff *ff = g_hash_table_lookup(x86_ff_index, key[i]);
+        if (ff && (!ret || ff->order < ret->order))
+            ret = ff;
+        g_free(key[i]);
+    }
+    return ret;
+}
 
-x86_funfacts_bail:
-    if (fd) fclose(fd);
-    g_free(chunk);
+static void x86_funfacts(lcpu *s) {
+    if (!s->vendor_id || !s->family || !s->model || !s->stepping)
+        return;
+    const x86_ff *ff = x86_funfacts_lookup(s->vendor_id, atoi(s->family), atoi(s->model), atoi(s->stepping));
+    if (ff) {
+        gchar *ffpath = g_strdup_printf(":/cpu/cpuinfo/logical_cpu%d/x86_details", s->id);
+#define virt_if_not_empty(attr) if (ff->attr && strlen(ff->attr)) sysobj_virt_add_simple_mkpath(ffpath, #attr, ff->attr, VSO_TYPE_STRING);
+        virt_if_not_empty(arch);
+        virt_if_not_empty(codename);
+        virt_if_not_empty(process);
+        virt_if_not_empty(socket);
+        virt_if_not_empty(bus);
+        virt_if_not_empty(tdp);
+        virt_if_not_empty(release);
+        virt_if_not_empty(url);
+        g_free(ffpath);
+    }
 }
 
 gboolean cpuinfo_arm_decoded_name(lcpu *c) {
@@ -232,22 +306,62 @@ gboolean cpuinfo_arm_decoded_name(lcpu *c) {
     return FALSE;
 }
 
-static void cpuinfo_append_flags(lcpu *p, gchar *prefix, gchar *flags_str) {
-    gchar **each = g_strsplit(flags_str, " ", -1);
-    gsize i, count = g_strv_length(each);
-    gchar *tmp = NULL;
-    for (i = 0; i < count; i++) {
-        if (prefix)
-            tmp = g_strdup_printf("%s:%s", prefix, each[i]);
-        else
-            tmp = g_strdup(each[i]);
-        g_strstrip(tmp);
-        if (strlen(tmp))
-            p->flags = g_slist_append(p->flags, tmp);
-        else
-            g_free(tmp);
+static int flag_intern(const gchar *flag) {
+    int id = GPOINTER_TO_INT(g_hash_table_lookup(flag_ids, flag)) - 1;
+    if (id < 0) {
+        gchar *name = g_strdup(flag);
+        id = flag_names->len;
+        g_ptr_array_add(flag_names, name);
+        g_hash_table_insert(flag_ids, name, GINT_TO_POINTER(id + 1));
+    }
+    return id;
+}
+
+static void lcpu_flag_set(lcpu *p, int id) {
+    if (!p->flags || id >= CPUBITS_NBITS(p->flags)) {
+        cpubits *nb = cpubits_new(id + 64);
+        if (p->flags) {
+            memcpy(nb->w, p->flags->w, p->flags->nwords * sizeof(uint64_t));
+            free(p->flags);
+        }
+        p->flags = nb;
     }
-    g_strfreev(each);
+    CPUBIT_SET(p->flags, id);
+}
+
+/* flags_str is split in place */
+static void cpuinfo_append_flags(lcpu *p, const gchar *prefix, gchar *flags_str) {
+    gchar tmp[256];
+    gchar *tok = flags_str, *end;
+    while (*tok) {
+        while (isspace((unsigned char)*tok)) tok++;
+        if (!*tok) break;
+        for (end = tok; *end && !isspace((unsigned char)*end); end++);
+        gchar c = *end;
+        *end = 0;
+        if (prefix) {
+            snprintf(tmp, sizeof(tmp), "%s:%s", prefix, tok);
+            lcpu_flag_set(p, flag_intern(tmp));
+        } else
+            lcpu_flag_set(p, flag_intern(tok));
+        *end = c;
+        tok = end;
+    }
+}
+
+static guint flagbits_hash(const cpubits *b) {
+    guint h = 0;
+    for (int i = 0; i < b->nwords; i++)
+        if (b->w[i])
+            h = h * 31 + (guint)((b->w[i] ^ (b->w[i] >> 32)) + i);
+    return h;
+}
+
+static gchar *flagbits_to_str(const cpubits *b) {
+    GString *ret = g_string_new(NULL);
+    for (int id = cpubits_min(b); id >= 0; id = cpubits_next(b, id, -1) )
+        g_string_append_printf(ret, "%s%s", ret->len ? " " : "", (gchar*)g_ptr_array_index(flag_names, id) );
+    return g_string_free(ret, FALSE);
 }
 
 /* Some old cpuinfo's for single-cpu systems don't
@@ -260,27 +374,23 @@ static void cpuinfo_append_flags(lcpu *p, gchar *prefix, gchar *flags_str) {
 #define CHKSETFOR(p, m) if (CHKFOR(p)) { CHKONEPROC; this_lcpu->m = g_strdup(value); continue; }
 #define CHKSETFOR_INT(p, m) if (CHKFOR(p)) { CHKONEPROC; this_lcpu->m = atol(value); continue; }
 
-/* because g_slist_copy_deep( .. , g_strdup, NULL)
- * would have been too easy */
-static gchar *dumb_string_copy(gchar *src, gpointer *e) {
-    PARAM_NOT_UNUSED(e);
-    return g_strdup(src);
-}
-
-void cpuinfo_scan_arm_x86_rv(gchar **lines, gsize line_count) {
+/* one pass over the whole of cpuinfo, which is split in place */
+void cpuinfo_scan_arm_x86_rv(gchar *cpuinfo) {
     gchar rep_pname[256] = "";
     lcpu *this_lcpu = NULL;
-    gsize i = 0;
-    for (i = 0; i < line_count; i++) {
-        gchar *line = lines[i];
-        gchar *value = g_utf8_strchr(line, -1, ':');
+    gchar *next = cpuinfo;
+    while (next) {
+        gchar *line = next;
+        next = strchr(line, '\n');
+        if (next) *next++ = 0;
+        gchar *value = strchr(line, ':');
         if (value)
             value = g_strstrip(value+1);
         else
             continue;
 
         if (CHKFOR("Processor")) { /* note the majiscule P */
-            strcpy(rep_pname, value);
+            g_strlcpy(rep_pname, value, sizeof(rep_pname));
             continue;
         }
 
@@ -300,6 +410,7 @@ void cpuinfo_scan_arm_x86_rv(gchar **lines, gsize line_count) {
 
         /* arm */
         if (CHKFOR("Features")) {
+            CHKONEPROC;
             cpuinfo_append_flags(this_lcpu, NULL, value);
             continue;
         }
@@ -311,14 +422,17 @@ void cpuinfo_scan_arm_x86_rv(gchar **lines, gsize line_count) {
 
         /* x86 */
         if (CHKFOR("flags")) {
+            CHKONEPROC;
             cpuinfo_append_flags(this_lcpu, NULL, value);
             continue;
         }
         if (CHKFOR("bugs")) {
+            CHKONEPROC;
             cpuinfo_append_flags(this_lcpu, "bug", value);
             continue;
         }
         if (CHKFOR("power management")) {
+            CHKONEPROC;
             cpuinfo_append_flags(this_lcpu, "pm", value);
             continue;
         }
@@ -371,7 +485,7 @@ void cpuinfo_scan_arm_x86_rv(gchar **lines, gsize line_count) {
             dlcpu = this_lcpu;
         } else if (dlcpu) {
             if (dlcpu->flags && !this_lcpu->flags) {
-                this_lcpu->flags = g_slist_copy_deep(dlcpu->flags, (GCopyFunc)dumb_string_copy, NULL);
+                this_lcpu->flags = cpubits_dup(dlcpu->flags);
             }
             REDUP(cpu_implementer);
             REDUP(cpu_architecture);
@@ -442,10 +556,36 @@ void cpuinfo_scan_arm_x86_rv(gchar **lines, gsize line_count) {
 void cpuinfo_scan() {
     sysobj *obj = sysobj_new_from_fn("/proc/cpuinfo", NULL);
     sysobj_read(obj, FALSE);
-    gchar **cpuinfo = g_strsplit(obj->data.str, "\n", -1);
-    gsize line_count = g_strv_length(cpuinfo);
-    cpuinfo_scan_arm_x86_rv(cpuinfo, line_count);
-    g_strfreev(cpuinfo);
+    if (!flag_ids) {
+        flag_ids = g_hash_table_new(g_str_hash, g_str_equal);
+        flag_names = g_ptr_array_new_with_free_func(g_free);
+    }
+    if (obj->data.str)
+        cpuinfo_scan_arm_x86_rv(obj->data.str);
+
+    /* flags of every lcpu, and how many different sets */
+    cpubits *common = NULL;
+    GHashTable *flag_sets = g_hash_table_new((GHashFunc)flagbits_hash, (GEqualFunc)cpubits_equal);
+    for (GList *l = lcpus; l; l = l->next) {
+        lcpu *this_lcpu = l->data;
+        if (!this_lcpu->flags) continue;
+        g_hash_table_add(flag_sets, this_lcpu->flags);
+        if (common) {
+            cpubits *nc = cpubits_and(common, this_lcpu->flags);
+            free(common);
+            common = nc;
+        } else
+            common = cpubits_dup(this_lcpu->flags);
+    }
+    if (common) {
+        gchar *common_str = flagbits_to_str(common);
+        sysobj_virt_add_simple(":/cpu/cpuinfo/flags_common", NULL, common_str, VSO_TYPE_STRING);
+        g_free(common_str);
+    }
+    gchar *sets_str = g_strdup_printf("%u", g_hash_table_size(flag_sets) );
+    sysobj_virt_add_simple(":/cpu/cpuinfo/flag_sets", NULL, sets_str, VSO_TYPE_STRING);
+    g_free(sets_str);
+    g_hash_table_destroy(flag_sets);
 
     GList *l = lcpus;
     while(l) {
@@ -474,13 +614,26 @@ void cpuinfo_scan() {
                 break;
         }
 
-        sysobj_virt_add_simple(base_flags, NULL, "*", VSO_TYPE_DIR);
+        sysobj_virt_batch *b = sysobj_virt_batch_new(FALSE);
+        sysobj_virt_batch_add_simple(b, base_flags, NULL, "*", VSO_TYPE_DIR);
         if (this_lcpu->flags) {
-            for(GSList *fl = this_lcpu->flags; fl; fl = fl->next) {
-                gchar *flag = fl->data;
-                sysobj_virt_add_simple(base_flags, flag, flag, VSO_TYPE_STRING );
+            cpubits *fb = this_lcpu->flags;
+            for (int id = cpubits_min(fb); id >= 0; id = cpubits_next(fb, id, -1) ) {
+                const gchar *flag = g_ptr_array_index(flag_names, id);
+                sysobj_virt_batch_add_simple(b, base_flags, flag, flag, VSO_TYPE_STRING );
+            }
+            /* those that not every lcpu has, like on a hybrid */
+            if (common && !cpubits_equal(fb, common) ) {
+                cpubits *extra = cpubits_new(CPUBITS_NBITS(fb));
+                for (int w = 0; w < fb->nwords; w++)
+                    extra->w[w] = fb->w[w] ^ (w < common->nwords ? common->w[w] : 0);
+                gchar *extra_str = flagbits_to_str(extra);
+                sysobj_virt_batch_add_simple(b, base, "flags_extra", extra_str, VSO_TYPE_STRING );
+                g_free(extra_str);
+                free(extra);
             }
         }
+        sysobj_virt_batch_commit(b);
         g_free(base_flags);
 
         /* arm */
@@ -517,6 +670,8 @@ void cpuinfo_scan() {
         l = l->next;
     }
     g_list_free_full(lcpus, (GDestroyNotify)lcpu_free);
+    lcpus = NULL;
+    free(common);
     sysobj_free(obj);
 }
 
@@ -19,9 +19,41 @@
  */
 
 #include "sysobj.h"
+#include "sysobj_cache.h"
 
 static gchar sysfs_map_dir[1024] = "";
 static gchar string_dir[1024] = "";
+static gchar *cache_key = NULL;
+
+/* what's in the cache file, and what will be; saved at most every
+ * CACHE_SAVE_DELAY while new strings come in, and at cleanup */
+#define CACHE_SAVE_DELAY (10 * G_USEC_PER_SEC)
+static GSList *cache_vos = NULL;
+static gboolean cache_dirty = FALSE;
+static gint64 cache_saved = 0;
+static GMutex cache_lock;
+
+static void cache_flush(gboolean now) {
+    g_mutex_lock(&cache_lock);
+    gint64 t = g_get_monotonic_time();
+    if (cache_dirty && (now || t - cache_saved >= CACHE_SAVE_DELAY) ) {
+        sysobj_cache_save_list("dmidecode", cache_key, cache_vos);
+        cache_saved = t;
+        cache_dirty = FALSE;
+    }
+    g_mutex_unlock(&cache_lock);
+}
+
+static void cache_add(const gchar *name, const gchar *value) {
+    sysobj_virt *vo = sysobj_virt_new();
+    vo->path = util_build_fn(":/extern/dmidecode/--string", name);
+    vo->str = g_strdup(value);
+    vo->type = VSO_TYPE_STRING | VSO_TYPE_REQ_ROOT;
+    g_mutex_lock(&cache_lock);
+    cache_vos = g_slist_append(cache_vos, vo);
+    cache_dirty = TRUE;
+    g_mutex_unlock(&cache_lock);
+}
 
 static struct {
     char *id;       /* dmidecode -s ... */
@@ -86,7 +118,15 @@ static gchar *util_exec(const gchar **argv) {
 }
 
 static gchar *dmidecode_get_str(const gchar *path) {
-    if (!path) return NULL;
+    if (!path) {
+        /* the tree is being torn down, cache_vos doesn't need it */
+        cache_flush(TRUE);
+        g_slist_free_full(cache_vos, (GDestroyNotify)sysobj_virt_free);
+        cache_vos = NULL;
+        g_free(cache_key);
+        cache_key = NULL;
+        return NULL;
+    }
     gchar *name = g_path_get_basename(path);
     gchar *ret = NULL;
     if (SEQ(name, "--string")) {
@@ -96,6 +136,14 @@ static gchar *dmidecode_get_str(const gchar *path) {
         if (!sysobj_using_alt_root() ) {
             const gchar *argv[] = { "/usr/bin/env", "dmidecode", "-s", name, NULL };
             ret = util_exec(argv);
+            if (ret) {
+                /* an exact non-dyn match is found before this again,
+                 * and kept for the rest of the boot */
+                sysobj_virt_add_simple(":/extern/dmidecode/--string", name, ret, VSO_TYPE_STRING | VSO_TYPE_REQ_ROOT);
+                if (cache_key)
+                    cache_add(name, ret);
+            }
+            cache_flush(FALSE);
         }
     }
     g_free(name);
@@ -158,7 +206,7 @@ static sysobj_virt vol[] = {
       .type = VSO_TYPE_DIR | VSO_TYPE_CONST,
       .f_get_data = NULL, .f_get_type = NULL },
     { .path = ":/extern/dmidecode/--string", .str = "",
-      .type = VSO_TYPE_DIR | VSO_TYPE_DYN | VSO_TYPE_CONST,
+      .type = VSO_TYPE_DIR | VSO_TYPE_DYN | VSO_TYPE_CONST | VSO_TYPE_CLEANUP,
       .f_get_data = dmidecode_get_str, .f_get_type = dmidecode_check_type },
     { .path = ":/extern/dmidecode/sysfs_map", .str = "",
       .type = VSO_TYPE_DIR | VSO_TYPE_DYN | VSO_TYPE_CONST,
@@ -188,4 +236,10 @@ void gen_dmidecode() {
     for (i = 0; i < (int)G_N_ELEMENTS(vol); i++) {
         sysobj_virt_add(&vol[i]);
     }
+
+    /* anything dmidecode already said this boot */
+    cache_key = sysobj_cache_key(NULL, NULL);
+    if (sysobj_cache_restore("dmidecode", cache_key) )
+        cache_vos = sysobj_virt_dup_static(":/extern/dmidecode/--string/*");
+    cache_saved = g_get_monotonic_time();
 }
@@ -26,6 +26,7 @@
 #include "sysobj_extras.h"
 #include "util_pci.h"
 #include "vendor.h"
+#include "uevent.h"
 
 /* virt get funcs */
 static gchar *gpu_data(const gchar *path);
@@ -37,17 +38,23 @@ static gchar *gpu_core_khz(const gchar *path);
 #define PFX_PCI "2-pci-dc-"
 #define PFX_DT  "3-dt-"
 
+static gboolean found_drm_card(sysobj *card_obj) {
+    if (verify_lblnum(card_obj, "card") ) {
+        gchar *gpu_id = g_strdup_printf(PFX_DRM "%s", card_obj->name_req);
+        sysobj_virt_add_simple(":/gpu/found",  gpu_id, card_obj->path, VSO_TYPE_SYMLINK | VSO_TYPE_AUTOLINK | VSO_TYPE_DYN );
+        g_free(gpu_id);
+        return TRUE;
+    }
+    return FALSE;
+}
+
 static void find_drm_cards() {
     sysobj *drm_obj = sysobj_new_from_fn("/sys/class/drm", NULL);
     if (drm_obj->exists) {
         sysobj_read(drm_obj, FALSE);
         for(GSList *l = drm_obj->data.childs; l; l = l->next) {
             sysobj *card_obj = sysobj_new_from_fn(drm_obj->path, (gchar*)l->data);
-            if (verify_lblnum(card_obj, "card") ) {
-                gchar *gpu_id = g_strdup_printf(PFX_DRM "%s", card_obj->name_req);
-                sysobj_virt_add_simple(":/gpu/found",  gpu_id, card_obj->path, VSO_TYPE_SYMLINK | VSO_TYPE_AUTOLINK | VSO_TYPE_DYN );
-                g_free(gpu_id);
-            }
+            found_drm_card(card_obj);
             sysobj_free(card_obj);
         }
     }
@@ -60,24 +67,32 @@ static void find_drm_cards() {
  * class 00 subclass 01, VGA compatible unclassified device
  * (sysfs pci class attribute = 0x000100 - 0x0001ff)
  */
+static gboolean found_pci_vga_device(sysobj *card_obj) {
+    gboolean ret = FALSE;
+    if (verify_pci_addy(card_obj->name) ) {
+        gchar *class_str = sysobj_raw_from_fn(card_obj->path, "class");
+        if (class_str) {
+            int pci_class = strtol(class_str, NULL, 16);
+            if ( (pci_class >= 0x30000 && pci_class <= 0x3ffff)
+                || (pci_class >= 0x000100 && pci_class <= 0x0001ff) ) {
+                gchar *gpu_id = g_strdup_printf(PFX_PCI "%s", card_obj->name_req);
+                sysobj_virt_add_simple(":/gpu/found", gpu_id, card_obj->path, VSO_TYPE_SYMLINK | VSO_TYPE_AUTOLINK | VSO_TYPE_DYN );
+                g_free(gpu_id);
+                ret = TRUE;
+            }
+        }
+        g_free(class_str);
+    }
+    return ret;
+}
+
 static void find_pci_vga_devices() {
     sysobj *drm_obj = sysobj_new_from_fn("/sys/bus/pci/devices", NULL);
     if (drm_obj->exists) {
         sysobj_read(drm_obj, FALSE);
         for(GSList *l = drm_obj->data.childs; l; l = l->next) {
             sysobj *card_obj = sysobj_new_from_fn(drm_obj->path, (gchar*)l->data);
-            if (verify_pci_addy(card_obj->name) ) {
-                gchar *class_str = sysobj_raw_from_fn(card_obj->path, "class");
-                if (class_str) {
-                    int pci_class = strtol(class_str, NULL, 16);
-                    if ( (pci_class >= 0x30000 && pci_class <= 0x3ffff)
-                        || (pci_class >= 0x000100 && pci_class <= 0x0001ff) ) {
-                        gchar *gpu_id = g_strdup_printf(PFX_PCI "%s", card_obj->name_req);
-                        sysobj_virt_add_simple(":/gpu/found", gpu_id, card_obj->path, VSO_TYPE_SYMLINK | VSO_TYPE_AUTOLINK | VSO_TYPE_DYN );
-                        g_free(gpu_id);
-                    }
-                }
-            }
+            found_pci_vga_device(card_obj);
             sysobj_free(card_obj);
         }
     }
@@ -496,6 +511,70 @@ static void gpu_scan() {
     g_mutex_unlock(&gpu_list_lock);
 }
 
+/* requires gpu_list_lock held */
+static void gpu_remove(gpud *g) {
+    gchar *glob = util_build_fn(":/gpu", g->name);
+    sysobj_virt_remove(glob);
+    glob = appf(glob, "", "/*");
+    sysobj_virt_remove(glob);
+    g_free(glob);
+    gpu_list = g_slist_remove(gpu_list, g);
+    gpud_free(g);
+}
+
+/* a drm card or pci display device came or went, only that one
+ * is looked at, then gpu_scan() picks up anything new in :/gpu/found.
+ * When one part of a gpu goes, its gpuN is rebuilt from what's left.
+ * Other pci devices coming and going don't cause a scan. */
+static void gpu_uevent(const uevent *ev, gpointer user_data) {
+    gboolean drm = SEQ(ev->subsystem, "drm");
+    if (uevent_is(ev, "rescan")) {
+        if (drm)
+            find_drm_cards();
+        else
+            find_pci_vga_devices();
+        gpu_scan();
+        return;
+    }
+    if (drm && (!g_str_has_prefix(ev->name, "card") || strchr(ev->name, '-')) )
+        return; /* not connectors like card0-HDMI-A-1 */
+    if (!drm && !verify_pci_addy(ev->name))
+        return;
+
+    if (uevent_is(ev, "add")) {
+        gboolean found = FALSE;
+        sysobj *obj = drm
+            ? sysobj_new_from_fn("/sys/class/drm", ev->name)
+            : sysobj_new_from_fn("/sys/bus/pci/devices", ev->name);
+        if (obj->exists)
+            found = drm ? found_drm_card(obj) : found_pci_vga_device(obj);
+        sysobj_free(obj);
+        if (found)
+            gpu_scan();
+    } else if (uevent_is(ev, "remove")) {
+        gchar *found = g_strdup_printf(":/gpu/found/%s%s", drm ? PFX_DRM : PFX_PCI, ev->name);
+        sysobj_virt *vo = sysobj_virt_find(found);
+        gboolean was_gpu = (vo != NULL);
+        sysobj_virt_unref(vo);
+        if (was_gpu)
+            sysobj_virt_remove(found);
+        g_free(found);
+
+        g_mutex_lock(&gpu_list_lock);
+        for(GSList *l = gpu_list; l; l = l->next) {
+            gpud *g = (gpud*)l->data;
+            if (SEQ(drm ? g->drm_card : g->pci_addy, ev->name) ) {
+                gpu_remove(g);
+                was_gpu = TRUE;
+                break;
+            }
+        }
+        g_mutex_unlock(&gpu_list_lock);
+        if (was_gpu)
+            gpu_scan();
+    }
+}
+
 static void buff_basename(const gchar *path, gchar *buff, gsize n) {
     gchar *fname = g_path_get_basename(path);
     strncpy(buff, fname, n);
@@ -697,4 +776,6 @@ void gen_gpu() {
     // TODO: usb3 gpus?
 
     gpu_scan(); /* initial */
+    uevent_handler_add("drm", gpu_uevent, NULL);
+    uevent_handler_add("pci", gpu_uevent, NULL);
 }
@@ -0,0 +1,523 @@
+/*
+ * sysobj - https://github.com/bp0/verbose-spork
+ * Copyright (C) 2018  Burt P. <pburt0@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+/* Generator for interrupt counts and rates from /proc/interrupts
+ *  :/interrupts
+ */
+#include "sysobj.h"
+#include "gg_file.h"
+#include "cpubits.h"
+
+#define PROC_INTERRUPTS "/proc/interrupts"
+#define INTR_ROOT ":/interrupts"
+#define INTR_INTERVAL 0.5 /* seconds, /proc/interrupts is read at most this often */
+#define INTR_TOP_N 10
+#define INTR_GONE_SAMPLES 4 /* missing this many in a row, the nodes go */
+
+typedef struct {
+    gchar *id;      /* "17", "LOC", "IPI0", ... */
+    gchar *desc;    /* chip, hwirq, trigger, actions */
+    int row;        /* in the count matrix */
+    guint64 total;  /* all cpus */
+    double rate;
+    cpubits *active; /* cpus with a count since the last sample */
+    gboolean present; /* was in the last sample */
+    int absent;       /* samples in a row it wasn't */
+} intr_irq;
+
+/* the counts are a rows x ncols matrix, one row per irq,
+ * one column per cpu in the /proc/interrupts header */
+static struct {
+    GMutex lock;
+    gchar *path_fs;
+    gint64 last;
+    int ncols;
+    int *col_cpu;        /* column -> cpu number */
+    GHashTable *index;   /* id -> intr_irq */
+    GPtrArray *irqs;     /* row -> intr_irq, NULL for a free row */
+    GArray *free_rows;   /* int, from irqs that went away, like MSI */
+    int rows_alloc;
+    guint64 *cur, *prev;
+    guint64 *cpu_total;  /* per column */
+    double *cpu_rate;
+    cpubits *cpu_nodes;  /* cpus that have nodes */
+} intr;
+
+static gchar *intr_irq_read(const gchar *path);
+static gchar *intr_cpu_read(const gchar *path);
+
+static const gchar *irq_fields[] = {
+    "total", "rate", "desc", "active_cpus", "affinity", "effective_affinity",
+};
+static const gchar *cpu_fields[] = { "total", "rate" };
+
+static void intr_irq_free(intr_irq *irq) {
+    if (!irq) return;
+    g_free(irq->id);
+    g_free(irq->desc);
+    free(irq->active);
+    g_free(irq);
+}
+
+static void intr_irq_add_nodes(const gchar *id) {
+    sysobj_virt_batch *b = sysobj_virt_batch_new(FALSE);
+    gchar *base = g_strdup_printf(INTR_ROOT "/irq/%s", id);
+    /* only numbered irqs are in /proc/irq */
+    int nf = isdigit((unsigned char)*id) ? (int)G_N_ELEMENTS(irq_fields) : 4;
+    sysobj_virt_batch_add_simple(b, base, NULL, "*", VSO_TYPE_DIR);
+    for (int i = 0; i < nf; i++) {
+        sysobj_virt *vo = sysobj_virt_new();
+        vo->path = g_strdup_printf("%s/%s", base, irq_fields[i]);
+        vo->type = VSO_TYPE_STRING;
+        vo->f_get_data = intr_irq_read;
+        sysobj_virt_batch_add(b, vo);
+    }
+    sysobj_virt_batch_commit(b);
+    g_free(base);
+}
+
+static void intr_cpu_add_nodes(int cpu) {
+    sysobj_virt_batch *b = sysobj_virt_batch_new(FALSE);
+    gchar *base = g_strdup_printf(INTR_ROOT "/cpu/cpu%d", cpu);
+    gchar *cpu_path = g_strdup_printf("/sys/devices/system/cpu/cpu%d", cpu);
+    sysobj_virt_batch_add_simple(b, base, NULL, "*", VSO_TYPE_DIR);
+    sysobj_virt_batch_add_simple(b, base, "cpu", cpu_path, VSO_TYPE_SYMLINK | VSO_TYPE_AUTOLINK | VSO_TYPE_DYN);
+    for (int i = 0; i < (int)G_N_ELEMENTS(cpu_fields); i++) {
+        sysobj_virt *vo = sysobj_virt_new();
+        vo->path = g_strdup_printf("%s/%s", base, cpu_fields[i]);
+        vo->type = VSO_TYPE_STRING;
+        vo->f_get_data = intr_cpu_read;
+        sysobj_virt_batch_add(b, vo);
+    }
+    sysobj_virt_batch_commit(b);
+    g_free(cpu_path);
+    g_free(base);
+}
+
+/* the header is the online cpus, "CPU0 CPU1 CPU3 ...".
+ * FALSE if the columns changed, requires intr.lock */
+static gboolean intr_header(gchar *line) {
+    int ncols = 0, max_cpu = -1;
+    for (gchar *p = strstr(line, "CPU"); p; p = strstr(p + 3, "CPU"))
+        ncols++;
+
+    int *col_cpu = g_new0(int, ncols ? ncols : 1);
+    int c = 0;
+    for (gchar *p = strstr(line, "CPU"); p; p = strstr(p + 3, "CPU")) {
+        col_cpu[c] = atoi(p + 3);
+        max_cpu = MAX(max_cpu, col_cpu[c]);
+        c++;
+    }
+
+    if (ncols == intr.ncols && !memcmp(col_cpu, intr.col_cpu, ncols * sizeof(int)) ) {
+        g_free(col_cpu);
+        return TRUE;
+    }
+
+    /* cpus went on or offline, start over */
+    g_free(intr.col_cpu);
+    intr.col_cpu = col_cpu;
+    intr.ncols = ncols;
+    gsize cells = (gsize)intr.rows_alloc * ncols;
+    intr.cur = g_renew(guint64, intr.cur, cells ? cells : 1);
+    intr.prev = g_renew(guint64, intr.prev, cells ? cells : 1);
+    memset(intr.prev, 0, cells * sizeof(guint64));
+    intr.cpu_total = g_renew(guint64, intr.cpu_total, ncols ? ncols : 1);
+    intr.cpu_rate = g_renew(double, intr.cpu_rate, ncols ? ncols : 1);
+    memset(intr.cpu_rate, 0, ncols * sizeof(double));
+
+    if (max_cpu >= CPUBITS_NBITS(intr.cpu_nodes)) {
+        cpubits *more = cpubits_new(max_cpu + 1);
+        cpubits *grown = cpubits_or(intr.cpu_nodes, more);
+        free(intr.cpu_nodes);
+        free(more);
+        intr.cpu_nodes = grown;
+    }
+    return FALSE;
+}
+
+/* requires intr.lock */
+static intr_irq *intr_irq_new(const gchar *id) {
+    intr_irq *irq = g_new0(intr_irq, 1);
+    irq->id = g_strdup(id);
+    g_hash_table_insert(intr.index, irq->id, irq);
+    if (intr.free_rows->len) {
+        irq->row = g_array_index(intr.free_rows, int, intr.free_rows->len - 1);
+        g_array_set_size(intr.free_rows, intr.free_rows->len - 1);
+        g_ptr_array_index(intr.irqs, irq->row) = irq;
+        return irq;
+    }
+    irq->row = intr.irqs->len;
+    g_ptr_array_add(intr.irqs, irq);
+
+    if (irq->row >= intr.rows_alloc) {
+        int old = intr.rows_alloc;
+        intr.rows_alloc = old ? old * 2 : 64;
+        gsize cells = (gsize)intr.rows_alloc * intr.ncols;
+        intr.cur = g_renew(guint64, intr.cur, cells ? cells : 1);
+        intr.prev = g_renew(guint64, intr.prev, cells ? cells : 1);
+        memset(intr.prev + (gsize)old * intr.ncols, 0,
+            (gsize)(intr.rows_alloc - old) * intr.ncols * sizeof(guint64));
+    }
+    return irq;
+}
+
+/* squeeze the column padding out of the description, in place */
+static gchar *intr_desc(gchar *s) {
+    gchar *d = s, *ret = s;
+    gboolean space = FALSE;
+    for (; *s; s++) {
+        if (isspace((unsigned char)*s)) {
+            space = (d != ret);
+            continue;
+        }
+        if (space) *d++ = ' ';
+        space = FALSE;
+        *d++ = *s;
+    }
+    *d = 0;
+    return ret;
+}
+
+/* one pass over /proc/interrupts, parsed in place into the
+ * count matrix; the rates are from the previous sample, or
+ * since boot for the first.
+ * New irqs and cpus are returned for nodes, and irqs that have
+ * been gone a while for removing them, requires intr.lock. */
+static void intr_sample_locked(GSList **new_irqs, GSList **new_cpus, GSList **gone_irqs) {
+    gchar *data = NULL;
+    gg_file_get_contents_non_blocking(intr.path_fs, &data, NULL, NULL);
+    if (!data) return;
+
+    gboolean first = !intr.last;
+    double dt = util_sample_dt(&intr.last);
+
+    gchar *next = strchr(data, '\n');
+    if (next) *next++ = 0;
+    gboolean same_cpus = intr_header(data);
+    int ncols = intr.ncols;
+
+    for (int c = 0; c < ncols; c++) {
+        int cpu = intr.col_cpu[c];
+        if (!CPUBIT_GET(intr.cpu_nodes, cpu)) {
+            CPUBIT_SET(intr.cpu_nodes, cpu);
+            *new_cpus = g_slist_prepend(*new_cpus, GINT_TO_POINTER(cpu));
+        }
+    }
+
+    /* a row is new if it wasn't in the previous sample,
+     * only those with a previous get a rate */
+    guint8 *had_prev = g_new0(guint8, intr.rows_alloc + 1);
+    for (guint i = 0; i < intr.irqs->len; i++) {
+        intr_irq *irq = g_ptr_array_index(intr.irqs, i);
+        if (!irq) continue;
+        had_prev[i] = irq->present;
+        irq->present = FALSE;
+    }
+
+    while (next) {
+        gchar *line = next;
+        next = strchr(line, '\n');
+        if (next) *next++ = 0;
+
+        while (isspace((unsigned char)*line)) line++;
+        gchar *colon = strchr(line, ':');
+        if (!colon || colon == line) continue;
+        *colon = 0;
+
+        intr_irq *irq = g_hash_table_lookup(intr.index, line);
+        gboolean seen = (irq != NULL);
+        if (!irq) {
+            irq = intr_irq_new(line);
+            had_prev = g_renew(guint8, had_prev, intr.rows_alloc + 1);
+            *new_irqs = g_slist_prepend(*new_irqs, g_strdup(line));
+        }
+        /* missing from the last sample, its prev row is stale */
+        had_prev[irq->row] = (seen && same_cpus && had_prev[irq->row]) || first;
+        irq->present = TRUE;
+        irq->absent = 0;
+
+        /* ERR, MIS, ... have one count, not one per cpu */
+        guint64 *v = intr.cur + (gsize)irq->row * ncols;
+        gchar *p = colon + 1, *end = NULL;
+        int c = 0;
+        for (; c < ncols; c++) {
+            v[c] = g_ascii_strtoull(p, &end, 10);
+            if (end == p) break;
+            p = end;
+        }
+        for (; c < ncols; c++)
+            v[c] = 0;
+
+        gchar *desc = intr_desc(p);
+        if (g_strcmp0(desc, irq->desc) ) {
+            g_free(irq->desc);
+            irq->desc = g_strdup(desc);
+        }
+    }
+    g_free(data);
+
+    memset(intr.cpu_total, 0, ncols * sizeof(guint64));
+    if (dt > 0)
+        memset(intr.cpu_rate, 0, ncols * sizeof(double));
+    for (guint i = 0; i < intr.irqs->len; i++) {
+        intr_irq *irq = g_ptr_array_index(intr.irqs, i);
+        if (!irq) continue;
+        if (!irq->present) {
+            if (++irq->absent >= INTR_GONE_SAMPLES) {
+                *gone_irqs = g_slist_prepend(*gone_irqs, g_strdup(irq->id));
+                g_hash_table_remove(intr.index, irq->id);
+                g_ptr_array_index(intr.irqs, i) = NULL;
+                g_array_append_val(intr.free_rows, irq->row);
+                intr_irq_free(irq);
+            }
+            continue;
+        }
+        const guint64 *v = intr.cur + (gsize)irq->row * ncols;
+        const guint64 *pv = intr.prev + (gsize)irq->row * ncols;
+        guint64 total = 0, delta = 0;
+        if (!irq->active || CPUBITS_NBITS(irq->active) < CPUBITS_NBITS(intr.cpu_nodes)) {
+            free(irq->active);
+            irq->active = cpubits_new(CPUBITS_NBITS(intr.cpu_nodes));
+        } else
+            CPUBITS_CLEAR(irq->active);
+        for (int c = 0; c < ncols; c++) {
+            total += v[c];
+            intr.cpu_total[c] += v[c];
+            if (!had_prev[irq->row]) continue;
+            guint64 d = util_counter32_delta(v[c], pv[c]);
+            delta += d;
+            if (d) CPUBIT_SET(irq->active, intr.col_cpu[c]);
+            if (dt > 0) intr.cpu_rate[c] += d / dt;
+        }
+        irq->total = total;
+        irq->rate = (dt > 0) ? delta / dt : 0;
+    }
+    g_free(had_prev);
+
+    guint64 *t = intr.prev;
+    intr.prev = intr.cur;
+    intr.cur = t;
+}
+
+static void intr_update() {
+    GSList *new_irqs = NULL, *new_cpus = NULL, *gone_irqs = NULL;
+    g_mutex_lock(&intr.lock);
+    if (intr.path_fs
+        && (g_get_monotonic_time() - intr.last) >= INTR_INTERVAL * G_USEC_PER_SEC)
+        intr_sample_locked(&new_irqs, &new_cpus, &gone_irqs);
+    g_mutex_unlock(&intr.lock);
+
+    for (GSList *l = gone_irqs; l; l = l->next) {
+        gchar *glob = g_strdup_printf(INTR_ROOT "/irq/%s", (gchar*)l->data);
+        sysobj_virt_remove(glob);
+        glob = appf(glob, "", "/*");
+        sysobj_virt_remove(glob);
+        g_free(glob);
+    }
+    g_slist_free_full(gone_irqs, g_free);
+
+    new_irqs = g_slist_reverse(new_irqs);
+    for (GSList *l = new_irqs; l; l = l->next)
+        intr_irq_add_nodes(l->data);
+    for (GSList *l = new_cpus; l; l = l->next)
+        intr_cpu_add_nodes(GPOINTER_TO_INT(l->data));
+    g_slist_free_full(new_irqs, g_free);
+    g_slist_free(new_cpus);
+}
+
+/* /proc/irq/<id>/<file> list, normalized through cpubits */
+static gchar *intr_affinity(const gchar *id, const gchar *file) {
+    gchar *ret = NULL;
+    gchar *fn = g_strdup_printf("/proc/irq/%s/%s", id, file);
+    gchar *list = sysobj_raw_from_fn(fn, NULL);
+    if (list) {
+        cpubits *b = cpubits_from_str(g_strstrip(list));
+        if (b) {
+            char *s = cpubits_to_str(b, NULL, 0);
+            ret = g_strdup(s);
+            free(s);
+            free(b);
+        }
+    }
+    g_free(list);
+    g_free(fn);
+    return ret;
+}
+
+static gchar *intr_irq_read(const gchar *path) {
+    gchar *ret = NULL;
+    gchar *field = g_path_get_basename(path);
+    gchar *irq_path = g_path_get_dirname(path);
+    gchar *id = g_path_get_basename(irq_path);
+
+    if (SEQ(field, "affinity"))
+        ret = intr_affinity(id, "smp_affinity_list");
+    else if (SEQ(field, "effective_affinity"))
+        ret = intr_affinity(id, "effective_affinity_list");
+    else {
+        intr_update();
+        g_mutex_lock(&intr.lock);
+        intr_irq *irq = intr.index ? g_hash_table_lookup(intr.index, id) : NULL;
+        if (irq && irq->present) {
+            if (SEQ(field, "total"))
+                ret = g_strdup_printf("%" G_GUINT64_FORMAT, irq->total);
+            else if (SEQ(field, "rate"))
+                ret = g_strdup_printf("%.1lf", irq->rate);
+            else if (SEQ(field, "desc"))
+                ret = g_strdup(irq->desc);
+            else if (SEQ(field, "active_cpus") && irq->active) {
+                char *s = cpubits_to_str(irq->active, NULL, 0);
+                ret = g_strdup(s);
+                free(s);
+            }
+        }
+        g_mutex_unlock(&intr.lock);
+    }
+
+    g_free(field);
+    g_free(irq_path);
+    g_free(id);
+    return ret;
+}
+
+static gchar *intr_cpu_read(const gchar *path) {
+    gchar *ret = NULL;
+    gchar *field = g_path_get_basename(path);
+    gchar *cpu_path = g_path_get_dirname(path);
+    gchar *cpu_name = g_path_get_basename(cpu_path);
+    int cpu = atoi(cpu_name + 3); /* cpuN */
+
+    intr_update();
+    g_mutex_lock(&intr.lock);
+    for (int c = 0; c < intr.ncols; c++) {
+        if (intr.col_cpu[c] != cpu) continue;
+        if (SEQ(field, "total"))
+            ret = g_strdup_printf("%" G_GUINT64_FORMAT, intr.cpu_total[c]);
+        else if (SEQ(field, "rate"))
+            ret = g_strdup_printf("%.1lf", intr.cpu_rate[c]);
+        break;
+    }
+    g_mutex_unlock(&intr.lock);
+
+    g_free(field);
+    g_free(cpu_path);
+    g_free(cpu_name);
+    return ret;
+}
+
+static gint intr_rate_cmp(gconstpointer a, gconstpointer b) {
+    const intr_irq *ia = *(intr_irq**)a, *ib = *(intr_irq**)b;
+    if (ia->rate != ib->rate)
+        return (ia->rate < ib->rate) ? 1 : -1;
+    return ia->row - ib->row;
+}
+
+/* "id rate desc" lines, hottest first */
+static gchar *intr_top_read(const gchar *path) {
+    gchar *ret = NULL;
+    intr_update();
+    g_mutex_lock(&intr.lock);
+    if (intr.irqs) {
+        GPtrArray *hot = g_ptr_array_new();
+        for (guint i = 0; i < intr.irqs->len; i++) {
+            intr_irq *irq = g_ptr_array_index(intr.irqs, i);
+            if (irq && irq->present && irq->rate > 0)
+                g_ptr_array_add(hot, irq);
+        }
+        g_ptr_array_sort(hot, intr_rate_cmp);
+        ret = g_strdup("");
+        for (guint i = 0; i < hot->len && i < INTR_TOP_N; i++) {
+            intr_irq *irq = g_ptr_array_index(hot, i);
+            ret = appfnl(ret, "%s %.1lf %s", irq->id, irq->rate, irq->desc ? irq->desc : "");
+        }
+        g_ptr_array_free(hot, TRUE);
+    }
+    g_mutex_unlock(&intr.lock);
+    return ret;
+}
+
+static gchar *intr_root(const gchar *path) {
+    if (!path) {
+        /* cleanup */
+        g_mutex_lock(&intr.lock);
+        if (intr.index)
+            g_hash_table_destroy(intr.index);
+        if (intr.irqs)
+            g_ptr_array_free(intr.irqs, TRUE);
+        if (intr.free_rows)
+            g_array_free(intr.free_rows, TRUE);
+        g_free(intr.path_fs);
+        g_free(intr.col_cpu);
+        g_free(intr.cur);
+        g_free(intr.prev);
+        g_free(intr.cpu_total);
+        g_free(intr.cpu_rate);
+        free(intr.cpu_nodes);
+        intr.index = NULL;
+        intr.irqs = NULL;
+        intr.free_rows = NULL;
+        intr.path_fs = NULL;
+        intr.col_cpu = NULL;
+        intr.cur = intr.prev = intr.cpu_total = NULL;
+        intr.cpu_rate = NULL;
+        intr.cpu_nodes = NULL;
+        intr.ncols = intr.rows_alloc = 0;
+        intr.last = 0;
+        g_mutex_unlock(&intr.lock);
+        return NULL;
+    }
+    return NULL; /* auto dir */
+}
+
+static sysobj_virt vol[] = {
+    { .path = INTR_ROOT, .str = "*",
+      .f_get_data = intr_root,
+      .type = VSO_TYPE_DIR | VSO_TYPE_CONST | VSO_TYPE_CLEANUP },
+    { .path = INTR_ROOT "/irq", .str = "*",
+      .type = VSO_TYPE_DIR | VSO_TYPE_CONST },
+    { .path = INTR_ROOT "/cpu", .str = "*",
+      .type = VSO_TYPE_DIR | VSO_TYPE_CONST },
+    { .path = INTR_ROOT "/top", .str = "",
+      .f_get_data = intr_top_read,
+      .type = VSO_TYPE_STRING | VSO_TYPE_CONST },
+};
+
+void gen_interrupts() {
+    sysobj *obj = sysobj_new_fast(PROC_INTERRUPTS);
+    if (!obj->exists) {
+        sysobj_free(obj);
+        return;
+    }
+
+    for (int i = 0; i < (int)G_N_ELEMENTS(vol); i++)
+        sysobj_virt_add(&vol[i]);
+
+    g_mutex_lock(&intr.lock);
+    intr.path_fs = g_strdup(obj->path_fs);
+    intr.index = g_hash_table_new(g_str_hash, g_str_equal);
+    intr.irqs = g_ptr_array_new_with_free_func((GDestroyNotify)intr_irq_free);
+    intr.free_rows = g_array_new(FALSE, FALSE, sizeof(int));
+    intr.cpu_nodes = cpubits_new(64);
+    g_mutex_unlock(&intr.lock);
+    sysobj_free(obj);
+
+    intr_update();
+}
@@ -0,0 +1,274 @@
+/*
+ * sysobj - https://github.com/bp0/verbose-spork
+ * Copyright (C) 2018  Burt P. <pburt0@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+/* Generator for network interface rates from /proc/net/dev,
+ * one read for every interface instead of each statistics/ file
+ *  :/net_io
+ */
+#include "sysobj.h"
+#include "gg_file.h"
+#include "uevent.h"
+
+#define PROC_NET_DEV "/proc/net/dev"
+#define NET_IO_ROOT ":/net_io"
+#define NET_IO_INTERVAL 0.5 /* seconds, /proc/net/dev is read at most this often */
+
+/* the columns of /proc/net/dev */
+enum {
+    ND_RX_BYTES, ND_RX_PACKETS, ND_RX_ERRS, ND_RX_DROP, ND_RX_FIFO, ND_RX_FRAME, ND_RX_COMPRESSED, ND_RX_MULTICAST,
+    ND_TX_BYTES, ND_TX_PACKETS, ND_TX_ERRS, ND_TX_DROP, ND_TX_FIFO, ND_TX_COLLS, ND_TX_CARRIER, ND_TX_COMPRESSED,
+    ND_FIELDS
+};
+
+/* the rates and the column each is from */
+static const struct {
+    const gchar *name;
+    int col;
+} net_io_rates[] = {
+    { "rx_bytes_per_sec", ND_RX_BYTES },
+    { "rx_packets_per_sec", ND_RX_PACKETS },
+    { "rx_errors_per_sec", ND_RX_ERRS },
+    { "rx_dropped_per_sec", ND_RX_DROP },
+    { "rx_multicast_per_sec", ND_RX_MULTICAST },
+    { "tx_bytes_per_sec", ND_TX_BYTES },
+    { "tx_packets_per_sec", ND_TX_PACKETS },
+    { "tx_errors_per_sec", ND_TX_ERRS },
+    { "tx_dropped_per_sec", ND_TX_DROP },
+    { "collisions_per_sec", ND_TX_COLLS },
+};
+#define NET_IO_RATES ((int)G_N_ELEMENTS(net_io_rates))
+
+typedef struct {
+    gchar *name;
+    guint64 prev[ND_FIELDS];
+    double rate[NET_IO_RATES];
+    gboolean present; /* was in the last sample */
+    gboolean fresh;   /* not sampled yet, prev isn't set */
+} net_io;
+
+static struct {
+    GMutex lock;
+    gchar *path_fs;
+    gint64 last;
+    GHashTable *ifs; /* name -> net_io */
+} nio;
+
+static gchar *net_io_read(const gchar *path);
+
+static void net_io_free(net_io *n) {
+    g_free(n->name);
+    g_free(n);
+}
+
+/* requires nio.lock */
+static net_io *net_io_new(const gchar *name) {
+    net_io *n = g_new0(net_io, 1);
+    n->name = g_strdup(name);
+    n->fresh = TRUE;
+    g_hash_table_insert(nio.ifs, n->name, n);
+    return n;
+}
+
+static void net_io_add_nodes(const gchar *name) {
+    sysobj_virt_batch *b = sysobj_virt_batch_new(FALSE);
+    gchar *base = g_strdup_printf(NET_IO_ROOT "/%s", name);
+    gchar *if_path = g_strdup_printf("/sys/class/net/%s", name);
+    sysobj_virt_batch_add_simple(b, base, NULL, "*", VSO_TYPE_DIR);
+    sysobj_virt_batch_add_simple(b, base, "net", if_path, VSO_TYPE_SYMLINK | VSO_TYPE_AUTOLINK | VSO_TYPE_DYN);
+    for (int i = 0; i < NET_IO_RATES; i++) {
+        sysobj_virt *vo = sysobj_virt_new();
+        vo->path = g_strdup_printf("%s/%s", base, net_io_rates[i].name);
+        vo->type = VSO_TYPE_STRING;
+        vo->f_get_data = net_io_read;
+        sysobj_virt_batch_add(b, vo);
+    }
+    sysobj_virt_batch_commit(b);
+    g_free(if_path);
+    g_free(base);
+}
+
+/* one read of /proc/net/dev for every interface, the rates are from
+ * the previous sample, or since boot for the first.
+ * Returns the names of interfaces not seen before, requires nio.lock. */
+static GSList *net_io_sample_locked() {
+    GSList *new_ifs = NULL;
+    gchar *data = NULL;
+
+    gg_file_get_contents_non_blocking(nio.path_fs, &data, NULL, NULL);
+    if (!data) return NULL;
+
+    gboolean first = !nio.last;
+    double dt = util_sample_dt(&nio.last);
+
+    GHashTableIter iter;
+    gpointer value;
+    g_hash_table_iter_init(&iter, nio.ifs);
+    while (g_hash_table_iter_next(&iter, NULL, &value))
+        ((net_io*)value)->present = FALSE;
+
+    gchar *next = data;
+    while (next) {
+        gchar *line = next;
+        next = strchr(line, '\n');
+        if (next) *next++ = 0;
+        /* the two header lines have no ':' */
+        gchar *colon = strchr(line, ':');
+        if (!colon) continue;
+        *colon = 0;
+        gchar *name = g_strstrip(line);
+        if (!*name) continue;
+
+        guint64 v[ND_FIELDS] = {};
+        const gchar *p = colon + 1;
+        for (int i = 0; i < ND_FIELDS; i++) {
+            gchar *end = NULL;
+            v[i] = g_ascii_strtoull(p, &end, 10);
+            if (end == p) break;
+            p = end;
+        }
+
+        net_io *n = g_hash_table_lookup(nio.ifs, name);
+        if (!n) {
+            n = net_io_new(name);
+            new_ifs = g_slist_prepend(new_ifs, g_strdup(name));
+        }
+        n->present = TRUE;
+
+        /* one that appeared since the last sample has no
+         * previous to compare, the counters aren't since boot */
+        if (dt > 0 && (first || !n->fresh) )
+            for (int i = 0; i < NET_IO_RATES; i++) {
+                int c = net_io_rates[i].col;
+                n->rate[i] = util_counter_delta(v[c], n->prev[c]) / dt;
+            }
+        memcpy(n->prev, v, sizeof(v));
+        n->fresh = FALSE;
+    }
+    g_free(data);
+    return new_ifs;
+}
+
+/* force = TRUE: sample now, even if the last was just now */
+static void net_io_update(gboolean force) {
+    GSList *new_ifs = NULL;
+    g_mutex_lock(&nio.lock);
+    if (nio.path_fs
+        && (force || (g_get_monotonic_time() - nio.last) >= NET_IO_INTERVAL * G_USEC_PER_SEC) )
+        new_ifs = net_io_sample_locked();
+    g_mutex_unlock(&nio.lock);
+
+    for (GSList *l = new_ifs; l; l = l->next)
+        net_io_add_nodes(l->data);
+    g_slist_free_full(new_ifs, g_free);
+}
+
+static gchar *net_io_read(const gchar *path) {
+    gchar *ret = NULL;
+    gchar *field = g_path_get_basename(path);
+    gchar *if_path = g_path_get_dirname(path);
+    gchar *ifname = g_path_get_basename(if_path);
+
+    net_io_update(FALSE);
+    g_mutex_lock(&nio.lock);
+    net_io *n = nio.ifs ? g_hash_table_lookup(nio.ifs, ifname) : NULL;
+    if (n && n->present) {
+        for (int i = 0; i < NET_IO_RATES; i++)
+            if (SEQ(field, net_io_rates[i].name) ) {
+                ret = g_strdup_printf("%.1lf", n->rate[i]);
+                break;
+            }
+    }
+    g_mutex_unlock(&nio.lock);
+
+    g_free(field);
+    g_free(if_path);
+    g_free(ifname);
+    return ret;
+}
+
+static void net_io_uevent(const uevent *ev, gpointer user_data) {
+    if (uevent_is(ev, "add")) {
+        /* only this one, sampling them all now would make the
+         * interval for the rest however long since the last read;
+         * it has rates of 0 until the next sample has a previous */
+        net_io *n = NULL;
+        g_mutex_lock(&nio.lock);
+        if (nio.ifs && !g_hash_table_contains(nio.ifs, ev->name) ) {
+            n = net_io_new(ev->name);
+            n->present = TRUE;
+        }
+        g_mutex_unlock(&nio.lock);
+        if (n)
+            net_io_add_nodes(ev->name);
+    } else if (uevent_is(ev, "remove")) {
+        g_mutex_lock(&nio.lock);
+        if (nio.ifs)
+            g_hash_table_remove(nio.ifs, ev->name);
+        g_mutex_unlock(&nio.lock);
+
+        gchar *glob = g_strdup_printf(NET_IO_ROOT "/%s", ev->name);
+        sysobj_virt_remove(glob);
+        glob = appf(glob, "", "/*");
+        sysobj_virt_remove(glob);
+        g_free(glob);
+    }
+}
+
+static gchar *net_io_root(const gchar *path) {
+    if (!path) {
+        /* cleanup */
+        g_mutex_lock(&nio.lock);
+        if (nio.ifs)
+            g_hash_table_destroy(nio.ifs);
+        nio.ifs = NULL;
+        g_free(nio.path_fs);
+        nio.path_fs = NULL;
+        nio.last = 0;
+        g_mutex_unlock(&nio.lock);
+        return NULL;
+    }
+    return NULL; /* auto dir */
+}
+
+static sysobj_virt vol[] = {
+    { .path = NET_IO_ROOT, .str = "*",
+      .f_get_data = net_io_root,
+      .type = VSO_TYPE_DIR | VSO_TYPE_CONST | VSO_TYPE_CLEANUP },
+};
+
+void gen_net_io() {
+    sysobj *obj = sysobj_new_fast(PROC_NET_DEV);
+    if (!obj->exists) {
+        sysobj_free(obj);
+        return;
+    }
+
+    for (int i = 0; i < (int)G_N_ELEMENTS(vol); i++)
+        sysobj_virt_add(&vol[i]);
+
+    g_mutex_lock(&nio.lock);
+    nio.path_fs = g_strdup(obj->path_fs);
+    nio.ifs = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, (GDestroyNotify)net_io_free);
+    g_mutex_unlock(&nio.lock);
+    sysobj_free(obj);
+
+    net_io_update(TRUE);
+    uevent_handler_add("net", net_io_uevent, NULL);
+}
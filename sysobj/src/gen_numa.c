@@ -0,0 +1,296 @@
+/*
+ * sysobj - https://github.com/bp0/verbose-spork
+ * Copyright (C) 2018  Burt P. <pburt0@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+/* Generator for a summary of each NUMA node and the distance matrix
+ *  :/numa
+ */
+#include "sysobj.h"
+#include "gg_file.h"
+#include "cpubits.h"
+#include "uevent.h"
+
+#define NODE_ROOT "/sys/devices/system/node"
+#define NUMA_ROOT ":/numa"
+#define NUMA_INTERVAL 1.0 /* seconds, a node's meminfo and numastat are read at most this often */
+
+/* from node<N>/meminfo, "Node N Key: value [kB]" */
+static const gchar *mem_keys[] = {
+    "MemTotal", "MemFree", "MemUsed", "FilePages", "AnonPages",
+    "HugePages_Total", "HugePages_Free",
+};
+static const gchar *mem_names[] = {
+    "mem_total", "mem_free", "mem_used", "file", "anon",
+    "hugepages_total", "hugepages_free",
+};
+#define NM_FIELDS ((int)G_N_ELEMENTS(mem_keys))
+
+/* from node<N>/numastat, "key value" */
+static const gchar *stat_keys[] = {
+    "numa_hit", "numa_miss", "numa_foreign",
+    "interleave_hit", "local_node", "other_node",
+};
+#define NS_FIELDS ((int)G_N_ELEMENTS(stat_keys))
+
+typedef struct {
+    int id;
+    gchar *meminfo_fs;
+    gchar *numastat_fs;
+    cpubits *cpus;
+    guint64 mem[NM_FIELDS];
+    guint64 stat[NS_FIELDS];
+    gint64 last; /* monotonic usec */
+} numa_node;
+
+static struct {
+    GMutex lock;
+    GPtrArray *nodes; /* by id */
+    int *distance;    /* nodes->len x nodes->len */
+} numa;
+
+static gchar *numa_node_read(const gchar *path);
+static gchar *numa_distance_read(const gchar *path);
+
+static void numa_node_free(numa_node *n) {
+    g_free(n->meminfo_fs);
+    g_free(n->numastat_fs);
+    free(n->cpus);
+    g_free(n);
+}
+
+static gint numa_node_cmp(gconstpointer a, gconstpointer b) {
+    return (*(numa_node**)a)->id - (*(numa_node**)b)->id;
+}
+
+/* the dynamic counters, one read of each file.
+ * requires numa.lock */
+static void numa_node_update(numa_node *n) {
+    gchar *data = NULL;
+    gg_file_get_contents_non_blocking(n->meminfo_fs, &data, NULL, NULL);
+    if (data)
+        util_key_table_scan(data, 2, mem_keys, NM_FIELDS, n->mem);
+    g_free(data);
+    data = NULL;
+    gg_file_get_contents_non_blocking(n->numastat_fs, &data, NULL, NULL);
+    if (data)
+        util_key_table_scan(data, 0, stat_keys, NS_FIELDS, n->stat);
+    g_free(data);
+    n->last = g_get_monotonic_time();
+}
+
+/* requires numa.lock */
+static void numa_node_cpus(numa_node *n) {
+    gchar *node_path = g_strdup_printf(NODE_ROOT "/node%d", n->id);
+    gchar *list = sysobj_raw_from_fn(node_path, "cpulist");
+    free(n->cpus);
+    n->cpus = list ? cpubits_from_str(g_strstrip(list)) : NULL;
+    g_free(list);
+    g_free(node_path);
+}
+
+/* index in numa.nodes, or -1. requires numa.lock */
+static int numa_find(int id) {
+    for (guint i = 0; numa.nodes && i < numa.nodes->len; i++) {
+        numa_node *n = g_ptr_array_index(numa.nodes, i);
+        if (n->id == id) return i;
+    }
+    return -1;
+}
+
+/* export */
+/* read every node's counters now, full = TRUE for the cpu lists too */
+void numa_refresh(gboolean full) {
+    g_mutex_lock(&numa.lock);
+    for (guint i = 0; numa.nodes && i < numa.nodes->len; i++) {
+        numa_node *n = g_ptr_array_index(numa.nodes, i);
+        if (full)
+            numa_node_cpus(n);
+        numa_node_update(n);
+    }
+    g_mutex_unlock(&numa.lock);
+}
+
+static void numa_uevent(const uevent *ev, gpointer user_data) {
+    if (uevent_is(ev, "change"))
+        return;
+    /* a cpu went online or offline */
+    numa_refresh(TRUE);
+}
+
+static gchar *numa_node_read(const gchar *path) {
+    gchar *ret = NULL;
+    gchar *field = g_path_get_basename(path);
+    gchar *node_path = g_path_get_dirname(path);
+    gchar *node_name = g_path_get_basename(node_path);
+    int id = util_get_did(node_name, "node");
+
+    g_mutex_lock(&numa.lock);
+    int ni = numa_find(id);
+    if (ni >= 0) {
+        numa_node *n = g_ptr_array_index(numa.nodes, ni);
+        if (g_get_monotonic_time() - n->last >= NUMA_INTERVAL * G_USEC_PER_SEC)
+            numa_node_update(n);
+
+        if (SEQ(field, "cpus")) {
+            if (n->cpus) {
+                char *s = cpubits_to_str(n->cpus, NULL, 0);
+                ret = g_strdup(s);
+                free(s);
+            } else
+                ret = g_strdup("");
+        } else if (SEQ(field, "cpu_count"))
+            ret = g_strdup_printf("%u", n->cpus ? cpubits_count(n->cpus) : 0);
+        else if (SEQ(field, "distance")) {
+            int nn = numa.nodes->len;
+            for (int j = 0; j < nn; j++)
+                ret = appfsp(ret, "%d", numa.distance[ni * nn + j]);
+        } else {
+            for (int i = 0; i < NM_FIELDS && !ret; i++)
+                if (SEQ(field, mem_names[i]))
+                    ret = g_strdup_printf("%" G_GUINT64_FORMAT, n->mem[i]);
+            for (int i = 0; i < NS_FIELDS && !ret; i++)
+                if (SEQ(field, stat_keys[i]))
+                    ret = g_strdup_printf("%" G_GUINT64_FORMAT, n->stat[i]);
+        }
+    }
+    g_mutex_unlock(&numa.lock);
+
+    g_free(field);
+    g_free(node_path);
+    g_free(node_name);
+    return ret;
+}
+
+/* the full matrix, a row per node */
+static gchar *numa_distance_read(const gchar *path) {
+    gchar *ret = NULL;
+    g_mutex_lock(&numa.lock);
+    int nn = numa.nodes ? numa.nodes->len : 0;
+    for (int i = 0; i < nn; i++) {
+        gchar *row = NULL;
+        for (int j = 0; j < nn; j++)
+            row = appfsp(row, "%d", numa.distance[i * nn + j]);
+        ret = appfnl(ret, "%s", row);
+        g_free(row);
+    }
+    g_mutex_unlock(&numa.lock);
+    return ret;
+}
+
+static gchar *numa_root(const gchar *path) {
+    if (!path) {
+        /* cleanup */
+        g_mutex_lock(&numa.lock);
+        if (numa.nodes)
+            g_ptr_array_free(numa.nodes, TRUE);
+        numa.nodes = NULL;
+        g_free(numa.distance);
+        numa.distance = NULL;
+        g_mutex_unlock(&numa.lock);
+        return NULL;
+    }
+    return NULL; /* auto dir */
+}
+
+static sysobj_virt vol[] = {
+    { .path = NUMA_ROOT, .str = "*",
+      .f_get_data = numa_root,
+      .type = VSO_TYPE_DIR | VSO_TYPE_CONST | VSO_TYPE_CLEANUP },
+    { .path = NUMA_ROOT "/distance", .str = "",
+      .f_get_data = numa_distance_read,
+      .type = VSO_TYPE_STRING | VSO_TYPE_CONST },
+};
+
+static void numa_add_nodes(numa_node *n, sysobj_virt_batch *b) {
+    static const gchar *fields[] = { "cpus", "cpu_count", "distance" };
+    gchar *base = g_strdup_printf(NUMA_ROOT "/node%d", n->id);
+    gchar *node_path = g_strdup_printf(NODE_ROOT "/node%d", n->id);
+    sysobj_virt_batch_add_simple(b, base, NULL, "*", VSO_TYPE_DIR);
+    sysobj_virt_batch_add_simple(b, base, "node", node_path, VSO_TYPE_SYMLINK | VSO_TYPE_AUTOLINK | VSO_TYPE_DYN);
+    for (int i = 0; i < (int)G_N_ELEMENTS(fields) + NM_FIELDS + NS_FIELDS; i++) {
+        const gchar *name = (i < (int)G_N_ELEMENTS(fields)) ? fields[i]
+            : (i < (int)G_N_ELEMENTS(fields) + NM_FIELDS) ? mem_names[i - G_N_ELEMENTS(fields)]
+            : stat_keys[i - G_N_ELEMENTS(fields) - NM_FIELDS];
+        sysobj_virt *vo = sysobj_virt_new();
+        vo->path = g_strdup_printf("%s/%s", base, name);
+        vo->type = VSO_TYPE_STRING;
+        vo->f_get_data = numa_node_read;
+        sysobj_virt_batch_add(b, vo);
+    }
+    g_free(node_path);
+    g_free(base);
+}
+
+void gen_numa() {
+    sysobj *obj = sysobj_new_fast(NODE_ROOT);
+    if (!obj->exists) {
+        sysobj_free(obj);
+        return;
+    }
+
+    for (int i = 0; i < (int)G_N_ELEMENTS(vol); i++)
+        sysobj_virt_add(&vol[i]);
+
+    g_mutex_lock(&numa.lock);
+    numa.nodes = g_ptr_array_new_with_free_func((GDestroyNotify)numa_node_free);
+    GSList *childs = sysobj_children(obj, "node*", NULL, FALSE);
+    for (GSList *l = childs; l; l = l->next) {
+        int id = util_get_did(l->data, "node");
+        if (id < 0) continue;
+        numa_node *n = g_new0(numa_node, 1);
+        n->id = id;
+        n->meminfo_fs = g_strdup_printf("%s/%s/meminfo", obj->path_fs, (gchar*)l->data);
+        n->numastat_fs = g_strdup_printf("%s/%s/numastat", obj->path_fs, (gchar*)l->data);
+        g_ptr_array_add(numa.nodes, n);
+    }
+    g_slist_free_full(childs, g_free);
+    g_ptr_array_sort(numa.nodes, numa_node_cmp);
+
+    /* distance is a row of every online node, in order */
+    int nn = numa.nodes->len;
+    numa.distance = g_new0(int, nn * nn + 1);
+    for (int i = 0; i < nn; i++) {
+        numa_node *n = g_ptr_array_index(numa.nodes, i);
+        gchar *node_path = g_strdup_printf(NODE_ROOT "/node%d", n->id);
+        gchar *row = sysobj_raw_from_fn(node_path, "distance");
+        const gchar *p = row;
+        for (int j = 0; p && j < nn; j++) {
+            gchar *end = NULL;
+            numa.distance[i * nn + j] = strtol(p, &end, 10);
+            if (end == p) break;
+            p = end;
+        }
+        g_free(row);
+        g_free(node_path);
+
+        numa_node_cpus(n);
+        numa_node_update(n);
+    }
+
+    sysobj_virt_batch *b = sysobj_virt_batch_new(FALSE);
+    sysobj_virt_batch_add_simple(b, NUMA_ROOT "/nodes", NULL, auto_free(g_strdup_printf("%d", nn) ), VSO_TYPE_STRING);
+    for (int i = 0; i < nn; i++)
+        numa_add_nodes(g_ptr_array_index(numa.nodes, i), b);
+    g_mutex_unlock(&numa.lock);
+    sysobj_virt_batch_commit(b);
+    free_auto_free();
+    sysobj_free(obj);
+
+    uevent_handler_add("cpu", numa_uevent, NULL);
+}
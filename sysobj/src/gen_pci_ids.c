@@ -34,66 +34,87 @@
  */
 #include "sysobj.h"
 #include "util_pci.h"
+#include "uevent.h"
+#include "sysobj_cache.h"
 
 #define SYSFS_PCI "/sys/bus/pci"
 
-static void gen_pci_ids_cache_item(util_pci_id *pid) {
+static void gen_pci_ids_cache_item_batch(sysobj_virt_batch *b, util_pci_id *pid) {
     gchar buff[128] = "";
     int dev_symlink_flags = VSO_TYPE_SYMLINK | VSO_TYPE_AUTOLINK | VSO_TYPE_DYN;
     gchar *devpath = g_strdup_printf(SYSFS_PCI "/devices/%s", pid->address);
     if (pid->vendor) {
         sprintf(buff, ":/lookup/pci.ids/%04x", pid->vendor);
-        sysobj_virt_add_simple(buff, NULL, "*", VSO_TYPE_DIR );
+        sysobj_virt_batch_add_simple(b, buff, NULL, "*", VSO_TYPE_DIR );
         if (pid->vendor_str)
-            sysobj_virt_add_simple(buff, "name", pid->vendor_str, VSO_TYPE_STRING );
+            sysobj_virt_batch_add_simple(b, buff, "name", pid->vendor_str, VSO_TYPE_STRING );
         if (pid->address)
-            sysobj_virt_add_simple(buff, pid->address, devpath, dev_symlink_flags );
+            sysobj_virt_batch_add_simple(b, buff, pid->address, devpath, dev_symlink_flags );
     }
     if (pid->device) {
         sprintf(buff, ":/lookup/pci.ids/%04x/%04x", pid->vendor, pid->device);
-        sysobj_virt_add_simple(buff, NULL, "*", VSO_TYPE_DIR );
+        sysobj_virt_batch_add_simple(b, buff, NULL, "*", VSO_TYPE_DIR );
         if (pid->device_str)
-            sysobj_virt_add_simple(buff, "name", pid->device_str, VSO_TYPE_STRING );
+            sysobj_virt_batch_add_simple(b, buff, "name", pid->device_str, VSO_TYPE_STRING );
         if (pid->address)
-            sysobj_virt_add_simple(buff, pid->address, devpath, dev_symlink_flags );
+            sysobj_virt_batch_add_simple(b, buff, pid->address, devpath, dev_symlink_flags );
     }
     if (pid->sub_vendor) {
         sprintf(buff, ":/lookup/pci.ids/%04x/%04x/%04x", pid->vendor, pid->device, pid->sub_vendor);
-        sysobj_virt_add_simple(buff, NULL, "*", VSO_TYPE_DIR );
+        sysobj_virt_batch_add_simple(b, buff, NULL, "*", VSO_TYPE_DIR );
         if (pid->sub_vendor_str)
-            sysobj_virt_add_simple(buff, "name", pid->sub_vendor_str, VSO_TYPE_STRING );
+            sysobj_virt_batch_add_simple(b, buff, "name", pid->sub_vendor_str, VSO_TYPE_STRING );
         if (pid->address)
-            sysobj_virt_add_simple(buff, pid->address, devpath, dev_symlink_flags );
+            sysobj_virt_batch_add_simple(b, buff, pid->address, devpath, dev_symlink_flags );
 
         /* also cache as vendor */
         if (pid->sub_vendor_str) {
             sprintf(buff, ":/lookup/pci.ids/%04x", pid->sub_vendor);
-            sysobj_virt_add_simple(buff, NULL, "*", VSO_TYPE_DIR );
-            sysobj_virt_add_simple(buff, "name", pid->sub_vendor_str, VSO_TYPE_STRING );
+            sysobj_virt_batch_add_simple(b, buff, NULL, "*", VSO_TYPE_DIR );
+            sysobj_virt_batch_add_simple(b, buff, "name", pid->sub_vendor_str, VSO_TYPE_STRING );
         }
     }
     if (pid->sub_device) {
         sprintf(buff, ":/lookup/pci.ids/%04x/%04x/%04x/%04x", pid->vendor, pid->device, pid->sub_vendor, pid->sub_device);
-        sysobj_virt_add_simple(buff, NULL, "*", VSO_TYPE_DIR );
+        sysobj_virt_batch_add_simple(b, buff, NULL, "*", VSO_TYPE_DIR );
         if (pid->sub_device_str)
-            sysobj_virt_add_simple(buff, "name", pid->sub_device_str, VSO_TYPE_STRING );
+            sysobj_virt_batch_add_simple(b, buff, "name", pid->sub_device_str, VSO_TYPE_STRING );
         if (pid->address)
-            sysobj_virt_add_simple(buff, pid->address, devpath, dev_symlink_flags );
+            sysobj_virt_batch_add_simple(b, buff, pid->address, devpath, dev_symlink_flags );
     }
     /* class */
     sprintf(buff, ":/lookup/pci.ids/class/%06x", pid->dev_class);
     #define OR_EMPTY(s) (s ? s : "")
-    sysobj_virt_add_simple(buff, NULL, "*", VSO_TYPE_DIR );
-    sysobj_virt_add_simple(buff, "class", OR_EMPTY(pid->dev_class_str), VSO_TYPE_STRING );
-    sysobj_virt_add_simple(buff, "subclass", OR_EMPTY(pid->dev_subclass_str), VSO_TYPE_STRING );
-    sysobj_virt_add_simple(buff, "progif", OR_EMPTY(pid->dev_progif_str), VSO_TYPE_STRING );
+    sysobj_virt_batch_add_simple(b, buff, NULL, "*", VSO_TYPE_DIR );
+    sysobj_virt_batch_add_simple(b, buff, "class", OR_EMPTY(pid->dev_class_str), VSO_TYPE_STRING );
+    sysobj_virt_batch_add_simple(b, buff, "subclass", OR_EMPTY(pid->dev_subclass_str), VSO_TYPE_STRING );
+    sysobj_virt_batch_add_simple(b, buff, "progif", OR_EMPTY(pid->dev_progif_str), VSO_TYPE_STRING );
     if (pid->address)
-        sysobj_virt_add_simple(buff, pid->address, devpath, dev_symlink_flags );
+        sysobj_virt_batch_add_simple(b, buff, pid->address, devpath, dev_symlink_flags );
     g_free(devpath);
 }
 
+static void gen_pci_ids_cache_item(util_pci_id *pid) {
+    sysobj_virt_batch *b = sysobj_virt_batch_new(FALSE);
+    gen_pci_ids_cache_item_batch(b, pid);
+    sysobj_virt_batch_commit(b);
+}
+
 #define pci_msg(...) /* fprintf (stderr, __VA_ARGS__) */
 
+static util_pci_id *pci_id_from_dev(const gchar *devices_path, const gchar *dev) {
+    util_pci_id *pid = g_new0(util_pci_id, 1);
+    gchar *dev_path = g_strdup_printf("%s/%s", devices_path, dev);
+    pid->address = g_strdup(dev);
+    pid->vendor = sysobj_uint32_from_fn(dev_path, "vendor", 16);
+    pid->device = sysobj_uint32_from_fn(dev_path, "device", 16);
+    pid->sub_vendor = sysobj_uint32_from_fn(dev_path, "subsystem_vendor", 16);
+    pid->sub_device = sysobj_uint32_from_fn(dev_path, "subsystem_device", 16);
+    pid->dev_class = sysobj_uint32_from_fn(dev_path, "class", 16);
+    g_free(dev_path);
+    return pid;
+}
+
 static void pci_scan() {
     GSList *pci_id_list = NULL, *l = NULL;
 
@@ -108,27 +129,19 @@ static void pci_scan() {
     GSList *devs = sysobj_children(obj, NULL, NULL, TRUE);
     for(l = devs; l; l = l->next) {
         gchar *dev = (gchar*)l->data;
-        if (verify_pci_addy(dev) ) {
-            util_pci_id *pid = g_new0(util_pci_id, 1);
-            gchar *dev_path = g_strdup_printf("%s/%s", obj->path, dev);
-            pid->address = g_strdup(dev);
-            pid->vendor = sysobj_uint32_from_fn(dev_path, "vendor", 16);
-            pid->device = sysobj_uint32_from_fn(dev_path, "device", 16);
-            pid->sub_vendor = sysobj_uint32_from_fn(dev_path, "subsystem_vendor", 16);
-            pid->sub_device = sysobj_uint32_from_fn(dev_path, "subsystem_device", 16);
-            pid->dev_class = sysobj_uint32_from_fn(dev_path, "class", 16);
-            pci_id_list = g_slist_append(pci_id_list, pid);
-            g_free(dev_path);
-        }
+        if (verify_pci_addy(dev) )
+            pci_id_list = g_slist_append(pci_id_list, pci_id_from_dev(obj->path, dev) );
     }
     g_slist_free_full(devs, (GDestroyNotify)g_free);
 
     if (pci_id_list) {
         int count = g_slist_length(pci_id_list);
         int found = util_pci_ids_lookup_list(pci_id_list);
+        sysobj_virt_batch *b = sysobj_virt_batch_new(FALSE);
         for(l = pci_id_list; l; l = l->next) {
-            gen_pci_ids_cache_item((util_pci_id*)l->data);
+            gen_pci_ids_cache_item_batch(b, (util_pci_id*)l->data);
         }
+        sysobj_virt_batch_commit(b);
 
         if (found == -1)
             pci_msg("pci.ids file could not be read\n");
@@ -139,6 +152,49 @@ static void pci_scan() {
     g_slist_free_full(pci_id_list, (GDestroyNotify)util_pci_id_free);
 }
 
+/* the names won't change, but the devices present could have
+ * since the cache was saved */
+static gchar *pci_cache_key() {
+    const gchar *data_files[] = { "pci.ids", NULL };
+    gchar *devs = NULL;
+    sysobj *obj = sysobj_new_from_fn(SYSFS_PCI, "devices");
+    GSList *childs = sysobj_children(obj, NULL, NULL, TRUE);
+    for(GSList *l = childs; l; l = l->next)
+        devs = appf(devs, " ", "%s", (gchar*)l->data);
+    g_slist_free_full(childs, (GDestroyNotify)g_free);
+    sysobj_free(obj);
+    gchar *ret = sysobj_cache_key(data_files, devs);
+    g_free(devs);
+    return ret;
+}
+
+/* only the device in the event is looked up or dropped,
+ * instead of pci_scan() again */
+static void pci_uevent(const uevent *ev, gpointer user_data) {
+    if (uevent_is(ev, "rescan")) {
+        pci_scan();
+        return;
+    }
+    if (!verify_pci_addy(ev->name) )
+        return;
+
+    if (uevent_is(ev, "add")) {
+        sysobj *obj = sysobj_new_from_fn(SYSFS_PCI "/devices", ev->name);
+        if (obj->exists) {
+            util_pci_id *pid = pci_id_from_dev(SYSFS_PCI "/devices", ev->name);
+            util_pci_ids_lookup(pid);
+            gen_pci_ids_cache_item(pid);
+            util_pci_id_free(pid);
+        }
+        sysobj_free(obj);
+    } else if (uevent_is(ev, "remove")) {
+        /* the links to it, under vendor, device, ... and class */
+        gchar *glob = g_strdup_printf(":/lookup/pci.ids/*/%s", ev->name);
+        sysobj_virt_remove(glob);
+        g_free(glob);
+    }
+}
+
 static void buff_basename(const gchar *path, gchar *buff, gsize n) {
     gchar *fname = g_path_get_basename(path);
     strncpy(buff, fname, n);
@@ -338,5 +394,11 @@ void gen_pci_ids() {
 
     /* this is not required, but it is more effecient to
      * look the whole list up at once */
-    pci_scan();
+    gchar *key = pci_cache_key();
+    if (!sysobj_cache_restore("pci.ids", key) ) {
+        pci_scan();
+        sysobj_cache_save("pci.ids", key, ":/lookup/pci.ids/*");
+    }
+    g_free(key);
+    uevent_handler_add("pci", pci_uevent, NULL);
 }
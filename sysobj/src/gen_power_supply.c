@@ -0,0 +1,373 @@
+/*
+ * sysobj - https://github.com/bp0/verbose-spork
+ * Copyright (C) 2018  Burt P. <pburt0@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+/* Generator for power, a smoothed power and time estimates for each
+ * battery-like power supply, from one read of its uevent file
+ *  :/power_supply
+ */
+#include "sysobj.h"
+#include "gg_file.h"
+#include "uevent.h"
+
+#define PS_CLASS "/sys/class/power_supply"
+#define PS_ROOT ":/power_supply"
+#define PS_INTERVAL 1.0 /* seconds, a supply's uevent is read at most this often */
+#define PS_EWMA_TAU 60.0 /* seconds, time constant of power_avg */
+
+/* from uevent, POWER_SUPPLY_<key>=<value>, units are uV, uA, uW, uWh, uAh */
+enum {
+    PS_VOLTAGE_NOW, PS_CURRENT_NOW, PS_POWER_NOW,
+    PS_ENERGY_NOW, PS_ENERGY_FULL, PS_CHARGE_NOW, PS_CHARGE_FULL,
+    PS_FIELDS
+};
+static const gchar *ps_keys[] = {
+    "VOLTAGE_NOW", "CURRENT_NOW", "POWER_NOW",
+    "ENERGY_NOW", "ENERGY_FULL", "CHARGE_NOW", "CHARGE_FULL",
+};
+
+static const gchar *ps_values[] = {
+    "power", "power_from", "power_avg", "energy",
+    "time_to_empty", "time_to_full", "status",
+};
+
+typedef struct {
+    gchar *name;
+    gchar *uevent_fs;
+    gchar *status;
+    gint64 last;        /* monotonic usec */
+    double energy;      /* uWh, < 0 if unknown */
+    double energy_full; /* uWh, < 0 if unknown */
+    double energy_mark; /* uWh at the last change seen, < 0 if none yet */
+    gint64 energy_mark_t; /* monotonic usec of that change */
+    double power;       /* uW, < 0 if unknown */
+    const gchar *power_from;
+    double power_avg;   /* uW, < 0 if unknown */
+} ps_supply;
+
+static struct {
+    GMutex lock;
+    GHashTable *supplies; /* name -> ps_supply */
+} ps;
+
+static gchar *ps_read(const gchar *path);
+
+static void ps_supply_free(ps_supply *s) {
+    g_free(s->name);
+    g_free(s->uevent_fs);
+    g_free(s->status);
+    g_free(s);
+}
+
+/* one pass over uevent, returns a bit per field found */
+static int ps_parse(gchar *data, gint64 *v, gchar **status) {
+    int have = 0;
+    gchar *next = data;
+    while (next) {
+        gchar *line = next;
+        next = strchr(line, '\n');
+        if (next) *next++ = 0;
+        if (!g_str_has_prefix(line, "POWER_SUPPLY_")) continue;
+        line += strlen("POWER_SUPPLY_");
+        gchar *eq = strchr(line, '=');
+        if (!eq) continue;
+        *eq = 0;
+        if (SEQ(line, "STATUS")) {
+            g_free(*status);
+            *status = g_strdup(eq + 1);
+            continue;
+        }
+        for (int i = 0; i < PS_FIELDS; i++)
+            if (SEQ(line, ps_keys[i])) {
+                /* some report current_now and power_now negative while discharging */
+                v[i] = ABS(g_ascii_strtoll(eq + 1, NULL, 10));
+                have |= 1 << i;
+                break;
+            }
+    }
+    return have;
+}
+
+/* requires ps.lock */
+static void ps_sample(ps_supply *s) {
+    gchar *data = NULL;
+    gg_file_get_contents_non_blocking(s->uevent_fs, &data, NULL, NULL);
+    if (!data) return;
+
+    gint64 v[PS_FIELDS] = {};
+    gchar *status = NULL;
+    int have = ps_parse(data, v, &status);
+    g_free(data);
+#define HAVE(f) (have & (1 << (f)))
+
+    gint64 now = g_get_monotonic_time();
+    double dt = s->last ? (double)(now - s->last) / G_USEC_PER_SEC : 0;
+    s->last = now;
+
+    /* uAh x uV / 10^6 = uWh */
+    double energy = -1, energy_full = -1;
+    if (HAVE(PS_ENERGY_NOW))
+        energy = v[PS_ENERGY_NOW];
+    else if (HAVE(PS_CHARGE_NOW) && HAVE(PS_VOLTAGE_NOW))
+        energy = (double)v[PS_CHARGE_NOW] * v[PS_VOLTAGE_NOW] / 1000000;
+    if (HAVE(PS_ENERGY_FULL))
+        energy_full = v[PS_ENERGY_FULL];
+    else if (HAVE(PS_CHARGE_FULL) && HAVE(PS_VOLTAGE_NOW))
+        energy_full = (double)v[PS_CHARGE_FULL] * v[PS_VOLTAGE_NOW] / 1000000;
+
+    /* the direction changed, the old average is no help */
+    gboolean turned = (g_strcmp0(status, s->status) != 0);
+    if (turned)
+        s->power_avg = -1;
+
+    /* best first: as reported, from V x I, from the change in energy */
+    double power = -1, power_dt = dt;
+    gboolean measured = TRUE;
+    const gchar *from = NULL;
+    if (HAVE(PS_POWER_NOW)) {
+        power = v[PS_POWER_NOW];
+        from = "power_now";
+    } else if (HAVE(PS_VOLTAGE_NOW) && HAVE(PS_CURRENT_NOW)) {
+        power = (double)v[PS_VOLTAGE_NOW] * v[PS_CURRENT_NOW] / 1000000;
+        from = "voltage_now*current_now";
+    } else if (energy >= 0) {
+        /* the gauge updates every 5 to 60s, so from one change to the
+         * next, and between changes the last power still holds */
+        from = "energy_now";
+        measured = FALSE;
+        if (!turned && SEQ(s->power_from, from))
+            power = s->power;
+        if (s->energy_mark < 0 || turned) {
+            s->energy_mark = energy;
+            s->energy_mark_t = now;
+        } else if (energy != s->energy_mark) {
+            power_dt = (double)(now - s->energy_mark_t) / G_USEC_PER_SEC;
+            power = ABS(energy - s->energy_mark) * 3600 / power_dt;
+            measured = TRUE;
+            s->energy_mark = energy;
+            s->energy_mark_t = now;
+        }
+    } else
+        s->energy_mark = -1;
+
+    if (power >= 0 && measured) {
+        if (s->power_avg < 0 || power_dt <= 0)
+            s->power_avg = power;
+        else {
+            double alpha = power_dt / (PS_EWMA_TAU + power_dt);
+            s->power_avg += alpha * (power - s->power_avg);
+        }
+    }
+
+    g_free(s->status);
+    s->status = status;
+    s->energy = energy;
+    s->energy_full = energy_full;
+    s->power = power;
+    s->power_from = from;
+#undef HAVE
+}
+
+static gchar *ps_value(ps_supply *s, const gchar *field) {
+    if (SEQ(field, "status"))
+        return g_strdup(s->status ? s->status : "");
+    if (SEQ(field, "power_from"))
+        return g_strdup(s->power_from ? s->power_from : "");
+    if (SEQ(field, "power"))
+        return (s->power < 0) ? NULL : g_strdup_printf("%.0lf", s->power);
+    if (SEQ(field, "power_avg"))
+        return (s->power_avg < 0) ? NULL : g_strdup_printf("%.0lf", s->power_avg);
+    if (SEQ(field, "energy"))
+        return (s->energy < 0) ? NULL : g_strdup_printf("%.0lf", s->energy);
+
+    /* seconds, at the smoothed rate */
+    if (s->power_avg <= 0 || s->energy < 0)
+        return NULL;
+    if (SEQ(field, "time_to_empty") && SEQ(s->status, "Discharging"))
+        return g_strdup_printf("%.0lf", s->energy * 3600 / s->power_avg);
+    if (SEQ(field, "time_to_full") && SEQ(s->status, "Charging")
+        && s->energy_full >= s->energy)
+        return g_strdup_printf("%.0lf", (s->energy_full - s->energy) * 3600 / s->power_avg);
+    return NULL;
+}
+
+static gchar *ps_read(const gchar *path) {
+    gchar *ret = NULL;
+    gchar *field = g_path_get_basename(path);
+    gchar *ps_path = g_path_get_dirname(path);
+    gchar *name = g_path_get_basename(ps_path);
+
+    g_mutex_lock(&ps.lock);
+    ps_supply *s = ps.supplies ? g_hash_table_lookup(ps.supplies, name) : NULL;
+    if (s) {
+        if (g_get_monotonic_time() - s->last >= PS_INTERVAL * G_USEC_PER_SEC)
+            ps_sample(s);
+        ret = ps_value(s, field);
+    }
+    g_mutex_unlock(&ps.lock);
+
+    g_free(field);
+    g_free(ps_path);
+    g_free(name);
+    return ret;
+}
+
+/* only supplies that report something to measure,
+ * not a mains adapter with just online. requires ps.lock */
+static void ps_add(const gchar *name, sysobj_virt_batch *b) {
+    if (g_hash_table_lookup(ps.supplies, name))
+        return;
+    gchar *ps_path = g_strdup_printf(PS_CLASS "/%s", name);
+    sysobj *obj = sysobj_new_fast(ps_path);
+    gchar *data = NULL;
+    if (obj->exists) {
+        gchar *fs = g_build_filename(obj->path_fs, "uevent", NULL);
+        gg_file_get_contents_non_blocking(fs, &data, NULL, NULL);
+        gint64 v[PS_FIELDS] = {};
+        gchar *status = NULL;
+        if (data && ps_parse(data, v, &status) ) {
+            ps_supply *s = g_new0(ps_supply, 1);
+            s->name = g_strdup(name);
+            s->uevent_fs = fs;
+            fs = NULL;
+            s->energy = s->energy_full = s->energy_mark = s->power = s->power_avg = -1;
+            g_hash_table_insert(ps.supplies, s->name, s);
+            ps_sample(s);
+
+            gchar *base = g_strdup_printf(PS_ROOT "/%s", name);
+            sysobj_virt_batch_add_simple(b, base, NULL, "*", VSO_TYPE_DIR);
+            sysobj_virt_batch_add_simple(b, base, "supply", ps_path, VSO_TYPE_SYMLINK | VSO_TYPE_AUTOLINK | VSO_TYPE_DYN);
+            for (int i = 0; i < (int)G_N_ELEMENTS(ps_values); i++) {
+                sysobj_virt *vo = sysobj_virt_new();
+                vo->path = g_strdup_printf("%s/%s", base, ps_values[i]);
+                vo->type = VSO_TYPE_STRING;
+                vo->f_get_data = ps_read;
+                sysobj_virt_batch_add(b, vo);
+            }
+            g_free(base);
+        }
+        g_free(status);
+        g_free(fs);
+    }
+    g_free(data);
+    sysobj_free(obj);
+    g_free(ps_path);
+}
+
+static void ps_remove(const gchar *name) {
+    g_mutex_lock(&ps.lock);
+    if (ps.supplies)
+        g_hash_table_remove(ps.supplies, name);
+    g_mutex_unlock(&ps.lock);
+
+    gchar *glob = g_strdup_printf(PS_ROOT "/%s", name);
+    sysobj_virt_remove(glob);
+    glob = appf(glob, "", "/*");
+    sysobj_virt_remove(glob);
+    g_free(glob);
+}
+
+/* requires ps.lock */
+static void ps_scan(sysobj *obj, sysobj_virt_batch *b) {
+    GSList *childs = sysobj_children(obj, NULL, NULL, TRUE);
+    for (GSList *l = childs; l; l = l->next)
+        ps_add(l->data, b);
+    g_slist_free_full(childs, g_free);
+}
+
+/* events were lost, new supplies and the ones that are gone */
+static void ps_rescan() {
+    sysobj *obj = sysobj_new_fast(PS_CLASS);
+    sysobj_virt_batch *b = sysobj_virt_batch_new(FALSE);
+    GSList *gone = NULL;
+    g_mutex_lock(&ps.lock);
+    if (ps.supplies) {
+        ps_scan(obj, b);
+        GHashTableIter iter;
+        gpointer key;
+        g_hash_table_iter_init(&iter, ps.supplies);
+        while (g_hash_table_iter_next(&iter, &key, NULL)) {
+            sysobj *sobj = sysobj_new_from_fn(obj->path, key);
+            if (!sobj->exists)
+                gone = g_slist_prepend(gone, g_strdup(key));
+            sysobj_free(sobj);
+        }
+    }
+    g_mutex_unlock(&ps.lock);
+    sysobj_virt_batch_commit(b);
+    sysobj_free(obj);
+
+    for (GSList *l = gone; l; l = l->next)
+        ps_remove(l->data);
+    g_slist_free_full(gone, g_free);
+}
+
+static void ps_uevent(const uevent *ev, gpointer user_data) {
+    if (uevent_is(ev, "rescan"))
+        ps_rescan();
+    else if (uevent_is(ev, "add")) {
+        sysobj_virt_batch *b = sysobj_virt_batch_new(FALSE);
+        g_mutex_lock(&ps.lock);
+        if (ps.supplies)
+            ps_add(ev->name, b);
+        g_mutex_unlock(&ps.lock);
+        sysobj_virt_batch_commit(b);
+    } else if (uevent_is(ev, "remove"))
+        ps_remove(ev->name);
+}
+
+static gchar *ps_root(const gchar *path) {
+    if (!path) {
+        /* cleanup */
+        g_mutex_lock(&ps.lock);
+        if (ps.supplies)
+            g_hash_table_destroy(ps.supplies);
+        ps.supplies = NULL;
+        g_mutex_unlock(&ps.lock);
+        return NULL;
+    }
+    return NULL; /* auto dir */
+}
+
+static sysobj_virt vol[] = {
+    { .path = PS_ROOT, .str = "*",
+      .f_get_data = ps_root,
+      .type = VSO_TYPE_DIR | VSO_TYPE_CONST | VSO_TYPE_CLEANUP },
+};
+
+void gen_power_supply() {
+    sysobj *obj = sysobj_new_fast(PS_CLASS);
+    if (!obj->exists) {
+        sysobj_free(obj);
+        return;
+    }
+
+    for (int i = 0; i < (int)G_N_ELEMENTS(vol); i++)
+        sysobj_virt_add(&vol[i]);
+
+    sysobj_virt_batch *b = sysobj_virt_batch_new(FALSE);
+    g_mutex_lock(&ps.lock);
+    ps.supplies = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, (GDestroyNotify)ps_supply_free);
+    ps_scan(obj, b);
+    g_mutex_unlock(&ps.lock);
+    sysobj_virt_batch_commit(b);
+    sysobj_free(obj);
+
+    uevent_handler_add("power_supply", ps_uevent, NULL);
+}
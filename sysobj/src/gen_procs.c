@@ -23,6 +23,7 @@
  */
 #include "sysobj.h"
 #include "cpubits.h"
+#include "uevent.h"
 
 #define PROCS_ROOT ":/cpu"
 
@@ -103,14 +104,8 @@ void cpu_pct(sysobj *obj, int *logical, int *pack, int *core_of_pack, int *threa
     *thread_of_core = -1;
     if (thread_sibs) {
         cpubits *bits = cpubits_from_str(thread_sibs);
-        int sib = cpubits_min(bits);
-        int i = 0;
-        while (sib != *logical) {
-            sib = cpubits_next(bits, sib, -1);
-            i++;
-        }
-        if (sib == *logical)
-            *thread_of_core = i;
+        if (bits && CPUBIT_GET(bits, *logical))
+            *thread_of_core = cpubits_rank(bits, *logical);
         free(bits);
     }
 
@@ -129,91 +124,249 @@ void cpu_pct(sysobj *obj, int *logical, int *pack, int *core_of_pack, int *threa
     g_free(pn);
 }
 
-static void procs_scan() {
+/* what was read for one logical cpu, kept so that procs_refresh()
+ * only has to re-read the ones that changed */
+typedef struct {
+    gchar *name;            /* cpuN */
+    gchar *path;
+    gboolean online;
+    int log, p, c, t;       /* t as read, see procs_build() */
+    gchar *freq_name, *freq_path;
+    gchar *freqdomain_cpus; /* NULL if no cpufreq */
+} procs_cpu;
+
+static struct {
+    GMutex lock;
+    GHashTable *cpus;       /* name -> procs_cpu */
+} procs_state;
+
+#define PROCS_PER_THREAD 8
+
+static void procs_cpu_free(procs_cpu *pc) {
+    if (!pc) return;
+    g_free(pc->name);
+    g_free(pc->path);
+    g_free(pc->freq_name);
+    g_free(pc->freq_path);
+    g_free(pc->freqdomain_cpus);
+    g_free(pc);
+}
+
+static gboolean procs_cpu_online(const gchar *cpu_path) {
+    /* no online for a cpu that can't be taken offline, like cpu0 */
+    gchar *online = sysobj_raw_from_fn(cpu_path, "online");
+    gboolean ret = online ? (atoi(online) != 0) : TRUE;
+    g_free(online);
+    return ret;
+}
+
+static void procs_cpu_read(procs_cpu *pc) {
+    pc->online = procs_cpu_online(pc->path);
+
+    /* topo */
+    sysobj *topo_obj = sysobj_new_from_fn(pc->path, "topology");
+    cpu_pct(topo_obj, &pc->log, &pc->p, &pc->c, &pc->t);
+    sysobj_free(topo_obj);
+
+    /* clock */
+    sysobj *freq_obj = sysobj_new_from_fn(pc->path, "cpufreq");
+    gchar *freqdomain_cpus =
+        sysobj_raw_from_fn(freq_obj->path, "freqdomain_cpus");
+    if (!freqdomain_cpus)
+        freqdomain_cpus = sysobj_raw_from_fn(freq_obj->path, "related_cpus");
+    if (!freqdomain_cpus)
+        freqdomain_cpus = sysobj_raw_from_fn(freq_obj->path, "affected_cpus");
+    if (freqdomain_cpus)
+        g_strchomp(freqdomain_cpus); /* remove \n */
+
+    g_free(pc->freq_name);
+    g_free(pc->freq_path);
+    g_free(pc->freqdomain_cpus);
+    pc->freq_name = g_strdup(freq_obj->name);
+    pc->freq_path = g_strdup(freq_obj->path);
+    pc->freqdomain_cpus = freqdomain_cpus;
+    sysobj_free(freq_obj);
+}
+
+typedef struct {
+    GPtrArray *todo; /* procs_cpu */
+    gint next;
+} procs_work;
+
+static gpointer procs_worker(procs_work *w) {
+    int i;
+    while ( (i = g_atomic_int_add(&w->next, 1)) < (int)w->todo->len)
+        procs_cpu_read(g_ptr_array_index(w->todo, i));
+    return NULL;
+}
+
+/* ~10 files each, fanned out when there are many */
+static void procs_cpus_read(GPtrArray *todo) {
+    procs_work w = { todo, 0 };
+    int i, nt = MIN(g_get_num_processors(), (int)todo->len / PROCS_PER_THREAD);
+    if (nt < 2) {
+        procs_worker(&w);
+        return;
+    }
+    GThread **threads = g_new0(GThread*, nt);
+    for (i = 0; i < nt; i++)
+        threads[i] = g_thread_new(NULL, (GThreadFunc)procs_worker, &w);
+    for (i = 0; i < nt; i++)
+        g_thread_join(threads[i]);
+    g_free(threads);
+}
+
+static gint procs_cpu_cmp(const procs_cpu **a, const procs_cpu **b) {
+    return (*a)->log - (*b)->log;
+}
+
+/* the tree from procs_state.cpus, no reading */
+static void procs_build() {
     static const char s_pack[] = "package";
     static const char s_core[] = "core";
     static const char s_thread[] = "thread";
     static const char s_clock[] = "freq_domain";
 
     int packs = 0, cores = 0, threads = 0, clocks = 0;
-    GSList *uniq_clocks = NULL;
+    GHashTable *uniq_clocks = g_hash_table_new(g_str_hash, g_str_equal); /* cpu_list -> id+1 */
+    GHashTable *core_threads = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL); /* p.c -> count */
+    /* all added at once at the end, so count the dirs here */
+    sysobj_virt_batch *b = sysobj_virt_batch_new(FALSE);
+    GHashTable *dirs = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, NULL);
+    #define NEW_DIR(p) (g_hash_table_add(dirs, g_strdup(p)) ? (sysobj_virt_batch_add_simple(b, p, NULL, "*", VSO_TYPE_DIR), 1) : 0)
 
     sysobj_virt_remove(PROCS_ROOT "/package*");
     sysobj_virt_remove(PROCS_ROOT "/freq_domain*");
 
-    sysobj *obj = sysobj_new_from_fn("/sys/devices/system/cpu", NULL);
-    GSList *cpu_list = sysobj_children(obj, "cpu*", NULL, TRUE);
-    GSList *l = cpu_list;
-    while(l) {
-        int log = 0, p = 0, c = 0, t = 0;
-        sysobj *cpu_obj = sysobj_new_from_fn(obj->path, (gchar *)l->data);
-        if (verify_lblnum(cpu_obj, "cpu")) {
-            /* topo */
-            sysobj *topo_obj = sysobj_new_from_fn(cpu_obj->path, "topology");
-            cpu_pct(topo_obj, &log, &p, &c, &t);
-            gchar *t_path = g_strdup_printf(PROCS_ROOT "/%s%d/%s%d/%s%d", s_pack, p, s_core, c, s_thread, t);
-            gchar *c_path = g_strdup_printf(PROCS_ROOT "/%s%d/%s%d", s_pack, p, s_core, c);
-            gchar *p_path = g_strdup_printf(PROCS_ROOT "/%s%d", s_pack, p);
-            gchar *cpuinfo_path = g_strdup_printf(":/cpu/cpuinfo/logical_cpu%d", log);
-
-            /* sysobj_virt_add() returns TRUE only if added, so count the additions */
-            if ( sysobj_virt_add_simple(p_path, NULL, "*", VSO_TYPE_DIR ) ) packs++;
-            if ( sysobj_virt_add_simple(c_path, NULL, "*", VSO_TYPE_DIR ) ) cores++;
-            if ( sysobj_virt_add_simple(t_path, NULL, "*", VSO_TYPE_DIR ) ) threads++;
-            sysobj_virt_add_simple(t_path, cpu_obj->name, cpu_obj->path, VSO_TYPE_SYMLINK | VSO_TYPE_DYN | VSO_TYPE_AUTOLINK );
-            sysobj_virt_add_simple(t_path, "cpuinfo", cpuinfo_path, VSO_TYPE_SYMLINK | VSO_TYPE_DYN | VSO_TYPE_AUTOLINK );
-
-            g_free(t_path);
-            g_free(c_path);
-            g_free(p_path);
-            g_free(cpuinfo_path);
-            sysobj_free(topo_obj);
-
-            /* clock */
-            sysobj *freq_obj = sysobj_new_from_fn(cpu_obj->path, "cpufreq");
-            gchar *freqdomain_cpus =
-                sysobj_raw_from_fn(freq_obj->path, "freqdomain_cpus");
-            if (!freqdomain_cpus)
-                freqdomain_cpus = sysobj_raw_from_fn(freq_obj->path, "related_cpus");
-            if (!freqdomain_cpus)
-                freqdomain_cpus = sysobj_raw_from_fn(freq_obj->path, "affected_cpus");
-
-            if (freqdomain_cpus) {
-                g_strchomp(freqdomain_cpus); /* remove \n */
-
-                int clk_id = 0;
-                GSList *l = g_slist_find_custom(uniq_clocks, freqdomain_cpus, (GCompareFunc)g_strcmp0);
-                if (l) {
-                    clk_id = g_slist_position(uniq_clocks, l);
-                } else {
-                    clk_id = g_slist_length(uniq_clocks);
-                    uniq_clocks = g_slist_append(uniq_clocks, g_strdup(freqdomain_cpus) );
-                }
+    /* clock ids in cpu order, as they were */
+    GPtrArray *cpus = g_ptr_array_new();
+    GHashTableIter iter;
+    gpointer pc;
+    g_hash_table_iter_init(&iter, procs_state.cpus);
+    while (g_hash_table_iter_next(&iter, NULL, &pc))
+        g_ptr_array_add(cpus, pc);
+    g_ptr_array_sort(cpus, (GCompareFunc)procs_cpu_cmp);
+
+    for (guint i = 0; i < cpus->len; i++) {
+        procs_cpu *pc = g_ptr_array_index(cpus, i);
+        /* The thread is the rank in thread_siblings_list, but that
+         * changes for the others when a sibling comes or goes, and only
+         * that one was read again. In cpu order it's the same as the
+         * count of online siblings before it. */
+        int t = pc->t;
+        if (pc->online && pc->p >= 0 && pc->c >= 0) {
+            gchar *key = g_strdup_printf("%d.%d", pc->p, pc->c);
+            t = GPOINTER_TO_INT(g_hash_table_lookup(core_threads, key));
+            g_hash_table_replace(core_threads, key, GINT_TO_POINTER(t + 1));
+        }
+        gchar *t_path = g_strdup_printf(PROCS_ROOT "/%s%d/%s%d/%s%d", s_pack, pc->p, s_core, pc->c, s_thread, t);
+        gchar *c_path = g_strdup_printf(PROCS_ROOT "/%s%d/%s%d", s_pack, pc->p, s_core, pc->c);
+        gchar *p_path = g_strdup_printf(PROCS_ROOT "/%s%d", s_pack, pc->p);
+        gchar *cpuinfo_path = g_strdup_printf(":/cpu/cpuinfo/logical_cpu%d", pc->log);
+
+        packs += NEW_DIR(p_path);
+        cores += NEW_DIR(c_path);
+        threads += NEW_DIR(t_path);
+        sysobj_virt_batch_add_simple(b, t_path, pc->name, pc->path, VSO_TYPE_SYMLINK | VSO_TYPE_DYN | VSO_TYPE_AUTOLINK );
+        sysobj_virt_batch_add_simple(b, t_path, "cpuinfo", cpuinfo_path, VSO_TYPE_SYMLINK | VSO_TYPE_DYN | VSO_TYPE_AUTOLINK );
 
-                gchar *clk_path = g_strdup_printf(PROCS_ROOT "/%s%d", s_clock, clk_id);
-                if ( sysobj_virt_add_simple(clk_path, NULL, "*", VSO_TYPE_DIR ) ) clocks++;
-                sysobj_virt_add_simple(clk_path, "cpu_list", freqdomain_cpus, VSO_TYPE_STRING);
-                sysobj_virt_add_simple(clk_path, freq_obj->name, freq_obj->path, VSO_TYPE_SYMLINK | VSO_TYPE_DYN | VSO_TYPE_AUTOLINK );
-                g_free(clk_path);
+        g_free(t_path);
+        g_free(c_path);
+        g_free(p_path);
+        g_free(cpuinfo_path);
 
-                g_free(freqdomain_cpus);
+        if (pc->freqdomain_cpus) {
+            int clk_id = GPOINTER_TO_INT(g_hash_table_lookup(uniq_clocks, pc->freqdomain_cpus)) - 1;
+            if (clk_id < 0) {
+                clk_id = g_hash_table_size(uniq_clocks);
+                g_hash_table_insert(uniq_clocks, pc->freqdomain_cpus, GINT_TO_POINTER(clk_id + 1));
             }
-            sysobj_free(freq_obj);
 
+            gchar *clk_path = g_strdup_printf(PROCS_ROOT "/%s%d", s_clock, clk_id);
+            clocks += NEW_DIR(clk_path);
+            sysobj_virt_batch_add_simple(b, clk_path, "cpu_list", pc->freqdomain_cpus, VSO_TYPE_STRING);
+            sysobj_virt_batch_add_simple(b, clk_path, pc->freq_name, pc->freq_path, VSO_TYPE_SYMLINK | VSO_TYPE_DYN | VSO_TYPE_AUTOLINK );
+            g_free(clk_path);
+        }
+    }
+    g_ptr_array_free(cpus, TRUE);
+    g_hash_table_destroy(uniq_clocks);
+    g_hash_table_destroy(core_threads);
+    g_hash_table_destroy(dirs);
+    #undef NEW_DIR
+
+    sysobj_virt_batch_add_simple(b, PROCS_ROOT "/packs", NULL, auto_free(g_strdup_printf("%d", packs) ), VSO_TYPE_STRING);
+    sysobj_virt_batch_add_simple(b, PROCS_ROOT "/cores", NULL, auto_free(g_strdup_printf("%d", cores) ), VSO_TYPE_STRING);
+    sysobj_virt_batch_add_simple(b, PROCS_ROOT "/threads", NULL, auto_free(g_strdup_printf("%d", threads) ), VSO_TYPE_STRING);
+    sysobj_virt_batch_add_simple(b, PROCS_ROOT "/freq_domains", NULL, auto_free(g_strdup_printf("%d", clocks) ), VSO_TYPE_STRING);
+    sysobj_virt_batch_commit(b);
+    free_auto_free();
+}
+
+/* full = FALSE: only cpus that are new or changed online state
+ * are read again. Returns the number read. */
+static int procs_scan(gboolean full) {
+    GPtrArray *todo = g_ptr_array_new();
+    GHashTable *seen = g_hash_table_new(g_str_hash, g_str_equal);
+
+    g_mutex_lock(&procs_state.lock);
+    if (!procs_state.cpus)
+        procs_state.cpus = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, (GDestroyNotify)procs_cpu_free);
+
+    sysobj *obj = sysobj_new_from_fn("/sys/devices/system/cpu", NULL);
+    GSList *cpu_list = sysobj_children(obj, "cpu*", NULL, TRUE);
+    for (GSList *l = cpu_list; l; l = l->next) {
+        gchar *name = (gchar *)l->data;
+        sysobj *cpu_obj = sysobj_new_from_fn(obj->path, name);
+        if (verify_lblnum(cpu_obj, "cpu")) {
+            procs_cpu *pc = g_hash_table_lookup(procs_state.cpus, name);
+            if (!pc) {
+                pc = g_new0(procs_cpu, 1);
+                pc->name = g_strdup(name);
+                pc->path = g_strdup(cpu_obj->path);
+                g_hash_table_insert(procs_state.cpus, pc->name, pc);
+                g_ptr_array_add(todo, pc);
+            } else if (full || pc->online != procs_cpu_online(pc->path))
+                g_ptr_array_add(todo, pc);
+            g_hash_table_add(seen, pc->name);
         }
         sysobj_free(cpu_obj);
-        g_free(l->data); /* won't need again */
-        l = l->next;
     }
-    g_slist_free(cpu_list);
+    g_slist_free_full(cpu_list, (GDestroyNotify)g_free);
     sysobj_free(obj);
-    g_slist_free_full(uniq_clocks, (GDestroyNotify)g_free);
 
-    sysobj_virt_add_simple(PROCS_ROOT "/packs", NULL, auto_free(g_strdup_printf("%d", packs) ), VSO_TYPE_STRING);
-    sysobj_virt_add_simple(PROCS_ROOT "/cores", NULL, auto_free(g_strdup_printf("%d", cores) ), VSO_TYPE_STRING);
-    sysobj_virt_add_simple(PROCS_ROOT "/threads", NULL, auto_free(g_strdup_printf("%d", threads) ), VSO_TYPE_STRING);
-    sysobj_virt_add_simple(PROCS_ROOT "/freq_domains", NULL, auto_free(g_strdup_printf("%d", clocks) ), VSO_TYPE_STRING);
-    free_auto_free();
+    /* gone, hot-removed */
+    gboolean removed = FALSE;
+    GHashTableIter iter;
+    gpointer name;
+    g_hash_table_iter_init(&iter, procs_state.cpus);
+    while (g_hash_table_iter_next(&iter, &name, NULL))
+        if (!g_hash_table_contains(seen, name)) {
+            g_hash_table_iter_remove(&iter);
+            removed = TRUE;
+        }
+    g_hash_table_destroy(seen);
+
+    int ret = todo->len;
+    procs_cpus_read(todo);
+    g_ptr_array_free(todo, TRUE);
+
+    if (full || ret || removed)
+        procs_build();
+    g_mutex_unlock(&procs_state.lock);
+    return ret;
+}
+
+/* export */
+/* after a cpu was brought online or offline */
+int procs_refresh() {
+    return procs_scan(FALSE);
+}
+
+static void procs_uevent(const uevent *ev, gpointer user_data) {
+    if (uevent_is(ev, "change"))
+        return;
+    procs_refresh();
 }
 
 void find_soc() {
@@ -248,6 +401,7 @@ void gen_procs() {
     for (int i = 0; i < (int)G_N_ELEMENTS(vol); i++)
         sysobj_virt_add(&vol[i]);
 
-    procs_scan();
+    procs_scan(TRUE);
     find_soc();
+    uevent_handler_add("cpu", procs_uevent, NULL);
 }
@@ -22,6 +22,7 @@
  *  :/storage
  */
 #include "sysobj.h"
+#include "uevent.h"
 
 #define storage_msg(msg, ...)  fprintf (stderr, "[%s] " msg "\n", __FUNCTION__, ##__VA_ARGS__) /**/
 
@@ -30,12 +31,14 @@ static int storage_next = 0;
 typedef struct {
     int type;
     gchar *name; /* storage<storage_next> */
+    gchar *block; /* sda, nvme0n1, ... */
 } storaged;
 
 #define storaged_new() (g_new0(storaged, 1))
 static void storaged_free(storaged *s) {
     if (!s) return;
     g_free(s->name);
+    g_free(s->block);
     g_free(s);
 }
 
@@ -44,27 +47,99 @@ static GSList *storage_list = NULL;
 
 static GMutex storage_list_lock;
 
-void storage_item(sysobj *obj) {
-    gchar *name = g_strdup_printf("storage%d", storage_next++);
-    gchar *dev = g_strdup_printf("%s/device", name);
-    sysobj_virt_add_simple(":/storage", name, "*", VSO_TYPE_DIR);
+/* requires storage_list_lock held */
+static void storage_item(sysobj *obj, const gchar *block) {
+    storaged *s = storaged_new();
+    s->name = g_strdup_printf("storage%d", storage_next++);
+    s->block = g_strdup(block);
+    storage_list = g_slist_append(storage_list, s);
+
+    gchar *dev = g_strdup_printf("%s/device", s->name);
+    gchar *io = g_strdup_printf("%s/io", s->name);
+    gchar *io_path = g_strdup_printf(":/block_io/%s", block);
+    sysobj_virt_add_simple(":/storage", s->name, "*", VSO_TYPE_DIR);
     sysobj_virt_add_simple(":/storage", dev, obj->path, VSO_TYPE_SYMLINK | VSO_TYPE_AUTOLINK | VSO_TYPE_DYN);
-    g_free(name);
+    sysobj_virt_add_simple(":/storage", io, io_path, VSO_TYPE_SYMLINK | VSO_TYPE_AUTOLINK | VSO_TYPE_DYN);
     g_free(dev);
+    g_free(io);
+    g_free(io_path);
+}
+
+/* requires storage_list_lock held */
+static void storage_block_add(const gchar *block_path, const gchar *block) {
+    for(GSList *l = storage_list; l; l = l->next)
+        if (SEQ(((storaged*)l->data)->block, block))
+            return;
+    gchar *devpath = g_strdup_printf("%s/%s/device", block_path, block);
+    sysobj *bdev = sysobj_new_fast(devpath);
+    if (sysobj_exists(bdev))
+        storage_item(bdev, block);
+    sysobj_free(bdev);
+    g_free(devpath);
 }
 
 void storage_scan() {
+    g_mutex_lock(&storage_list_lock);
     sysobj *blist = sysobj_new_fast("sys/block");
     GSList *childs = sysobj_children(blist, NULL, NULL, TRUE);
-    for(GSList *l = childs; l; l = l->next) {
-        gchar *devpath = g_strdup_printf("%s/%s/device", blist->path, (gchar*)l->data);
-        sysobj *bdev = sysobj_new_fast(devpath);
-        if (sysobj_exists(bdev))
-            storage_item(bdev);
-        sysobj_free(bdev);
-    }
+    for(GSList *l = childs; l; l = l->next)
+        storage_block_add(blist->path, (gchar*)l->data);
     g_slist_free_full(childs, (GDestroyNotify)g_free);
     sysobj_free(blist);
+    g_mutex_unlock(&storage_list_lock);
+}
+
+/* requires storage_list_lock held */
+static void storage_item_remove(GSList *l) {
+    storaged *s = l->data;
+    gchar *glob = g_strdup_printf(":/storage/%s", s->name);
+    sysobj_virt_remove(glob);
+    glob = appf(glob, "", "/*");
+    sysobj_virt_remove(glob);
+    g_free(glob);
+    storaged_free(s);
+    storage_list = g_slist_delete_link(storage_list, l);
+}
+
+/* events were lost, new disks and the ones that are gone */
+static void storage_rescan() {
+    storage_scan();
+    g_mutex_lock(&storage_list_lock);
+    sysobj *blist = sysobj_new_fast("sys/block");
+    for(GSList *l = storage_list, *next; l; l = next) {
+        next = l->next;
+        sysobj *bobj = sysobj_new_from_fn(blist->path, ((storaged*)l->data)->block);
+        if (!bobj->exists)
+            storage_item_remove(l);
+        sysobj_free(bobj);
+    }
+    sysobj_free(blist);
+    g_mutex_unlock(&storage_list_lock);
+}
+
+/* only the item for the disk that came or went */
+static void storage_uevent(const uevent *ev, gpointer user_data) {
+    if (uevent_is(ev, "rescan")) {
+        storage_rescan();
+        return;
+    }
+    if (!SEQ(ev->devtype, "disk"))
+        return; /* partitions aren't storage items */
+
+    g_mutex_lock(&storage_list_lock);
+    if (uevent_is(ev, "add")) {
+        sysobj *blist = sysobj_new_fast("sys/block");
+        storage_block_add(blist->path, ev->name);
+        sysobj_free(blist);
+    } else if (uevent_is(ev, "remove")) {
+        for(GSList *l = storage_list; l; l = l->next) {
+            if (SEQ(((storaged*)l->data)->block, ev->name)) {
+                storage_item_remove(l);
+                break;
+            }
+        }
+    }
+    g_mutex_unlock(&storage_list_lock);
 }
 
 int storage_get_type(const gchar *path) {
@@ -75,10 +150,15 @@ int storage_get_type(const gchar *path) {
 }
 
 gchar *storage_get_data(const gchar *path) {
-    if (!path) return NULL;
+    if (!path) {
+        /* cleanup */
+        storage_list_free();
+        storage_list = NULL;
+        return NULL;
+    }
 
     if (SEQ(path, ":/storage") )
-        return "*";
+        return g_strdup("*");
 
     return NULL;
 }
@@ -87,7 +167,7 @@ static sysobj_virt vol[] = {
     { .path = ":/storage", .str = "*",
       .f_get_type = storage_get_type,
       .f_get_data = storage_get_data,
-      .type = VSO_TYPE_DIR | VSO_TYPE_CONST },
+      .type = VSO_TYPE_DIR | VSO_TYPE_CONST | VSO_TYPE_CLEANUP },
 };
 
 void gen_storage() {
@@ -96,4 +176,5 @@ void gen_storage() {
         sysobj_virt_add(&vol[i]);
 
     storage_scan();
+    uevent_handler_add("block", storage_uevent, NULL);
 }
@@ -33,16 +33,18 @@ static gchar *get_item_items[] = {
     "freed_count", "free_queue", "free_expected",
     "free_delay",
     "sysobj_new", "sysobj_new_fast",
-    "sysobj_clean", "sysobj_free",
+    "sysobj_clean", "sysobj_free", "sysobj_slab_reuse",
+    "path_cache_hit", "path_cache_miss",
     "sysobj_read_first", "sysobj_read_force",
     "sysobj_read_expired", "sysobj_read_not_expired",
-    "sysobj_read_wo", "sysobj_read_bytes",
-    "gg_file_total_wait",
+    "sysobj_read_wo", "sysobj_read_bytes", "sysobj_read_derived",
+    "gg_file_total_wait", "gen_init_time", "gen_lazy_run", "uevent_count", "vcache_restored",
     "virt_count", "virt_iter", "virt_rm",
     "virt_add", "virt_replace",
     "virt_fget", "virt_fset",
     "virt_fget_bytes", "virt_fset_bytes",
     "vo_list_count", "vo_tree_count",
+    "intern_count",
     "class_count", "class_iter", "classify_none",
     "classify_pattern_cmp",
     "ven_iter",
@@ -72,6 +74,12 @@ static gchar *get_item(const gchar *path) {
         return g_strdup_printf("%llu", sysobj_stats.so_clean );
     if (SEQ(name, "sysobj_free") )
         return g_strdup_printf("%llu", sysobj_stats.so_free );
+    if (SEQ(name, "sysobj_slab_reuse") )
+        return g_strdup_printf("%llu", sysobj_stats.so_slab_reuse );
+    if (SEQ(name, "path_cache_hit") )
+        return g_strdup_printf("%llu", sysobj_stats.so_path_cache_hit );
+    if (SEQ(name, "path_cache_miss") )
+        return g_strdup_printf("%llu", sysobj_stats.so_path_cache_miss );
 
     if (SEQ(name, "sysobj_read_first") )
         return g_strdup_printf("%llu", sysobj_stats.so_read_first );
@@ -85,7 +93,17 @@ static gchar *get_item(const gchar *path) {
         return g_strdup_printf("%llu", sysobj_stats.so_read_wo );
     if (SEQ(name, "sysobj_read_bytes") )
         return g_strdup_printf("%llu", sysobj_stats.so_read_bytes );
-
+    if (SEQ(name, "sysobj_read_derived") )
+        return g_strdup_printf("%llu", sysobj_stats.so_read_derived );
+
+    if (SEQ(name, "gen_init_time") )
+        return g_strdup_printf("%llu", sysobj_stats.gen_init_time );
+    if (SEQ(name, "gen_lazy_run") )
+        return g_strdup_printf("%llu", sysobj_stats.gen_lazy_run );
+    if (SEQ(name, "uevent_count") )
+        return g_strdup_printf("%llu", sysobj_stats.uevent_count );
+    if (SEQ(name, "vcache_restored") )
+        return g_strdup_printf("%llu", sysobj_stats.vcache_restored );
     if (SEQ(name, "gg_file_total_wait") )
         return g_strdup_printf("%llu", gg_file_get_total_wait() );
 
@@ -107,6 +125,8 @@ static gchar *get_item(const gchar *path) {
         return g_strdup_printf("%lu", (long unsigned)sysobj_virt_count_ex(1) );
     if (SEQ(name, "vo_list_count") )
         return g_strdup_printf("%lu", (long unsigned)sysobj_virt_count_ex(2) );
+    if (SEQ(name, "intern_count") )
+        return g_strdup_printf("%lu", (long unsigned)path_intern_count() );
     if (SEQ(name, "virt_iter") )
         return g_strdup_printf("%llu", sysobj_stats.so_virt_iter );
     if (SEQ(name, "virt_rm") )
@@ -0,0 +1,148 @@
+/*
+ * sysobj - https://github.com/bp0/verbose-spork
+ * Copyright (C) 2018  Burt P. <pburt0@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#include "path_intern.h"
+#include <string.h>
+
+static GHashTable *intern_table = NULL; /* str -> path_intern */
+static GMutex intern_lock;
+
+/* the table is keyed by str, so lookups can use a plain string */
+static void intern_table_init() {
+    if (!intern_table)
+        intern_table = g_hash_table_new(g_str_hash, g_str_equal);
+}
+
+/* dirname length of path, or 0 if there is no parent */
+static gsize parent_len(const gchar *path, gsize len) {
+    while (len > 0 && path[len-1] != '/') len--;
+    if (len == 0) return 0;
+    if (len == 1) return (len < strlen(path)) ? 1 : 0; /* "/x" -> "/" */
+    return len - 1;
+}
+
+/* call with intern_lock held */
+static path_intern *intern_locked(const gchar *path) {
+    path_intern *p = g_hash_table_lookup(intern_table, path);
+    if (p) {
+        p->ref++;
+        return p;
+    }
+    gsize len = strlen(path);
+    p = g_malloc(sizeof(path_intern) + len + 1);
+    memcpy(p->str, path, len + 1);
+    p->len = len;
+    p->hash = g_str_hash(p->str);
+    p->ref = 1;
+    p->parent = NULL;
+    gsize pl = parent_len(p->str, len);
+    if (pl) {
+        /* p is not in the table yet, so its str can be
+         * briefly cut to the parent path */
+        gchar c = p->str[pl];
+        p->str[pl] = 0;
+        p->parent = intern_locked(p->str);
+        p->str[pl] = c;
+    }
+    g_hash_table_insert(intern_table, p->str, p);
+    return p;
+}
+
+/* call with intern_lock held */
+static void unref_locked(path_intern *p) {
+    while (p) {
+        path_intern *parent = (path_intern*)p->parent;
+        if (--p->ref > 0)
+            return;
+        g_hash_table_remove(intern_table, p->str);
+        g_free(p);
+        p = parent;
+    }
+}
+
+const path_intern *path_intern_get(const gchar *path) {
+    path_intern *ret = NULL;
+    if (!path) return NULL;
+    g_mutex_lock(&intern_lock);
+    intern_table_init();
+    ret = intern_locked(path);
+    g_mutex_unlock(&intern_lock);
+    return ret;
+}
+
+const path_intern *path_intern_peek(const gchar *path) {
+    path_intern *ret = NULL;
+    if (!path) return NULL;
+    g_mutex_lock(&intern_lock);
+    if (intern_table)
+        ret = g_hash_table_lookup(intern_table, path);
+    g_mutex_unlock(&intern_lock);
+    return ret;
+}
+
+const path_intern *path_intern_ref(const path_intern *p) {
+    if (p) {
+        g_mutex_lock(&intern_lock);
+        ((path_intern*)p)->ref++;
+        g_mutex_unlock(&intern_lock);
+    }
+    return p;
+}
+
+void path_intern_unref(const path_intern *p) {
+    if (p) {
+        g_mutex_lock(&intern_lock);
+        /* after path_intern_cleanup() everything is already gone */
+        if (intern_table)
+            unref_locked((path_intern*)p);
+        g_mutex_unlock(&intern_lock);
+    }
+}
+
+gboolean path_intern_is_within(const path_intern *p, const path_intern *anc) {
+    if (!anc) return FALSE;
+    for (; p; p = p->parent)
+        if (p == anc)
+            return TRUE;
+    return FALSE;
+}
+
+guint path_intern_count() {
+    guint ret = 0;
+    g_mutex_lock(&intern_lock);
+    if (intern_table)
+        ret = g_hash_table_size(intern_table);
+    g_mutex_unlock(&intern_lock);
+    return ret;
+}
+
+void path_intern_cleanup() {
+    g_mutex_lock(&intern_lock);
+    if (intern_table) {
+        GHashTableIter iter;
+        gpointer k, v;
+        g_hash_table_iter_init(&iter, intern_table);
+        while (g_hash_table_iter_next(&iter, &k, &v))
+            g_free(v);
+        g_hash_table_destroy(intern_table);
+        intern_table = NULL;
+    }
+    g_mutex_unlock(&intern_lock);
+}
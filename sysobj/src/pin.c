@@ -32,6 +32,7 @@ pin *pin_new_sysobj(sysobj *obj) {
     if (obj) {
         pin *p = pin_new();
         p->obj = obj;
+        p->ipath = path_intern_get(obj->path);
         p->update_interval = sysobj_update_interval(p->obj);
         if (p->update_interval == UPDATE_INTERVAL_NEVER) {
             /* static, only read once */
@@ -51,6 +52,7 @@ pin *pin_dup(const pin *src) {
     pin *ret = pin_new();
     memcpy(ret, src, sizeof(pin) );
     ret->obj = sysobj_dup(ret->obj);
+    ret->ipath = path_intern_ref(ret->ipath);
     ret->min = sysobj_data_dup(ret->min);
     ret->max = sysobj_data_dup(ret->max);
     if (ret->history_mem) {
@@ -73,6 +75,7 @@ void pin_free(void *ptr) {
             g_free(p->history);
         }
         sysobj_free(p->obj);
+        path_intern_unref(p->ipath);
         g_free(p);
     }
 }
@@ -110,8 +113,8 @@ void pin_update(pin *p, gboolean force) {
             if (!p->history_status) {
                 if (c && c->f_compare)
                     p->history_status = 1;
-                else if (p->obj->data.maybe_num) {
-                    p->history_status = p->obj->data.maybe_num;
+                else if (sysobj_data_maybe_num(&p->obj->data)) {
+                    p->history_status = sysobj_data_maybe_num(&p->obj->data);
                 } else
                     p->history_status = -1;
                 p->history_max_len = PIN_HIST_MAX_DEFAULT;
@@ -119,7 +122,7 @@ void pin_update(pin *p, gboolean force) {
 
             if (p->history_status > 0) {
                 if (p->history_status > 1) {
-                    switch(p->obj->data.maybe_num) {
+                    switch(sysobj_data_maybe_num(&p->obj->data)) {
                         case 0:
                             p->history_status = -1; /* previously guessed, but apparently wrong */
                             break;
@@ -172,10 +175,12 @@ pin_list *pins_new() {
 
 pin *pins_find_by_path(pin_list *pl, const gchar *path) {
     if (pl && path) {
-        GSList *l = pl->list;
+        /* every pin's path is interned */
+        const path_intern *ip = path_intern_peek(path);
+        GSList *l = ip ? pl->list : NULL;
         while (l) {
             pin *p = l->data;
-            if (g_strcmp0(p->obj->path, path) == 0)
+            if (p->ipath == ip)
                 return p;
             l = l->next;
         }
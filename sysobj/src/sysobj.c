@@ -24,6 +24,7 @@
 #include "sysobj.h"
 #include "vendor.h"
 #include "format_funcs.h"
+#include "uevent.h"
 
 so_stats sysobj_stats = {};
 GSList *sysobj_data_paths = NULL;
@@ -41,10 +42,60 @@ gchar *sysobj_find_data_file(const gchar *file) {
 
 gchar sysobj_root[1024] = "";
 #define USING_ALT_ROOT (*sysobj_root != 0)
+
+/* sysobj_config_paths() results, by normalized request path.
+ * An entry is good while its gen matches path_cache_gen_now(),
+ * which only virtual objects that can redirect a path change,
+ * and it isn't older than PATH_CACHE_MAX_AGE. */
+#define PATH_CACHE_MAX_AGE 10.0     /* seconds */
+#define PATH_CACHE_MAX_ITEMS 8192   /* cleared when full */
+typedef struct {
+    guint gen;
+    double stamp;
+    gchar *req_fs;
+    gsize req_off;
+    gchar *fs;
+    gsize fs_off;
+    gchar *link_target;
+    gboolean req_is_link;
+    gboolean ok;  /* FALSE if the filters rejected the path */
+} path_res;
+
+static GHashTable *path_cache = NULL;
+static GMutex path_cache_lock;
+static gint path_cache_gen = 0; /* alt root or filters changed, or invalidated */
+
+static guint path_cache_gen_now() {
+    return (guint)g_atomic_int_get(&path_cache_gen) + sysobj_virt_link_gen();
+}
+
+static void path_res_free(path_res *r) {
+    if (r) {
+        g_free(r->req_fs);
+        g_free(r->fs);
+        g_free(r->link_target);
+        g_free(r);
+    }
+}
+
+void sysobj_path_cache_invalidate() {
+    g_atomic_int_inc(&path_cache_gen);
+}
+
+static void path_cache_cleanup() {
+    g_mutex_lock(&path_cache_lock);
+    if (path_cache)
+        g_hash_table_destroy(path_cache);
+    path_cache = NULL;
+    g_mutex_unlock(&path_cache_lock);
+}
+
 gboolean sysobj_root_set(const gchar *alt_root) {
     gchar *fspath = util_canonicalize_path(alt_root);
     snprintf(sysobj_root, sizeof(sysobj_root) - 1, "%s", fspath);
     util_null_trailing_slash(sysobj_root);
+    g_free(fspath);
+    sysobj_path_cache_invalidate();
     return TRUE;
 }
 const gchar *sysobj_root_get() {
@@ -111,17 +162,19 @@ static sysobj_filter path_filters[] = {
 static GSList *sysobj_global_filters = NULL;
 static GTimer *sysobj_global_timer = NULL;
 
+static int64_t data_int64(const sysobj_data *d, int nbase);
+
 int compare_str_base10(const sysobj_data *a, const sysobj_data *b) {
-    int64_t A = (a && a->str) ? strtol(a->str, NULL, 10) : 0;
-    int64_t B = (b && b->str) ? strtol(b->str, NULL, 10) : 0;
+    int64_t A = data_int64(a, 10);
+    int64_t B = data_int64(b, 10);
     if (A < B) return -1;
     if (A > B) return 1;
     return 0;
 }
 
 int compare_str_base16(const sysobj_data *a, const sysobj_data *b) {
-    int64_t A = (a && a->str) ? strtol(a->str, NULL, 16) : 0;
-    int64_t B = (b && b->str) ? strtol(b->str, NULL, 16) : 0;
+    int64_t A = data_int64(a, 16);
+    int64_t B = data_int64(b, 16);
     if (A < B) return -1;
     if (A > B) return 1;
     return 0;
@@ -225,9 +278,13 @@ gchar *sysobj_raw_from_printf(gchar *path_fmt, ...) {
 }
 
 uint32_t sysobj_uint32_from_fn(const gchar *base, const gchar *name, int nbase) {
-    gchar *tmp = sysobj_raw_from_fn(base, name);
-    uint32_t ret = tmp ? strtol(tmp, NULL, nbase) : 0;
-    g_free(tmp);
+    /* read once and parse in place, no copy of the string */
+    gchar *req = util_build_fn(base, name);
+    sysobj *obj = sysobj_new_fast(req);
+    sysobj_read(obj, FALSE);
+    uint32_t ret = obj->data.str ? strtol(obj->data.str, NULL, nbase) : 0;
+    sysobj_free(obj);
+    g_free(req);
     return ret;
 }
 
@@ -252,12 +309,11 @@ gchar *simple_format(sysobj* obj, int fmt_opts) {
     gboolean
         exists = obj->exists,
         fail   = obj->access_fail,
-        utf8   = obj->data.is_utf8,
+        utf8   = sysobj_data_is_utf8(&obj->data),
         dir    = obj->data.is_dir,
         wo     = obj->write_only,
         empty  = (obj->data.len == 0)
-            || (utf8 && strlen(text = g_strstrip(g_strdup(str ? str : ""))) == 0 );
-    g_free(text);
+            || (utf8 && sysobj_data_blank(&obj->data) );
 
     if (!exists) {
         msg = N_("{not found}");
@@ -329,8 +385,8 @@ gchar *simple_format(sysobj* obj, int fmt_opts) {
 
     /* a string */
     if (fmt_opts & FMT_OPT_LIST_ITEM &&
-        (obj->data.lines > 1 || obj->data.len > 120) )
-        text = g_strdup_printf(_("{%lu line(s) text, utf8}"), obj->data.lines);
+        (sysobj_data_lines(&obj->data) > 1 || obj->data.len > 120) )
+        text = g_strdup_printf(_("{%lu line(s) text, utf8}"), sysobj_data_lines(&obj->data));
     else
         text = g_strdup(str);
     g_strchomp(text);
@@ -422,6 +478,182 @@ gboolean class_has_flag(const sysobj_class *c, guint flag) {
     return FALSE;
 }
 
+/* continuation bytes needed after a utf8 lead byte, and the range
+ * allowed for the first one (rejects overlongs, surrogates and > U+10FFFF),
+ * as g_utf8_validate() does */
+static inline int utf8_lead(guchar c, guchar *lo, guchar *hi) {
+    *lo = 0x80; *hi = 0xbf;
+    if (c >= 0xc2 && c <= 0xdf) return 1;
+    if (c == 0xe0) { *lo = 0xa0; return 2; }
+    if (c == 0xed) { *hi = 0x9f; return 2; }
+    if (c >= 0xe1 && c <= 0xef) return 2;
+    if (c == 0xf0) { *lo = 0x90; return 3; }
+    if (c == 0xf4) { *hi = 0x8f; return 3; }
+    if (c >= 0xf1 && c <= 0xf3) return 3;
+    return -1;
+}
+
+/* maybe_num with the same result as util_maybe_num(), without the
+ * copy, and the typed value if the whole (trimmed) string is a number */
+static void data_parse_num(sysobj_data *d) {
+    const gchar *b = d->str, *e = d->str + d->len, *p;
+    gchar buff[40], *end = NULL;
+    int r = 10;
+
+    if (!d->len || d->len > 32) return;
+    while (b < e && g_ascii_isspace(*b)) b++;
+    while (e > b && g_ascii_isspace(*(e-1))) e--;
+    p = b;
+    if (e - p > 2 && p[0] == '0' && p[1] == 'x') {
+        p += 2; r = 16;
+    }
+    for (; p < e; p++) {
+        if (!isxdigit((guchar)*p)) { r = 0; break; }
+        if (!isdigit((guchar)*p)) r = 16;
+    }
+    d->maybe_num = r;
+    if (b == e) return;
+
+    memcpy(buff, b, e - b);
+    buff[e - b] = 0;
+    errno = 0;
+    if (r) {
+        d->num.u64 = g_ascii_strtoull(buff, &end, r);
+        d->num_type = (r == 10 && d->num.u64 <= G_MAXINT64)
+            ? SO_NUM_INT64 : SO_NUM_UINT64;
+    } else {
+        /* signed or floating point */
+        if (strspn(buff, "0123456789+-.eE") != (gsize)(e - b))
+            return;
+        if (strpbrk(buff, ".eE")) {
+            d->num.dbl = g_ascii_strtod(buff, &end);
+            d->num_type = SO_NUM_DOUBLE;
+        } else {
+            d->num.i64 = g_ascii_strtoll(buff, &end, 10);
+            d->num_type = SO_NUM_INT64;
+        }
+    }
+    if (errno || end != buff + (e - b)) {
+        d->num_type = SO_NUM_NONE;
+        return;
+    }
+    d->num_base = r ? r : 10;
+}
+
+/* one walk over the data for utf8 validity, lines, trailing newline
+ * and blank; maybe_num only looks at short values */
+static void sysobj_data_derive(sysobj_data *d) {
+    const guchar *p, *end;
+    gsize nl = 0;
+    gboolean blank = TRUE;
+
+    if (d->derived) return;
+    d->derived = TRUE;
+    d->is_utf8 = FALSE;
+    d->lines = 0;
+    d->trailing_nl = FALSE;
+    d->blank = TRUE;
+    d->maybe_num = 0;
+    d->num_type = SO_NUM_NONE;
+    d->num_base = 0;
+    if (!d->was_read || !d->str || d->is_dir)
+        return;
+    sysobj_stats.so_read_derived++;
+
+    p = (const guchar *)d->str;
+    end = p + d->len;
+    while (p < end) {
+        guchar c = *p++, lo, hi;
+        if (c < 0x80) {
+            if (c == 0) return; /* embedded nul, not a string */
+            if (c == '\n') nl++;
+            if (blank && !g_ascii_isspace(c)) blank = FALSE;
+            continue;
+        }
+        blank = FALSE;
+        int n = utf8_lead(c, &lo, &hi);
+        if (n < 0 || end - p < n) return;
+        if (*p < lo || *p > hi) return;
+        for (p++, n--; n; n--, p++)
+            if ((*p & 0xc0) != 0x80) return;
+    }
+
+    d->is_utf8 = TRUE;
+    d->blank = blank;
+    d->trailing_nl = (d->len && d->str[d->len-1] == '\n');
+    /* as util_count_lines(): an empty last line isn't counted */
+    d->lines = d->len ? nl + (d->trailing_nl ? 0 : 1) : 0;
+    data_parse_num(d);
+}
+
+gboolean sysobj_data_is_utf8(sysobj_data *d) {
+    if (!d) return FALSE;
+    sysobj_data_derive(d);
+    return d->is_utf8;
+}
+
+gsize sysobj_data_lines(sysobj_data *d) {
+    if (!d) return 0;
+    sysobj_data_derive(d);
+    return d->lines;
+}
+
+gboolean sysobj_data_trailing_nl(sysobj_data *d) {
+    if (!d) return FALSE;
+    sysobj_data_derive(d);
+    return d->trailing_nl;
+}
+
+gboolean sysobj_data_blank(sysobj_data *d) {
+    if (!d) return TRUE;
+    sysobj_data_derive(d);
+    return d->blank;
+}
+
+int sysobj_data_maybe_num(sysobj_data *d) {
+    if (!d) return 0;
+    sysobj_data_derive(d);
+    return d->maybe_num;
+}
+
+int sysobj_data_num_type(sysobj_data *d) {
+    if (!d) return SO_NUM_NONE;
+    sysobj_data_derive(d);
+    return d->num_type;
+}
+
+/* the parsed value when it was parsed in the same base, otherwise
+ * re-read the string the way strtol() always did */
+static int64_t data_int64(const sysobj_data *d, int nbase) {
+    if (!d || !d->str) return 0;
+    if (d->derived && d->num_base == nbase) {
+        if (d->num_type == SO_NUM_INT64)
+            return d->num.i64;
+        if (d->num_type == SO_NUM_UINT64)
+            return (d->num.u64 > G_MAXINT64) ? G_MAXINT64 : (int64_t)d->num.u64;
+    }
+    return strtol(d->str, NULL, nbase);
+}
+
+int64_t sysobj_data_int64(sysobj_data *d, int nbase) {
+    if (!d) return 0;
+    sysobj_data_derive(d);
+    return data_int64(d, nbase);
+}
+
+double sysobj_data_double(sysobj_data *d) {
+    if (!d || !d->str) return 0;
+    sysobj_data_derive(d);
+    if (d->num_base == 10) {
+        switch(d->num_type) {
+            case SO_NUM_INT64: return (double)d->num.i64;
+            case SO_NUM_UINT64: return (double)d->num.u64;
+            case SO_NUM_DOUBLE: return d->num.dbl;
+        }
+    }
+    return strtod(d->str, NULL);
+}
+
 sysobj_data *sysobj_data_dup(const sysobj_data *src) {
     if (src) {
         sysobj_data *dest = g_memdup(src, sizeof(sysobj_data));
@@ -432,26 +664,140 @@ sysobj_data *sysobj_data_dup(const sysobj_data *src) {
     return NULL;
 }
 
+/* freed sysobj headers are kept here to be reused by sysobj_new(),
+ * instead of going back through malloc()/free() each time.
+ * Linked through the first pointer of each header. */
+#define SYSOBJ_SLAB_MAX 1024
+static GMutex slab_lock;
+static sysobj *slab_head = NULL;
+static guint slab_count = 0;
+
+static sysobj *slab_take() {
+    sysobj *s = NULL;
+    g_mutex_lock(&slab_lock);
+    if (slab_head) {
+        s = slab_head;
+        slab_head = *(sysobj**)s;
+        slab_count--;
+        sysobj_stats.so_slab_reuse++;
+    }
+    g_mutex_unlock(&slab_lock);
+    if (s)
+        memset(s, 0, sizeof(sysobj) );
+    return s;
+}
+
+static void slab_give(sysobj *s) {
+    g_mutex_lock(&slab_lock);
+    if (slab_count < SYSOBJ_SLAB_MAX) {
+        *(sysobj**)s = slab_head;
+        slab_head = s;
+        slab_count++;
+        s = NULL;
+    }
+    g_mutex_unlock(&slab_lock);
+    g_free(s);
+}
+
+static void slab_cleanup() {
+    g_mutex_lock(&slab_lock);
+    while (slab_head) {
+        sysobj *n = *(sysobj**)slab_head;
+        g_free(slab_head);
+        slab_head = n;
+    }
+    slab_count = 0;
+    g_mutex_unlock(&slab_lock);
+}
+
 sysobj *sysobj_new() {
-    sysobj *s = g_new0(sysobj, 1);
+    sysobj *s = slab_take();
+    if (!s)
+        s = g_new0(sysobj, 1);
     sysobj_stats.so_new++;
     return s;
 }
 
+/* like g_path_get_basename(), but returns the span
+ * of the last component in path without allocating */
+static const gchar *basename_span(const gchar *path, gsize *len) {
+    gsize b = 0, e = strlen(path);
+    if (!e) {
+        *len = 1;
+        return ".";
+    }
+    while (e > 1 && path[e-1] == '/') e--;
+    if (e == 1 && *path == '/') {
+        *len = 1;
+        return path;
+    }
+    b = e;
+    while (b > 0 && path[b-1] != '/') b--;
+    *len = e - b;
+    return path + b;
+}
+
+/* path_req and path are given as offsets into req_fs and fs.
+ * name_req and name are the basenames of path_req and path. */
+static void sysobj_set_strings(sysobj *s, const gchar *req_fs, gsize req_off, const gchar *fs, gsize fs_off, const gchar *link_target) {
+    gsize lrf = strlen(req_fs), lf = strlen(fs), lnr = 0, ln = 0;
+    gsize llt = link_target ? strlen(link_target) : 0;
+    const gchar *nr = basename_span(req_fs + req_off, &lnr);
+    const gchar *n = basename_span(fs + fs_off, &ln);
+    gchar *old = s->strings;
+    gchar *p = s->strings = g_malloc(lrf + lf + lnr + ln + llt + 5);
+
+    s->path_req_fs = p;
+    memcpy(p, req_fs, lrf + 1);
+    s->path_req = p + req_off;
+    p += lrf + 1;
+
+    s->path_fs = p;
+    memcpy(p, fs, lf + 1);
+    s->path = p + fs_off;
+    p += lf + 1;
+
+    s->name_req = p;
+    memcpy(p, nr, lnr);
+    p[lnr] = 0;
+    p += lnr + 1;
+
+    s->name = p;
+    memcpy(p, n, ln);
+    p[ln] = 0;
+    p += ln + 1;
+
+    if (link_target) {
+        s->req_link_target = p;
+        memcpy(p, link_target, llt + 1);
+    } else
+        s->req_link_target = NULL;
+
+    g_free(old);
+}
+
+/* because g_slist_copy_deep( .. , g_strdup, NULL)
+ * would have been too easy */
+static gchar *dumb_string_copy(gchar *src, gpointer *e) {
+    PARAM_NOT_UNUSED(e);
+    return g_strdup(src);
+}
+
 sysobj *sysobj_dup(const sysobj *src) {
-    sysobj *ret = g_memdup(src, sizeof(sysobj_data));
-    /* strings */
-    ret->path_req_fs = g_strdup(src->path_req_fs);
-    ret->name_req = g_strdup(src->name_req);
-    ret->path_fs = g_strdup(src->path_fs);
-    ret->name = g_strdup(src->name);
+    sysobj *ret = sysobj_new();
+    memcpy(ret, src, sizeof(sysobj) );
+    ret->strings = NULL;
 
-    /* pointers into strings */
-    ret->path = ret->path_fs + (src->path - src->path_fs);
-    ret->path_req = ret->path_req_fs + (src->path_req - src->path_req_fs);
+    /* strings */
+    if (src->strings)
+        sysobj_set_strings(ret,
+            src->path_req_fs, src->path_req - src->path_req_fs,
+            src->path_fs, src->path - src->path_fs,
+            src->req_link_target);
 
     /* data */
-    ret->data.any = g_memdup(ret->data.any, ret->data.len + 1);
+    ret->data.any = g_memdup(src->data.any, src->data.len + 1);
+    ret->data.childs = g_slist_copy_deep(src->data.childs, (GCopyFunc)dumb_string_copy, NULL);
 
     return ret;
 }
@@ -470,11 +816,7 @@ void sysobj_data_free(sysobj_data *d, gboolean and_self) {
 /* keep the pointer, but make it like the result of sysobj_new() */
 static void sysobj_free_and_clean(sysobj *s) {
     if (s) {
-        g_free(s->path_req_fs);
-        g_free(s->name_req);
-        g_free(s->path_fs);
-        g_free(s->name);
-        g_free(s->req_link_target);
+        g_free(s->strings);
         sysobj_data_free(&s->data, FALSE);
         memset(s, 0, sizeof(sysobj) );
         sysobj_stats.so_clean++;
@@ -484,7 +826,7 @@ static void sysobj_free_and_clean(sysobj *s) {
 void sysobj_free(sysobj *s) {
     if (s) {
         sysobj_free_and_clean(s);
-        g_free(s);
+        slab_give(s);
         sysobj_stats.so_free++;
     }
 }
@@ -565,9 +907,10 @@ void sysobj_fscheck(sysobj *s) {
 
         if (*(s->path) == ':') {
             /* virtual */
-            const sysobj_virt *vo = sysobj_virt_find(s->path);
+            sysobj_virt *vo = sysobj_virt_find(s->path);
             if (vo) {
                 int t = sysobj_virt_get_type(vo, s->path);
+                sysobj_virt_unref(vo);
                 if (t == VSO_TYPE_NONE) return;
                 s->exists = TRUE;
                 s->root_can_read = TRUE;
@@ -604,10 +947,11 @@ static void sysobj_read_dir(sysobj *s) {
 
     if (*(s->path) == ':') {
         /* virtual */
-        const sysobj_virt *vo = sysobj_virt_find(s->path);
+        sysobj_virt *vo = sysobj_virt_find(s->path);
         if (vo) {
             nl = sysobj_virt_children(vo, s->path);
             s->data.was_read = TRUE;
+            sysobj_virt_unref(vo);
         }
     } else {
         /* normal */
@@ -633,11 +977,13 @@ static void sysobj_read_data(sysobj *s) {
         /* virtual */
         s->data.was_read = FALSE;
         s->exists = FALSE;
-        const sysobj_virt *vo = sysobj_virt_find(s->path);
+        sysobj_virt *vo = sysobj_virt_find(s->path);
         if (vo) {
             int t = sysobj_virt_get_type(vo, s->path);
-            if (t == VSO_TYPE_NONE)
+            if (t == VSO_TYPE_NONE) {
+                sysobj_virt_unref(vo);
                 return; /* if it existed, it doesn't now */
+            }
             s->exists = TRUE;
 
             gboolean readable = s->others_can_read;
@@ -656,6 +1002,7 @@ static void sysobj_read_data(sysobj *s) {
                     s->exists = FALSE;
             } else
                 s->access_fail = TRUE;
+            sysobj_virt_unref(vo);
         }
     } else {
         /* normal */
@@ -666,14 +1013,10 @@ static void sysobj_read_data(sysobj *s) {
             s->access_fail = TRUE;
     }
 
-    if (s->data.was_read && s->data.str) {
+    /* utf8, lines, etc. are found later, only if asked for */
+    s->data.derived = FALSE;
+    if (s->data.was_read && s->data.str)
         sysobj_stats.so_read_bytes += s->data.len;
-        s->data.is_utf8 = g_utf8_validate(s->data.str, s->data.len, NULL);
-        if (s->data.is_utf8) {
-            s->data.lines = util_count_lines(s->data.str);
-            s->data.maybe_num = util_maybe_num(s->data.str);
-        }
-    }
 }
 
 gboolean sysobj_read_(sysobj *s, gboolean force, const char *call_func) {
@@ -708,6 +1051,8 @@ gboolean sysobj_read_(sysobj *s, gboolean force, const char *call_func) {
 
 void sysobj_unread_data(sysobj *s) {
     if (s) {
+        /* last chance to find them */
+        sysobj_data_derive(&s->data);
         if (s->data.was_read && s->data.any) {
             g_free(s->data.any);
             s->data.any = NULL;
@@ -774,13 +1119,6 @@ int sysfs_fn_cmp(gchar *a, gchar *b) {
     return 0;
 }
 
-/* because g_slist_copy_deep( .. , g_strdup, NULL)
- * would have been too easy */
-static gchar *dumb_string_copy(gchar *src, gpointer *e) {
-    PARAM_NOT_UNUSED(e);
-    return g_strdup(src);
-}
-
 GSList *sysobj_children_ex(sysobj *s, GSList *filters, gboolean sort) {
     GSList *ret = NULL;
     if (s) {
@@ -807,11 +1145,57 @@ GSList *sysobj_children(sysobj *s, const gchar *include_glob, const gchar *exclu
     return ret;
 }
 
+static gboolean path_cache_lookup(sysobj *s, const gchar *req, guint gen, gboolean *ok) {
+    gboolean found = FALSE;
+    if (!sysobj_global_timer) return FALSE;
+    g_mutex_lock(&path_cache_lock);
+    path_res *r = path_cache ? g_hash_table_lookup(path_cache, req) : NULL;
+    if (r && r->gen == gen
+        && sysobj_elapsed() - r->stamp < PATH_CACHE_MAX_AGE) {
+        sysobj_set_strings(s, r->req_fs, r->req_off, r->fs, r->fs_off, r->link_target);
+        s->req_is_link = r->req_is_link;
+        *ok = r->ok;
+        found = TRUE;
+    }
+    g_mutex_unlock(&path_cache_lock);
+    if (found)
+        sysobj_stats.so_path_cache_hit++;
+    else
+        sysobj_stats.so_path_cache_miss++;
+    return found;
+}
+
+static void path_cache_store(const gchar *req, guint gen, const sysobj *s, gboolean ok) {
+    if (!sysobj_global_timer) return;
+    path_res *r = g_new0(path_res, 1);
+    r->gen = gen;
+    r->stamp = sysobj_elapsed();
+    r->req_fs = g_strdup(s->path_req_fs);
+    r->req_off = s->path_req - s->path_req_fs;
+    r->fs = g_strdup(s->path_fs);
+    r->fs_off = s->path - s->path_fs;
+    r->link_target = g_strdup(s->req_link_target);
+    r->req_is_link = s->req_is_link;
+    r->ok = ok;
+    g_mutex_lock(&path_cache_lock);
+    if (!path_cache)
+        path_cache = g_hash_table_new_full(g_str_hash, g_str_equal, g_free, (GDestroyNotify)path_res_free);
+    if (g_hash_table_size(path_cache) >= PATH_CACHE_MAX_ITEMS)
+        g_hash_table_remove_all(path_cache);
+    g_hash_table_replace(path_cache, g_strdup(req), r);
+    g_mutex_unlock(&path_cache_lock);
+}
+
 gboolean sysobj_config_paths(sysobj *s, const gchar *base, const gchar *name) {
     gchar *req = NULL, *norm = NULL, *vlink = NULL, *chkpath = NULL, *fspath = NULL, *fspath_req = NULL;
+    gchar *link_target = NULL;
+    const gchar *req_fs = NULL;
+    gsize req_off = 0, fs_off = 0;
     gboolean target_is_real = FALSE, req_is_real = FALSE;
+    gboolean cacheable = TRUE, ok = FALSE;
     gchar *vlink_tmp = NULL;
     int vlr_count = 0;
+    guint gen = path_cache_gen_now();
 
     if (!s) return FALSE;
 
@@ -829,6 +1213,11 @@ gboolean sysobj_config_paths(sysobj *s, const gchar *base, const gchar *name) {
         req = norm;
     /* norm is now used or freed */
 
+    if (path_cache_lookup(s, req, gen, &ok) ) {
+        g_free(req);
+        return ok;
+    }
+
     /* virtual symlink */
     req_is_real = (*req == ':') ? FALSE : TRUE;
 
@@ -862,62 +1251,73 @@ gboolean sysobj_config_paths(sysobj *s, const gchar *base, const gchar *name) {
         fspath = g_strdup(vlink ? vlink : req);
     }
 
-    if (!fspath)
+    if (!fspath) {
         fspath = chkpath; /* the path may not exist */
-    else
+        cacheable = FALSE; /* ... yet */
+    } else
         g_free(chkpath);
 
-    /* set object paths */
-    s->path_req = s->path_req_fs = req;
-    s->path = s->path_fs = fspath;
+    /* object paths */
+    req_fs = req;
     if (USING_ALT_ROOT) {
         int alt_root_len = strlen(sysobj_root);
 
         if (req_is_real) {
             fspath_req = g_strdup_printf("%s%s%s", sysobj_root, (*req == '/') ? "" : "/", req);
-            g_free(req);
-            s->path_req_fs = fspath_req;
-            s->path_req = s->path_req_fs + alt_root_len;
+            req_fs = fspath_req;
+            req_off = alt_root_len;
         }
 
         if (target_is_real) {
             /* check for .. beyond sysobj_root */
-            if (!g_str_has_prefix(s->path_fs, sysobj_root) )
+            if (!g_str_has_prefix(fspath, sysobj_root) )
                 goto config_bad_path;
 
-            s->path = s->path_fs + alt_root_len;
+            fs_off = alt_root_len;
         }
     }
 
     if (vlink)
         s->req_is_link = TRUE;
     else {
-        s->req_is_link = g_file_test(s->path_req_fs, G_FILE_TEST_IS_SYMLINK);
+        s->req_is_link = g_file_test(req_fs, G_FILE_TEST_IS_SYMLINK);
         if (s->req_is_link) {
-            gchar *lt = g_file_read_link(s->path_req_fs, NULL);
+            gchar *lt = g_file_read_link(req_fs, NULL);
             if (lt) {
-                s->req_link_target = g_filename_to_utf8(lt, -1, NULL, NULL, NULL);
+                link_target = g_filename_to_utf8(lt, -1, NULL, NULL, NULL);
                 g_free(lt);
             }
         }
     }
 
     //DEBUG("\n{ .path_req_fs = %s\n  .path_req = %s\n  .path_fs = %s\n  .path = %s\n  .req_is_link = %s }",
-    //    s->path_req_fs, s->path_req, s->path_fs, s->path, s->req_is_link ? "TRUE" : "FALSE" );
+    //    req_fs, req_fs + req_off, fspath, fspath + fs_off, s->req_is_link ? "TRUE" : "FALSE" );
 
     if (target_is_real
-        && !sysobj_filter_item_include(s->path, sysobj_global_filters) ) {
+        && !sysobj_filter_item_include(fspath + fs_off, sysobj_global_filters) ) {
             goto config_bad_path;
     }
 
+    sysobj_set_strings(s, req_fs, req_off, fspath, fs_off, link_target);
+    if (cacheable)
+        path_cache_store(req, gen, s, TRUE);
+    g_free(req);
+    g_free(fspath_req);
+    g_free(fspath);
+    g_free(link_target);
     g_free(vlink);
     return TRUE;
 
 config_bad_path:
-    DEBUG("BAD PATH: %s -> %s (%s)", s->path_req, s->path, s->path_fs);
+    DEBUG("BAD PATH: %s -> %s (%s)", req_fs + req_off, fspath + fs_off, fspath);
+    sysobj_set_strings(s, req_fs, req_off, ":error/bad_path", 0, link_target);
+    if (cacheable)
+        path_cache_store(req, gen, s, FALSE);
+    g_free(req);
+    g_free(fspath_req);
     g_free(fspath);
+    g_free(link_target);
     g_free(vlink);
-    s->path = s->path_fs = g_strdup(":error/bad_path");
     return FALSE;
 }
 
@@ -927,8 +1327,6 @@ sysobj *sysobj_new_fast(const gchar *path) {
         s = sysobj_new();
         s->fast_mode = TRUE;
         sysobj_config_paths(s, path, NULL);
-        s->name_req = g_path_get_basename(s->path_req);
-        s->name = g_path_get_basename(s->path);
         sysobj_fscheck(s);
         sysobj_stats.so_new_fast++;
     }
@@ -947,8 +1345,6 @@ sysobj *sysobj_new_from_fn(const gchar *base, const gchar *name) {
     if (base) {
         s = sysobj_new();
         sysobj_config_paths(s, base, name);
-        s->name_req = g_path_get_basename(s->path_req);
-        s->name = g_path_get_basename(s->path);
         sysobj_fscheck(s);
         sysobj_classify(s);
     }
@@ -1158,6 +1554,8 @@ void sysobj_init(const gchar *alt_root) {
         g_free(self_net);
     }
 
+    sysobj_path_cache_invalidate(); /* filters changed */
+
     sysobj_global_timer = g_timer_new();
     g_timer_start(sysobj_global_timer);
 
@@ -1172,11 +1570,16 @@ double sysobj_elapsed() {
 }
 
 void sysobj_cleanup() {
+    uevent_cleanup(); /* stop before anything it could touch goes */
     free_auto_free_final();
     class_cleanup();
     sysobj_virt_cleanup();
+    slab_cleanup();
+    path_cache_cleanup();
+    path_intern_cleanup();
     vendor_cleanup();
     g_timer_destroy(sysobj_global_timer);
+    sysobj_global_timer = NULL;
     g_slist_free_full(sysobj_data_paths, (GDestroyNotify)g_free);
 }
 
@@ -1255,7 +1658,7 @@ int class_count() {
 vendor_list simple_vendors(sysobj *s) {
     if (sysobj_has_flag(s, OF_HAS_VENDOR) ) {
         sysobj_read(s, FALSE);
-        if (!s->data.is_utf8)
+        if (!sysobj_data_is_utf8(&s->data))
             return NULL;
         //const Vendor *v = vendor_match(s->data.str, NULL);
         //if (v)
@@ -0,0 +1,249 @@
+/*
+ * sysobj - https://github.com/bp0/verbose-spork
+ * Copyright (C) 2018  Burt P. <pburt0@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#include <sys/stat.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <glib/gstdio.h>
+#include "sysobj_cache.h"
+
+#define cache_msg(fmt, ...) fprintf (stderr, "[%s] " fmt "\n", __FUNCTION__, ##__VA_ARGS__)
+
+/* bump when the file layout changes */
+#define CACHE_MAGIC "SOVC"
+#define CACHE_FORMAT 1
+#define CACHE_STR_NULL 0xffffffff
+
+gboolean sysobj_cache_enabled = TRUE;
+
+static gchar *cache_file(const gchar *name) {
+    gchar *fn = g_strdup_printf("%s.cache", name);
+    gchar *ret = g_build_filename(g_get_user_cache_dir(), "sysobj", fn, NULL);
+    g_free(fn);
+    return ret;
+}
+
+static gboolean cache_usable() {
+    return sysobj_cache_enabled && !sysobj_using_alt_root();
+}
+
+static gchar *stat_fingerprint(const gchar *file) {
+    struct stat st;
+    if (!file || stat(file, &st) != 0)
+        return g_strdup("none");
+    return g_strdup_printf("%s:%lld:%lld.%09ld", file,
+        (long long)st.st_size, (long long)st.st_mtim.tv_sec, (long)st.st_mtim.tv_nsec);
+}
+
+gchar *sysobj_cache_key(const gchar * const *data_files, const gchar *extra) {
+    if (!cache_usable())
+        return NULL;
+
+    gchar *boot_id = NULL;
+    if (!g_file_get_contents("/proc/sys/kernel/random/boot_id", &boot_id, NULL, NULL))
+        return NULL; /* then no way to know when it's stale */
+    g_strstrip(boot_id);
+
+    /* rebuilt, or a different build, even of the same version */
+    gchar *exe = stat_fingerprint("/proc/self/exe");
+    gchar *key = g_strdup_printf("boot_id=%s\nexe=%s\n", boot_id, exe);
+    g_free(boot_id);
+    g_free(exe);
+
+    for (int i = 0; data_files && data_files[i]; i++) {
+        gchar *file = sysobj_find_data_file(data_files[i]);
+        gchar *fp = stat_fingerprint(file);
+        key = appf(key, "", "data=%s=%s\n", data_files[i], fp);
+        g_free(file);
+        g_free(fp);
+    }
+    if (extra) {
+        gchar *sum = g_compute_checksum_for_string(G_CHECKSUM_SHA1, extra, -1);
+        key = appf(key, "", "extra=%s\n", sum);
+        g_free(sum);
+    }
+    return key;
+}
+
+/* file: magic, u32 format, u32 key_len, key, u32 count,
+ * then count of { u32 type, u32 path_len, path, u32 str_len, str }
+ * with str_len CACHE_STR_NULL for a NULL str. Native byte order,
+ * it never leaves the machine. */
+
+static void put_u32(GByteArray *b, guint32 v) {
+    g_byte_array_append(b, (guint8*)&v, sizeof(v));
+}
+
+static void put_str(GByteArray *b, const gchar *s) {
+    if (!s) {
+        put_u32(b, CACHE_STR_NULL);
+        return;
+    }
+    guint32 len = strlen(s);
+    put_u32(b, len);
+    g_byte_array_append(b, (guint8*)s, len);
+}
+
+typedef struct {
+    const gchar *p, *end;
+} cache_reader;
+
+static gboolean get_u32(cache_reader *r, guint32 *v) {
+    if (r->end - r->p < (ssize_t)sizeof(guint32))
+        return FALSE;
+    memcpy(v, r->p, sizeof(guint32));
+    r->p += sizeof(guint32);
+    return TRUE;
+}
+
+static gboolean get_str(cache_reader *r, gchar **s) {
+    guint32 len;
+    if (!get_u32(r, &len))
+        return FALSE;
+    if (len == CACHE_STR_NULL) {
+        *s = NULL;
+        return TRUE;
+    }
+    if ((guint64)(r->end - r->p) < len)
+        return FALSE;
+    *s = g_strndup(r->p, len);
+    r->p += len;
+    return TRUE;
+}
+
+/* only this user can see it, from the moment it exists */
+static gboolean cache_write(const gchar *fn, const guint8 *data, gsize len) {
+    gchar *dir = g_path_get_dirname(fn);
+    gboolean ret = (g_mkdir_with_parents(dir, 0700) == 0);
+    if (ret) {
+        /* an existing dir keeps its mode */
+        struct stat st;
+        ret = (g_stat(dir, &st) == 0);
+        if (ret && (st.st_mode & 077))
+            ret = (g_chmod(dir, 0700) == 0);
+    }
+    g_free(dir);
+    if (!ret)
+        return FALSE;
+
+    gchar *tmp = g_strdup_printf("%s.XXXXXX", fn);
+    int fd = g_mkstemp_full(tmp, O_WRONLY, 0600); /* O_CREAT | O_EXCL */
+    if (fd < 0) {
+        g_free(tmp);
+        return FALSE;
+    }
+    gsize done = 0;
+    while (done < len) {
+        ssize_t w = write(fd, data + done, len - done);
+        if (w < 0 && errno == EINTR)
+            continue;
+        if (w <= 0)
+            break;
+        done += w;
+    }
+    ret = (done == len);
+    if (close(fd) != 0)
+        ret = FALSE;
+    if (ret)
+        ret = (g_rename(tmp, fn) == 0);
+    if (!ret)
+        g_unlink(tmp);
+    g_free(tmp);
+    return ret;
+}
+
+gboolean sysobj_cache_save_list(const gchar *name, const gchar *key, GSList *vos) {
+    if (!key || !cache_usable())
+        return FALSE;
+
+    GByteArray *b = g_byte_array_new();
+    g_byte_array_append(b, (guint8*)CACHE_MAGIC, 4);
+    put_u32(b, CACHE_FORMAT);
+    put_str(b, key);
+    put_u32(b, g_slist_length(vos));
+    for (GSList *l = vos; l; l = l->next) {
+        sysobj_virt *vo = l->data;
+        put_u32(b, vo->type);
+        put_str(b, vo->path);
+        put_str(b, vo->str);
+    }
+
+    /* may hold things only root could read, like serial numbers */
+    gchar *fn = cache_file(name);
+    gboolean ret = cache_write(fn, b->data, b->len);
+    if (!ret)
+        cache_msg("couldn't write %s", fn);
+    g_free(fn);
+    g_byte_array_free(b, TRUE);
+    return ret;
+}
+
+gboolean sysobj_cache_save(const gchar *name, const gchar *key, const gchar *glob) {
+    if (!key || !cache_usable())
+        return FALSE;
+    GSList *vos = sysobj_virt_dup_static(glob);
+    gboolean ret = sysobj_cache_save_list(name, key, vos);
+    g_slist_free_full(vos, (GDestroyNotify)sysobj_virt_free);
+    return ret;
+}
+
+gboolean sysobj_cache_restore(const gchar *name, const gchar *key) {
+    if (!key || !cache_usable())
+        return FALSE;
+
+    gchar *fn = cache_file(name);
+    gchar *data = NULL;
+    gsize len = 0;
+    gboolean ok = g_file_get_contents(fn, &data, &len, NULL);
+    g_free(fn);
+    if (!ok)
+        return FALSE;
+
+    cache_reader r = { data, data + len };
+    GSList *vos = NULL;
+    gchar *file_key = NULL;
+    guint32 format = 0, count = 0;
+    ok = (len >= 4 && !memcmp(data, CACHE_MAGIC, 4));
+    r.p += 4;
+    ok = ok && get_u32(&r, &format) && format == CACHE_FORMAT
+        && get_str(&r, &file_key) && SEQ(file_key, key)
+        && get_u32(&r, &count);
+    for (guint32 i = 0; ok && i < count; i++) {
+        guint32 type;
+        sysobj_virt *vo = sysobj_virt_new();
+        vos = g_slist_prepend(vos, vo);
+        ok = get_u32(&r, &type) && get_str(&r, &vo->path) && get_str(&r, &vo->str)
+            && vo->path;
+        vo->type = type & ~(VSO_TYPE_CONST | VSO_TYPE_CLEANUP);
+    }
+    ok = ok && r.p == r.end;
+    g_free(file_key);
+    g_free(data);
+
+    if (!ok) {
+        /* stale or damaged, it will be overwritten */
+        g_slist_free_full(vos, (GDestroyNotify)sysobj_virt_free);
+        return FALSE;
+    }
+    sysobj_stats.vcache_restored += count;
+    sysobj_virt_add_list(g_slist_reverse(vos));
+    return TRUE;
+}
@@ -19,43 +19,12 @@
  */
 
 #include "sysobj_foreach.h"
+#include "path_intern.h"
 #include <unistd.h> /* for usleep() */
 
-static GList* __push_if_uniq(GList *l, const gchar *base, const gchar *name, long unsigned int *length) {
-    gchar *path = name
-        ? g_strdup_printf("%s/%s", base, name)
-        : g_strdup(base);
-    GList *a = NULL, *last = a;
-    for(a = l; a; a = a->next) {
-        if (SEQ((gchar*)a->data, path) ) {
-            g_free(path);
-            return l;
-        }
-        last = a;
-    }
-    if (length) (*length)++;
-    if (last)
-        last = g_list_append(last, path);
-    else
-        l = g_list_append(l, path);
-    return l;
-}
-
-static GList* __shift(GList *l, gchar **s) {
-    if (!l) return l;
-    *s = (gchar*)l->data;
-    return g_list_delete_link(l, l);
-}
-
-static GList* __pop(GList *l, gchar **s) {
-    GList *last = g_list_last(l);
-    if (last)
-        *s = (gchar*)last->data;
-    return g_list_delete_link(l, last);
-}
-
 typedef struct {
-    GList *to_search;
+    GQueue to_search;   /* of const path_intern* */
+    GHashTable *queued; /* the same path_intern*, for uniqueness */
     GMutex lock;
     GMutex lock_stats;
     gboolean stop;
@@ -69,10 +38,43 @@ typedef struct {
     sysobj_foreach_stats stats;
 } mt_state;
 
+/* call with s->lock held */
+static void __push_if_uniq(mt_state *s, const gchar *base, const gchar *name) {
+    gchar *path = name
+        ? g_strdup_printf("%s/%s", base, name)
+        : g_strdup(base);
+    const path_intern *ip = path_intern_get(path);
+    g_free(path);
+    if (g_hash_table_contains(s->queued, ip) ) {
+        path_intern_unref(ip);
+        return;
+    }
+    g_hash_table_add(s->queued, (gpointer)ip);
+    g_queue_push_tail(&s->to_search, (gpointer)ip);
+    s->stats.queue_length++;
+}
+
+/* call with s->lock held */
+static const path_intern *__shift(mt_state *s) {
+    const path_intern *ip = g_queue_pop_head(&s->to_search);
+    if (ip)
+        g_hash_table_remove(s->queued, ip);
+    return ip;
+}
+
+/* call with s->lock held */
+static const path_intern *__pop(mt_state *s) {
+    const path_intern *ip = g_queue_pop_tail(&s->to_search);
+    if (ip)
+        g_hash_table_remove(s->queued, ip);
+    return ip;
+}
+
 static void mt_state_init(mt_state *s) {
     if (!s) return;
     s->stop = FALSE;
-    s->to_search = NULL;
+    g_queue_init(&s->to_search);
+    s->queued = g_hash_table_new(g_direct_hash, g_direct_equal);
     memset(&s->stats, 0, sizeof(sysobj_foreach_stats) );
     s->stats.start_time = sysobj_elapsed();
     g_mutex_init(&s->lock);
@@ -80,7 +82,10 @@ static void mt_state_init(mt_state *s) {
 }
 
 static void mt_state_clear(mt_state *s) {
-    g_list_free_full(s->to_search, g_free);
+    const path_intern *ip = NULL;
+    while ( (ip = g_queue_pop_head(&s->to_search)) )
+        path_intern_unref(ip);
+    g_hash_table_destroy(s->queued);
     g_mutex_clear(&s->lock);
     g_mutex_clear(&s->lock_stats);
     g_slist_free(s->threads);
@@ -97,10 +102,10 @@ static void mt_update(mt_state *s, guint increment) {
 #define WAIT_TOO_MUCH 2000000
 
 static gpointer _sysobj_foreach_thread_main(mt_state *s) {
-    gchar *path = NULL;
+    const path_intern *path = NULL;
     while(1) {
         if (path) {
-            g_free(path);
+            path_intern_unref(path);
             path = NULL;
         }
 
@@ -117,8 +122,8 @@ static gpointer _sysobj_foreach_thread_main(mt_state *s) {
         }
 
         g_mutex_lock(&s->lock);
-        //s->to_search = __shift(s->to_search, &path); // breadth-first
-        s->to_search = __pop(s->to_search, &path); // depth-first
+        //path = __shift(s); // breadth-first
+        path = __pop(s); // depth-first
         g_mutex_unlock(&s->lock);
 
         if (!path) {
@@ -137,10 +142,10 @@ static gpointer _sysobj_foreach_thread_main(mt_state *s) {
 
         if (0)
         printf("[%p](rate: %0.2lf/s) to_search:%lu searched:%lu now: %s\n",
-            g_thread_self(), s->stats.rate, s->stats.queue_length, s->stats.searched, path);
+            g_thread_self(), s->stats.rate, s->stats.queue_length, s->stats.searched, path->str);
 
-        sysobj *obj = sysobj_new_fast(path);
-        if (!obj) { g_free(path); continue; }
+        sysobj *obj = sysobj_new_fast(path->str);
+        if (!obj) continue;
         if (s->filters
             && !sysobj_filter_item_include(obj->path, s->filters) ) {
                 sysobj_free(obj);
@@ -165,7 +170,7 @@ static gpointer _sysobj_foreach_thread_main(mt_state *s) {
         /* queue children */
         const GSList *lc = obj->data.childs;
         for (lc = obj->data.childs; lc; lc = lc->next) {
-            s->to_search = __push_if_uniq(s->to_search, obj->path_req, (gchar*)lc->data, &s->stats.queue_length);
+            __push_if_uniq(s, obj->path_req, (gchar*)lc->data);
         }
         g_mutex_unlock(&s->lock);
 
@@ -187,11 +192,11 @@ static void sysobj_foreach_mt(const gchar *root_path, GSList *filters, f_sysobj_
     if (max_threads && state.stats.threads > max_threads)
         state.stats.threads = max_threads;
     if (root_path)
-        state.to_search = __push_if_uniq(state.to_search, root_path, NULL, &state.stats.queue_length);
+        __push_if_uniq(&state, root_path, NULL);
     else {
-        state.to_search = __push_if_uniq(state.to_search, ":/", NULL, &state.stats.queue_length);
-        state.to_search = __push_if_uniq(state.to_search, "/sys", NULL, &state.stats.queue_length);
-        state.to_search = __push_if_uniq(state.to_search, "/proc", NULL, &state.stats.queue_length);
+        __push_if_uniq(&state, ":/", NULL);
+        __push_if_uniq(&state, "/sys", NULL);
+        __push_if_uniq(&state, "/proc", NULL);
     }
 
     if (state.stats.threads == 1) {
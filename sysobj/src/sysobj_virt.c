@@ -23,138 +23,450 @@
 
 #define virt_msg(fmt, ...) fprintf (stderr, "[%s] " fmt "\n", __FUNCTION__, ##__VA_ARGS__)
 
-static GTree *vo_tree = NULL;
+/* the non-DYN objects, ordered by path for range scans,
+ * and indexed by interned path for exact lookups */
+static GSequence *vo_seq = NULL;
+static GHashTable *vo_index = NULL; /* path_intern* -> GSequenceIter* */
 static GSList *vo_list = NULL;
 static GMutex vo_lock;
+static gint vo_gen = 0;
+static gint vo_link_gen = 0;
 
-static gint g_strcmp0_data(const gchar *s1, const gchar *s2, gpointer np) { return g_strcmp0(s1,s2); }
+guint sysobj_virt_gen() {
+    return (guint)g_atomic_int_get(&vo_gen);
+}
 
-void sysobj_virt_init() {
-    vo_tree = g_tree_new_full((GCompareDataFunc)g_strcmp0_data, NULL, g_free, (GDestroyNotify)sysobj_virt_free);
+guint sysobj_virt_link_gen() {
+    return (guint)g_atomic_int_get(&vo_link_gen);
 }
 
-/* 0 = both, 1 = vo_tree, 2 = vo_list */
-int sysobj_virt_count_ex(int what) {
-    switch(what) {
-        case 2: return g_slist_length(vo_list);
-        case 1: return g_tree_nnodes(vo_tree);
+/* could adding or removing vo change where a path resolves:
+ * it is, or may be, a symlink, it is DYN and so matches paths
+ * below it, or it hides part of a DYN symlink. requires vo_lock */
+static gboolean virt_is_link_change(const sysobj_virt *vo) {
+    if (vo->f_get_type || vo->type & (VSO_TYPE_SYMLINK | VSO_TYPE_DYN) )
+        return TRUE;
+    for (GSList *l = vo_list; l; l = l->next) {
+        const sysobj_virt *dv = l->data;
+        if (dv->type & VSO_TYPE_SYMLINK
+            && g_str_has_prefix(vo->path, dv->path)
+            && vo->path[dv->ipath->len] == '/')
+            return TRUE;
     }
-    return g_tree_nnodes(vo_tree) + g_slist_length(vo_list);
+    return FALSE;
 }
 
-static int virt_path_cmp(sysobj_virt *a, sysobj_virt *b) {
-    /* one or both are null */
-    if (!a) return b ? -1 : 0;
-    if (!b) return 1;
-    return g_strcmp0(a->path, b->path);
+static void virt_link_change(const sysobj_virt *vo) {
+    if (virt_is_link_change(vo))
+        g_atomic_int_inc(&vo_link_gen);
 }
 
-void _remove1(gchar *path) {
-    //virt_msg("rm virtual %s", path);
+/* lazy roots, only added before use, so the list
+ * itself isn't locked */
+typedef struct {
+    gchar *root;
+    gsize len;
+    gboolean (*f_trigger)(gpointer);
+    gpointer data;
+    gint done;
+} virt_lazy;
+static GSList *lazy_list = NULL;
+static gint lazy_pending = 0;
+
+static void lazy_run(virt_lazy *lz) {
+    /* f_trigger is responsible for once-only, and returns
+     * FALSE if it was already underway in this thread */
+    if (lz->f_trigger(lz->data)
+        && g_atomic_int_compare_and_exchange(&lz->done, 0, 1))
+        g_atomic_int_add(&lazy_pending, -1);
+}
 
-    /* tree */
-    gboolean found = FALSE;
-    found = g_tree_remove(vo_tree, path);
-    if (found) {
-        sysobj_stats.so_virt_rm++;
-        return;
+void sysobj_virt_add_lazy(const gchar *root, gboolean (*f_trigger)(gpointer), gpointer data) {
+    virt_lazy *lz = g_new0(virt_lazy, 1);
+    lz->root = g_strdup(root);
+    lz->len = strlen(root);
+    lz->f_trigger = f_trigger;
+    lz->data = data;
+    lazy_list = g_slist_append(lazy_list, lz);
+    g_atomic_int_inc(&lazy_pending);
+}
+
+/* below = FALSE: trigger the deepest root that path is in,
+ * below = TRUE: also all the roots that are in path.
+ * Only the deepest, because the generator for :/a/b may
+ * itself look in :/a/b, which would pull in the one for :/a
+ * (that perhaps requires :/a/b) too early. */
+static void lazy_trigger(const gchar *path, gboolean below) {
+    if (!g_atomic_int_get(&lazy_pending)) return;
+    virt_lazy *best = NULL;
+    gsize plen = strlen(path);
+    for (GSList *l = lazy_list; l; l = l->next) {
+        virt_lazy *lz = l->data;
+        if (g_atomic_int_get(&lz->done)) continue;
+        if (plen >= lz->len && !strncmp(path, lz->root, lz->len)
+            && (path[lz->len] == 0 || path[lz->len] == '/') ) {
+            if (!best || lz->len > best->len)
+                best = lz;
+        } else if (below && plen < lz->len && !strncmp(path, lz->root, plen)
+            && lz->root[plen] == '/')
+            lazy_run(lz);
     }
+    if (best)
+        lazy_run(best);
+}
 
-    /* list */
-    sysobj_virt svo = { .path = path };
-    GSList *t = g_slist_find_custom(vo_list, &svo, (GCompareFunc)virt_path_cmp);
-    if (t) {
-        sysobj_virt *tv = t->data;
-        sysobj_virt_free(tv);
-        vo_list = g_slist_delete_link(vo_list, t);
-        sysobj_stats.so_virt_rm++;
+void sysobj_virt_lazy_trigger(const gchar *path) {
+    if (path)
+        lazy_trigger(path, FALSE);
+}
+
+/* a probe (no ipath) sorts before an equal path, so
+ * g_sequence_search() with one finds the lower bound */
+static gint seq_cmp(const sysobj_virt *a, const sysobj_virt *b, gpointer unused) {
+    int r = strcmp(a->path, b->path);
+    if (r) return r;
+    if (!a->ipath != !b->ipath)
+        return a->ipath ? 1 : -1;
+    return 0;
+}
+
+/* first at or after path */
+static GSequenceIter *seq_lower_bound(const gchar *path) {
+    sysobj_virt probe = { .path = (gchar*)path };
+    return g_sequence_search(vo_seq, &probe, (GCompareDataFunc)seq_cmp, NULL);
+}
+
+static GSequenceIter *seq_find(const gchar *path) {
+    const path_intern *ip = path_intern_peek(path);
+    return ip ? g_hash_table_lookup(vo_index, ip) : NULL;
+}
+
+static sysobj_virt *seq_lookup(const gchar *path) {
+    GSequenceIter *it = seq_find(path);
+    return it ? g_sequence_get(it) : NULL;
+}
+
+static void seq_remove(GSequenceIter *it) {
+    sysobj_virt *vo = g_sequence_get(it);
+    g_hash_table_remove(vo_index, vo->ipath);
+    g_sequence_remove(it);
+    virt_link_change(vo);
+    sysobj_virt_unref(vo);
+    g_atomic_int_inc(&vo_gen);
+    sysobj_stats.so_virt_rm++;
+}
+
+/* the part of a glob before the first wildcard, everything
+ * it can match starts with that */
+static gsize glob_literal_len(const gchar *glob) {
+    return strcspn(glob, "*?");
+}
+
+void sysobj_virt_init() {
+    vo_seq = g_sequence_new(NULL);
+    vo_index = g_hash_table_new(g_direct_hash, g_direct_equal);
+}
+
+/* 0 = both, 1 = vo_seq, 2 = vo_list */
+int sysobj_virt_count_ex(int what) {
+    switch(what) {
+        case 2: return g_slist_length(vo_list);
+        case 1: return g_sequence_get_length(vo_seq);
     }
+    return g_sequence_get_length(vo_seq) + g_slist_length(vo_list);
 }
 
 void sysobj_virt_remove(gchar *glob) {
+    GPatternSpec *pspec = g_pattern_spec_new(glob);
+    gsize lit = glob_literal_len(glob);
+    gchar *prefix = g_strndup(glob, lit);
+    /* "<literal>*" is a whole range, no need to match each */
+    gboolean whole = (glob[lit] == '*' && glob[lit+1] == 0);
+
     g_mutex_lock(&vo_lock);
-    sysobj_filter *f = sysobj_filter_new(SO_FILTER_INCLUDE_IIF, glob);
-    GSList *torm = sysobj_virt_all_paths();
-    GSList *fl = g_slist_append(NULL, f);
-    torm = sysobj_filter_list(torm, fl);
-    GSList *l = torm;
-    while(l) {
-        _remove1(l->data);
-        g_free(l->data); /* won't need again */
-        l = l->next;
-    }
-    g_slist_free(torm);
-    g_slist_free_full(fl, (GDestroyNotify)sysobj_filter_free);
+    /* ordered: only the range that starts with the literal part */
+    GSequenceIter *it = seq_lower_bound(prefix);
+    while (!g_sequence_iter_is_end(it)) {
+        sysobj_stats.so_virt_iter++;
+        sysobj_virt *vo = g_sequence_get(it);
+        GSequenceIter *next = g_sequence_iter_next(it);
+        if (strncmp(vo->path, prefix, lit) != 0)
+            break;
+        if (whole || g_pattern_match(pspec, strlen(vo->path), vo->path, NULL) )
+            seq_remove(it);
+        it = next;
+    }
+
+    /* list */
+    GSList *l = vo_list;
+    while (l) {
+        sysobj_stats.so_virt_iter++;
+        sysobj_virt *vo = l->data;
+        GSList *next = l->next;
+        if (g_pattern_match(pspec, strlen(vo->path), vo->path, NULL) ) {
+            vo_list = g_slist_delete_link(vo_list, l);
+            g_atomic_int_inc(&vo_link_gen); /* DYN */
+            sysobj_virt_unref(vo);
+            g_atomic_int_inc(&vo_gen);
+            sysobj_stats.so_virt_rm++;
+        }
+        l = next;
+    }
     g_mutex_unlock(&vo_lock);
+    g_free(prefix);
+    g_pattern_spec_free(pspec);
 }
 
-gboolean sysobj_virt_add(sysobj_virt *vo) {
-    if (vo) {
-        /* check for errors */
-        if (vo->type == VSO_TYPE_CLEANUP
-            && !vo->f_get_data) {
-            virt_msg("requested cleanup but no .f_get_data for %s", vo->path);
-            sysobj_virt_free(vo);
-            return FALSE;
-        }
-        if (vo->type == VSO_TYPE_NONE
-            && !vo->f_get_type) {
-            virt_msg("no .type or .f_get_type for %s", vo->path);
-            sysobj_virt_free(vo);
+/* frees vo and returns FALSE if it can't be added */
+static gboolean virt_check(sysobj_virt *vo) {
+    if (vo->type == VSO_TYPE_CLEANUP
+        && !vo->f_get_data) {
+        virt_msg("requested cleanup but no .f_get_data for %s", vo->path);
+        sysobj_virt_free(vo);
+        return FALSE;
+    }
+    if (vo->type == VSO_TYPE_NONE
+        && !vo->f_get_type) {
+        virt_msg("no .type or .f_get_type for %s", vo->path);
+        sysobj_virt_free(vo);
+        return FALSE;
+    }
+    if (!vo->f_get_data
+        && !(vo->type & VSO_TYPE_SYMLINK)
+        && vo->type & VSO_TYPE_DYN ) {
+        virt_msg(".type is VSO_TYPE_DYN, but not VSO_TYPE_SYMLINK, and no .f_get_data for %s", vo->path);
+        sysobj_virt_free(vo);
+        return FALSE;
+    }
+    if (vo->type & VSO_TYPE_CONST
+        && (vo->type & VSO_TYPE_WRITE || vo->type & VSO_TYPE_WRITE_REQ_ROOT)
+        && !vo->f_set_data) {
+        virt_msg(".type is VSO_TYPE_CONST, and no .f_set_data for %s", vo->path);
+        sysobj_virt_free(vo);
+        return FALSE;
+    }
+    return TRUE;
+}
+
+/* requires vo_lock */
+static gboolean virt_add_locked(sysobj_virt *vo) {
+    /* search for existing, replace or add */
+    g_atomic_int_inc(&vo_gen);
+    g_atomic_int_inc(&vo->ref); /* the store's */
+    virt_link_change(vo);
+
+    if (!(vo->type & VSO_TYPE_DYN)) {
+        /* if not DYN, then put it in the ordered set */
+        GSequenceIter *it = g_hash_table_lookup(vo_index, vo->ipath);
+        if (it) {
+            sysobj_virt *tv = g_sequence_get(it);
+            g_sequence_set(it, vo);
+            virt_link_change(tv);
+            sysobj_virt_unref(tv); /* vo holds its own ref to ipath */
+            sysobj_stats.so_virt_replace++;
             return FALSE;
         }
-        if (!vo->f_get_data
-            && !(vo->type & VSO_TYPE_SYMLINK)
-            && vo->type & VSO_TYPE_DYN ) {
-            virt_msg(".type is VSO_TYPE_DYN, but not VSO_TYPE_SYMLINK, and no .f_get_data for %s", vo->path);
-            sysobj_virt_free(vo);
+        it = g_sequence_insert_sorted(vo_seq, vo, (GCompareDataFunc)seq_cmp, NULL);
+        g_hash_table_insert(vo_index, (gpointer)vo->ipath, it);
+        sysobj_stats.so_virt_add++;
+        return TRUE;
+    }
+
+    /* ... else the list */
+    for (GSList *l = vo_list; l; l = l->next) {
+        sysobj_stats.so_virt_iter++;
+        sysobj_virt *lv = l->data;
+        if (lv->ipath == vo->ipath) {
+            /* already exists, overwrite */
+            sysobj_virt_unref(lv);
+            l->data = (gpointer*)vo;
+            sysobj_stats.so_virt_replace++;
             return FALSE;
         }
-        if (vo->type & VSO_TYPE_CONST
-            && (vo->type & VSO_TYPE_WRITE || vo->type & VSO_TYPE_WRITE_REQ_ROOT)
-            && !vo->f_set_data) {
-            virt_msg(".type is VSO_TYPE_CONST, and no .f_set_data for %s", vo->path);
-            sysobj_virt_free(vo);
-            return FALSE;
+    }
+    //virt_msg("add virtual object to list: %s [%s]", vo->path, vo->str);
+    vo_list = g_slist_append(vo_list, vo);
+    sysobj_stats.so_virt_add++;
+    return TRUE;
+}
+
+gboolean sysobj_virt_add(sysobj_virt *vo) {
+    if (!vo || !virt_check(vo))
+        return FALSE;
+
+    vo->ipath = path_intern_get(vo->path);
+
+    g_mutex_lock(&vo_lock);
+    gboolean ret = virt_add_locked(vo);
+    g_mutex_unlock(&vo_lock);
+    return ret;
+}
+
+sysobj_virt_batch *sysobj_virt_batch_new(gboolean mkpath) {
+    sysobj_virt_batch *b = g_new0(sysobj_virt_batch, 1);
+    b->vos = g_ptr_array_new();
+    b->mkpath = mkpath;
+    return b;
+}
+
+void sysobj_virt_batch_add(sysobj_virt_batch *b, sysobj_virt *vo) {
+    if (vo)
+        g_ptr_array_add(b->vos, vo);
+}
+
+void sysobj_virt_batch_add_simple(sysobj_virt_batch *b, const gchar *base, const gchar *name, const gchar *data, int type) {
+    sysobj_virt *vo = g_new0(sysobj_virt, 1);
+    vo->path = util_build_fn(base, name);
+    vo->type = type;
+    vo->str = g_strdup(data);
+    g_ptr_array_add(b->vos, vo);
+}
+
+static gint virt_cmp_path(sysobj_virt **a, sysobj_virt **b) {
+    return g_strcmp0((*a)->path, (*b)->path);
+}
+
+/* requires vo_lock. The parent dirs that aren't in the tree, the
+ * list or the batch, each made once no matter how many children it has. */
+static void batch_mkpath_locked(GPtrArray *vos, GHashTable *dyn_index) {
+    GHashTable *have = g_hash_table_new(g_str_hash, g_str_equal);
+    GSList *made = NULL;
+    for (guint i = 0; i < vos->len; i++)
+        g_hash_table_add(have, ((sysobj_virt*)g_ptr_array_index(vos, i))->path);
+    for (guint i = 0; i < vos->len; i++) {
+        gchar *pp = g_path_get_dirname(((sysobj_virt*)g_ptr_array_index(vos, i))->path);
+        while (strlen(pp) > 1
+            && !g_hash_table_contains(have, pp)
+            && !seq_find(pp)
+            && !g_hash_table_contains(dyn_index, path_intern_peek(pp)) ) {
+            sysobj_virt *vo = sysobj_virt_new();
+            vo->path = pp;
+            vo->type = VSO_TYPE_DIR;
+            vo->str = g_strdup("*");
+            vo->ipath = path_intern_get(vo->path);
+            g_hash_table_add(have, vo->path);
+            made = g_slist_prepend(made, vo);
+            pp = g_path_get_dirname(pp);
         }
+        g_free(pp);
+    }
+    g_hash_table_destroy(have);
+    for (GSList *l = made; l; l = l->next)
+        g_ptr_array_add(vos, l->data);
+    g_slist_free(made);
+}
 
-        /* search for existing, replace or add */
-        g_mutex_lock(&vo_lock);
+int sysobj_virt_batch_commit(sysobj_virt_batch *b) {
+    int added = 0;
+    gboolean mkpath = b->mkpath, any_dyn = FALSE;
+    GPtrArray *vos = g_ptr_array_sized_new(b->vos->len);
+    for (guint i = 0; i < b->vos->len; i++) {
+        sysobj_virt *vo = g_ptr_array_index(b->vos, i);
+        if (!virt_check(vo))
+            continue;
+        vo->ipath = path_intern_get(vo->path);
+        if (vo->type & VSO_TYPE_DYN)
+            any_dyn = TRUE;
+        g_ptr_array_add(vos, vo);
+    }
+    g_ptr_array_free(b->vos, TRUE);
+    g_free(b);
 
+    g_mutex_lock(&vo_lock);
+    /* vo_list indexed once, instead of walked for each */
+    GHashTable *dyn_index = NULL;
+    GSList *dyn_new = NULL;
+    if (any_dyn || mkpath) {
+        dyn_index = g_hash_table_new(g_direct_hash, g_direct_equal);
+        for (GSList *l = vo_list; l; l = l->next)
+            g_hash_table_insert(dyn_index, (gpointer)((sysobj_virt*)l->data)->ipath, l);
+    }
+    if (mkpath)
+        batch_mkpath_locked(vos, dyn_index);
+    /* stable (glib >= 2.32), so the last of a path added still wins */
+    g_ptr_array_sort(vos, (GCompareFunc)virt_cmp_path);
+
+    for (guint i = 0; i < vos->len; i++) {
+        sysobj_virt *vo = g_ptr_array_index(vos, i);
         if (!(vo->type & VSO_TYPE_DYN)) {
-            /* if not DYN, then put it in the tree */
-            gboolean existed = FALSE;
-            sysobj_virt *tv = g_tree_lookup(vo_tree, vo->path);
-            if (tv) existed = TRUE;
-            g_tree_replace(vo_tree, g_strdup(vo->path), vo);
-            if (existed)
-                sysobj_stats.so_virt_replace++;
-            else
-                sysobj_stats.so_virt_add++;
-            g_mutex_unlock(&vo_lock);
-            return !existed;
+            if (virt_add_locked(vo))
+                added++;
+            continue;
         }
-
-        /* ... else the list */
-        for (GSList *l = vo_list; l; l = l->next) {
-            sysobj_stats.so_virt_iter++;
-            sysobj_virt *lv = l->data;
-            if (g_strcmp0(lv->path, vo->path) == 0) {
-                /* already exists, overwrite */
-                sysobj_virt_free(lv);
-                l->data = (gpointer*)vo;
-                sysobj_stats.so_virt_replace++;
-                g_mutex_unlock(&vo_lock);
-                return FALSE;
-            }
+        g_atomic_int_inc(&vo->ref); /* the store's */
+        g_atomic_int_inc(&vo_link_gen); /* DYN */
+        GSList *l = g_hash_table_lookup(dyn_index, vo->ipath);
+        if (l) {
+            /* already exists, overwrite */
+            sysobj_virt_unref(l->data);
+            l->data = vo;
+            sysobj_stats.so_virt_replace++;
+        } else {
+            dyn_new = g_slist_prepend(dyn_new, vo);
+            g_hash_table_insert(dyn_index, (gpointer)vo->ipath, dyn_new);
+            sysobj_stats.so_virt_add++;
+            added++;
         }
-        //virt_msg("add virtual object to list: %s [%s]", vo->path, vo->str);
-        vo_list = g_slist_append(vo_list, vo);
-        sysobj_stats.so_virt_add++;
-        g_mutex_unlock(&vo_lock);
-        return TRUE;
     }
-    return FALSE;
+    vo_list = g_slist_concat(vo_list, g_slist_reverse(dyn_new));
+    g_atomic_int_inc(&vo_gen);
+    g_mutex_unlock(&vo_lock);
+
+    if (dyn_index)
+        g_hash_table_destroy(dyn_index);
+    g_ptr_array_free(vos, TRUE);
+    return added;
+}
+
+int sysobj_virt_add_list(GSList *vos) {
+    sysobj_virt_batch *b = sysobj_virt_batch_new(FALSE);
+    for (GSList *l = vos; l; l = l->next)
+        sysobj_virt_batch_add(b, l->data);
+    g_slist_free(vos);
+    return sysobj_virt_batch_commit(b);
+}
+
+/* only what is all data, no functions */
+#define VIRT_IS_STATIC(vo) (!(vo)->f_get_data && !(vo)->f_get_type && !(vo)->f_set_data \
+    && !((vo)->type & (VSO_TYPE_CONST | VSO_TYPE_CLEANUP)) )
+
+typedef struct {
+    GPatternSpec *pspec;
+    GSList *found;
+} _dup_static;
+
+static sysobj_virt *virt_dup(const sysobj_virt *vo) {
+    sysobj_virt *ret = sysobj_virt_new();
+    ret->path = g_strdup(vo->path);
+    ret->type = vo->type;
+    ret->str = g_strdup(vo->str);
+    return ret;
+}
+
+static void _dup_static_one(sysobj_virt *vo, _dup_static *ds) {
+    sysobj_stats.so_virt_iter++;
+    if (VIRT_IS_STATIC(vo) && g_pattern_match(ds->pspec, strlen(vo->path), vo->path, NULL) )
+        ds->found = g_slist_prepend(ds->found, virt_dup(vo));
+}
+
+GSList *sysobj_virt_dup_static(const gchar *glob) {
+    _dup_static ds = { g_pattern_spec_new(glob), NULL };
+    gsize lit = glob_literal_len(glob);
+    g_mutex_lock(&vo_lock);
+    gchar *prefix = g_strndup(glob, lit);
+    for (GSequenceIter *it = seq_lower_bound(prefix);
+        !g_sequence_iter_is_end(it); it = g_sequence_iter_next(it) ) {
+        sysobj_virt *vo = g_sequence_get(it);
+        if (strncmp(vo->path, glob, lit) != 0)
+            break;
+        _dup_static_one(vo, &ds);
+    }
+    g_free(prefix);
+    for (GSList *l = vo_list; l; l = l->next)
+        _dup_static_one(l->data, &ds);
+    g_mutex_unlock(&vo_lock);
+    g_pattern_spec_free(ds.pspec);
+    return g_slist_reverse(ds.found);
 }
 
 gboolean sysobj_virt_add_simple_mkpath(const gchar *base, const gchar *name, const gchar *data, int type) {
@@ -163,7 +475,9 @@ gboolean sysobj_virt_add_simple_mkpath(const gchar *base, const gchar *name, con
     tpp = g_path_get_dirname(tp);
     if (strlen(tpp) > 1) {
         sysobj_virt *vo = sysobj_virt_find(tpp);
-        if (!vo || !SEQ(vo->path, tpp) )
+        gboolean have = vo && SEQ(vo->path, tpp);
+        sysobj_virt_unref(vo);
+        if (!have)
             sysobj_virt_add_simple_mkpath(tpp, NULL, "*", VSO_TYPE_DIR);
     }
     g_free(tp);
@@ -180,6 +494,7 @@ gboolean sysobj_virt_add_simple(const gchar *base, const gchar *name, const gcha
 }
 
 void sysobj_virt_from_lines(const gchar *base, const gchar *data_in, gboolean safe_names) {
+    sysobj_virt_batch *b = sysobj_virt_batch_new(FALSE);
     gchar **lines = g_strsplit(data_in, "\n", -1);
     for (int i = 0; lines[i]; i++) {
         gchar *c = g_utf8_strchr(lines[i], strlen(lines[i]), ':');
@@ -192,11 +507,12 @@ void sysobj_virt_from_lines(const gchar *base, const gchar *data_in, gboolean sa
             vo->path = util_build_fn(base, key);
             vo->str = value;
             vo->type = VSO_TYPE_STRING;
-            sysobj_virt_add(vo);
+            sysobj_virt_batch_add(b, vo);
             g_free(key);
         }
     }
     g_strfreev(lines);
+    sysobj_virt_batch_commit(b);
 }
 
 void sysobj_virt_from_kv(const gchar *base, const gchar *kv_data_in) {
@@ -206,6 +522,7 @@ void sysobj_virt_from_kv(const gchar *base, const gchar *kv_data_in) {
     int i = 0, j = 0;
 
     gchar *kv_data = g_strdup_printf("[%s]\n%s", before_first_group, kv_data_in);
+    sysobj_virt_batch *b = sysobj_virt_batch_new(FALSE);
 
     key_file = g_key_file_new();
     g_key_file_load_from_data(key_file, kv_data, strlen(kv_data), 0, NULL);
@@ -220,7 +537,7 @@ void sysobj_virt_from_kv(const gchar *base, const gchar *kv_data_in) {
             vo->type = VSO_TYPE_DIR;
             vo->path = g_strdup_printf("%s/%s", base, groups[i]);
             vo->str = g_strdup("*");
-            sysobj_virt_add(vo);
+            sysobj_virt_batch_add(b, vo);
         }
 
         for (j = 0; keys[j]; j++) {
@@ -231,12 +548,13 @@ void sysobj_virt_from_kv(const gchar *base, const gchar *kv_data_in) {
             else
                 vo->path = g_strdup_printf("%s/%s/%s", base, groups[i], keys[j]);
             vo->str = g_key_file_get_value(key_file, groups[i], keys[j], NULL);
-            sysobj_virt_add(vo);
+            sysobj_virt_batch_add(b, vo);
         }
         g_strfreev(keys);
     }
     g_strfreev(groups);
     g_free(kv_data);
+    sysobj_virt_batch_commit(b);
 }
 
 sysobj_virt *sysobj_virt_find(const gchar *path) {
@@ -244,29 +562,41 @@ sysobj_virt *sysobj_virt_find(const gchar *path) {
     sysobj_virt *ret = NULL;
     gchar *spath = g_strdup(path);
     util_null_trailing_slash(spath);
-    int best_len = 0;
+    lazy_trigger(spath, FALSE);
+    gsize best_len = 0, plen = strlen(path);
+    /* generators may be adding from other threads */
+    g_mutex_lock(&vo_lock);
     /* exact static match wins over longest dynamic match */
-    ret = g_tree_lookup(vo_tree, spath);
+    ret = seq_lookup(spath);
     if (ret)
         goto sysobj_virt_find_done;
 
+    /* every vo path is interned, so if spath isn't
+     * there can't be an exact match */
+    const path_intern *ip = path_intern_peek(spath);
     for (GSList *l = vo_list; l; l = l->next) {
         sysobj_stats.so_virt_iter++;
         sysobj_virt *vo = l->data;
-        if (vo->type & VSO_TYPE_DYN && g_str_has_prefix(path, vo->path) ) {
-            int len = strlen(vo->path);
-            if (len > best_len) {
+        if (ip && vo->ipath == ip) {
+            ret = vo;
+            break;
+        }
+        if (vo->type & VSO_TYPE_DYN) {
+            gsize len = vo->ipath->len;
+            if (len > best_len && len <= plen
+                && !memcmp(path, vo->path, len) ) {
                 ret = vo;
                 best_len = len;
             }
         }
-        if (SEQ(vo->path, spath)) {
-            ret = vo;
-            break;
-        }
     }
 
 sysobj_virt_find_done:
+    /* removal or replacement by another thread can't free it
+     * until the caller is done */
+    if (ret)
+        g_atomic_int_inc(&ret->ref);
+    g_mutex_unlock(&vo_lock);
     g_free(spath);
     //virt_msg("... %s", (ret) ? ret->path : "(NOT FOUND)");
     return ret;
@@ -274,13 +604,15 @@ sysobj_virt_find_done:
 
 /* returns the link or null if not a link */
 gchar *sysobj_virt_is_symlink(gchar *req) {
-    const sysobj_virt *vo = sysobj_virt_find(req);
+    gchar *ret = NULL;
+    sysobj_virt *vo = sysobj_virt_find(req);
     if (vo) {
         long long unsigned int t = sysobj_virt_get_type(vo, req);
         if (t & VSO_TYPE_SYMLINK)
-            return sysobj_virt_get_data(vo, req);
+            ret = sysobj_virt_get_data(vo, req);
+        sysobj_virt_unref(vo);
     }
-    return NULL;
+    return ret;
 }
 
 gchar *sysobj_virt_symlink_entry(const sysobj_virt *vo, const gchar *target, const gchar *req) {
@@ -315,14 +647,23 @@ gboolean sysobj_virt_set_data(sysobj_virt *vo, const gchar *req, const gpointer
             else if (g_utf8_validate(data, length, NULL) ) {
                 if (length <= 0)
                     length = strlen((char*)data);
-                g_free(vo->str);
-                vo->str = g_memdup(data, length);
+                /* readers copy str under vo_lock */
+                gchar *str = g_memdup(data, length);
+                g_mutex_lock(&vo_lock);
+                gchar *old = vo->str;
+                vo->str = str;
+                g_mutex_unlock(&vo_lock);
+                g_free(old);
                 ret = TRUE;
             }
         }
     }
-    if (ret)
+    if (ret) {
+        g_atomic_int_inc(&vo_gen);
+        if (vo->type & VSO_TYPE_SYMLINK)
+            g_atomic_int_inc(&vo_link_gen);
         sysobj_stats.so_virt_setf_bytes += length;
+    }
     return ret;
 }
 
@@ -332,8 +673,11 @@ gchar *sysobj_virt_get_data(const sysobj_virt *vo, const gchar *req) {
         if (vo->f_get_data) {
             sysobj_stats.so_virt_getf++;
             ret = vo->f_get_data(req ? req : vo->path);
-        } else
+        } else {
+            g_mutex_lock(&vo_lock);
             ret = g_strdup(vo->str);
+            g_mutex_unlock(&vo_lock);
+        }
 
         if (ret && req &&
             vo->type & VSO_TYPE_AUTOLINK ) {
@@ -360,80 +704,73 @@ int sysobj_virt_get_type(const sysobj_virt *vo, const gchar *req) {
     return ret;
 }
 
-typedef struct {
-    gchar *spath;
-    gsize spl;
-    GSList *found;
-    gboolean immediate_only;
-    gboolean found_name_only; /* list contains: true: name only; false: full path */
-} _childs;
-
-/* (GTraverseFunc) */
-static gboolean _find_children(const gchar *key, const sysobj_virt *tvo, _childs *ret) {
-    sysobj_stats.so_virt_iter++;
-    if ( g_str_has_prefix(tvo->path, ret->spath) ) {
-        if (ret->immediate_only && strchr(tvo->path + ret->spl, '/'))
-            return FALSE;
-        if (ret->found_name_only) {
-            gchar *fn = g_path_get_basename(tvo->path);
-            ret->found = g_slist_append(ret->found, fn);
-        } else
-            ret->found = g_slist_append(ret->found, g_strdup(tvo->path));
-    } else {
-        /* tree is traversed in sorted order, so if
-         * tvo->path > spath, nothing more could be found */
-        if (g_strcmp0(tvo->path, ret->spath) == 1)
-            return TRUE; /* stop the foreach */
-    }
-    return FALSE; /* continue the foreach */
-}
-
 GSList *sysobj_virt_all_paths() {
-    _childs ret = {};
-    ret.spath = "";
-    ret.spl = strlen(ret.spath);
-    ret.immediate_only = FALSE;
-    ret.found_name_only = FALSE;
+    GSList *ret = NULL;
+    g_mutex_lock(&vo_lock);
 
-    /* tree */
-    g_tree_foreach(vo_tree, (GTraverseFunc)_find_children, &ret);
+    /* ordered */
+    for (GSequenceIter *it = g_sequence_get_begin_iter(vo_seq);
+        !g_sequence_iter_is_end(it); it = g_sequence_iter_next(it) ) {
+        sysobj_stats.so_virt_iter++;
+        ret = g_slist_prepend(ret, g_strdup(((sysobj_virt*)g_sequence_get(it))->path));
+    }
+    ret = g_slist_reverse(ret);
 
     /* list */
     for (GSList *l = vo_list; l; l = l->next) {
         sysobj_stats.so_virt_iter++;
         sysobj_virt *vo = l->data;
-        ret.found = g_slist_append(ret.found, g_strdup(vo->path));
+        ret = g_slist_append(ret, g_strdup(vo->path));
     }
-    return ret.found;
+    g_mutex_unlock(&vo_lock);
+    return ret;
 }
 
 static GSList *sysobj_virt_children_auto(const sysobj_virt *vo, const gchar *req) {
-    _childs ret = {};
+    GSList *found = NULL;
     if (vo && req) {
-        ret.spath = g_strdup_printf("%s/", req);
-        ret.spl = strlen(ret.spath);
-        ret.immediate_only = TRUE;
-        ret.found_name_only = TRUE;
+        gchar *spath = g_strdup_printf("%s/", req);
+        gsize spl = strlen(spath);
 
-        /* tree */
-        g_tree_foreach(vo_tree, (GTraverseFunc)_find_children, &ret);
+        lazy_trigger(req, TRUE);
+        g_mutex_lock(&vo_lock);
+        /* ordered: seek to the first under spath, stop at the first
+         * that isn't, and skip over each child's own subtree */
+        GSequenceIter *it = seq_lower_bound(spath);
+        while (!g_sequence_iter_is_end(it)) {
+            sysobj_stats.so_virt_iter++;
+            sysobj_virt *tvo = g_sequence_get(it);
+            if (strncmp(tvo->path, spath, spl) != 0)
+                break;
+            const gchar *name = tvo->path + spl;
+            const gchar *slash = strchr(name, '/');
+            if (!slash) {
+                found = g_slist_prepend(found, g_strdup(name));
+                it = g_sequence_iter_next(it);
+            } else {
+                /* ...<name>0 is just past everything in <name>/ */
+                gchar *past = g_strndup(tvo->path, slash - tvo->path + 1);
+                past[slash - tvo->path] = '/' + 1;
+                it = seq_lower_bound(past);
+                g_free(past);
+            }
+        }
+        found = g_slist_reverse(found);
 
         /* list */
-        gchar *fn = NULL;
         for (GSList *l = vo_list; l; l = l->next) {
             sysobj_stats.so_virt_iter++;
             sysobj_virt *tvo = l->data;
             /* find all vo paths that are immediate children */
-            if ( g_str_has_prefix(tvo->path, ret.spath) ) {
-                if (!strchr(tvo->path + ret.spl, '/')) {
-                    fn = g_path_get_basename(tvo->path);
-                    ret.found = g_slist_append(ret.found, fn);
-                }
+            if ( g_str_has_prefix(tvo->path, spath) ) {
+                if (!strchr(tvo->path + spl, '/'))
+                    found = g_slist_append(found, g_path_get_basename(tvo->path));
             }
         }
-        g_free(ret.spath);
+        g_mutex_unlock(&vo_lock);
+        g_free(spath);
     }
-    return ret.found;
+    return found;
 }
 
 GSList *sysobj_virt_children(const sysobj_virt *vo, const gchar *req) {
@@ -459,6 +796,11 @@ GSList *sysobj_virt_children(const sysobj_virt *vo, const gchar *req) {
     return ret;
 }
 
+void sysobj_virt_unref(sysobj_virt *vo) {
+    if (vo && g_atomic_int_dec_and_test(&vo->ref))
+        sysobj_virt_free(vo);
+}
+
 void sysobj_virt_free(sysobj_virt *s) {
     if (!s) return;
     /* allow objects to cleanup */
@@ -466,6 +808,8 @@ void sysobj_virt_free(sysobj_virt *s) {
         gchar *trash = s->f_get_data(NULL);
         g_free(trash);
     }
+    path_intern_unref(s->ipath);
+    s->ipath = NULL;
     if (!(s->type & VSO_TYPE_CONST)) {
         g_free(s->path);
         g_free(s->str);
@@ -474,8 +818,21 @@ void sysobj_virt_free(sysobj_virt *s) {
 }
 
 void sysobj_virt_cleanup() {
-    g_tree_destroy(vo_tree);
-    g_slist_free_full(vo_list, (GDestroyNotify)sysobj_virt_free);
-    vo_tree = NULL;
+    g_hash_table_destroy(vo_index);
+    for (GSequenceIter *it = g_sequence_get_begin_iter(vo_seq);
+        !g_sequence_iter_is_end(it); it = g_sequence_iter_next(it) )
+        sysobj_virt_unref(g_sequence_get(it));
+    g_sequence_free(vo_seq);
+    g_slist_free_full(vo_list, (GDestroyNotify)sysobj_virt_unref);
+    vo_index = NULL;
+    vo_seq = NULL;
     vo_list = NULL;
+    for (GSList *l = lazy_list; l; l = l->next) {
+        virt_lazy *lz = l->data;
+        g_free(lz->root);
+        g_free(lz);
+    }
+    g_slist_free(lazy_list);
+    lazy_list = NULL;
+    lazy_pending = 0;
 }
@@ -0,0 +1,311 @@
+/*
+ * sysobj - https://github.com/bp0/verbose-spork
+ * Copyright (C) 2018  Burt P. <pburt0@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#include <stdarg.h>
+#include <errno.h>
+#include <unistd.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <linux/netlink.h>
+#include "uevent.h"
+
+#define uevent_msg(fmt, ...) fprintf (stderr, "[%s] " fmt "\n", __FUNCTION__, ##__VA_ARGS__)
+
+#define UEVENT_BUFF_SIZE 8192
+/* room for a hotplug burst, like a dock or a disk shelf */
+#define UEVENT_RCVBUF (4 * 1024 * 1024)
+
+typedef struct {
+    gchar *subsystem;
+    uevent_handler f;
+    gpointer user_data;
+} uevent_hnd;
+
+static GSList *handlers = NULL;
+static GMutex handlers_lock;
+
+static struct {
+    GThread *thread;
+    int fd;
+    gboolean netlink;
+    int stop[2]; /* pipe */
+} listener = { NULL, -1, FALSE, { -1, -1 } };
+
+void uevent_handler_add(const gchar *subsystem, uevent_handler f, gpointer user_data) {
+    uevent_hnd *h = g_new0(uevent_hnd, 1);
+    h->subsystem = g_strdup(subsystem);
+    h->f = f;
+    h->user_data = user_data;
+    g_mutex_lock(&handlers_lock);
+    handlers = g_slist_append(handlers, h);
+    g_mutex_unlock(&handlers_lock);
+}
+
+static void uevent_hnd_free(uevent_hnd *h) {
+    g_free(h->subsystem);
+    g_free(h);
+}
+
+void uevent_clear(uevent *ev) {
+    if (!ev) return;
+    g_free(ev->action);
+    g_free(ev->devpath);
+    g_free(ev->name);
+    g_free(ev->subsystem);
+    g_free(ev->devtype);
+    g_free(ev->devname);
+    memset(ev, 0, sizeof(uevent));
+}
+
+gboolean uevent_parse(const gchar *buff, gsize len, uevent *ev) {
+    const gchar *p = buff, *end = buff + len, *at;
+    if (!buff || !len || !ev) return FALSE;
+    memset(ev, 0, sizeof(uevent));
+
+    /* header, "action@devpath" */
+    at = memchr(p, '@', strnlen(p, len));
+    if (!at) return FALSE;
+    p += strnlen(p, len) + 1;
+
+    while (p < end) {
+        gsize l = strnlen(p, end - p);
+        if (g_str_has_prefix(p, "ACTION="))
+            ev->action = g_strndup(p + 7, l - 7);
+        else if (g_str_has_prefix(p, "DEVPATH="))
+            ev->devpath = g_strndup(p + 8, l - 8);
+        else if (g_str_has_prefix(p, "SUBSYSTEM="))
+            ev->subsystem = g_strndup(p + 10, l - 10);
+        else if (g_str_has_prefix(p, "DEVTYPE="))
+            ev->devtype = g_strndup(p + 8, l - 8);
+        else if (g_str_has_prefix(p, "DEVNAME="))
+            ev->devname = g_strndup(p + 8, l - 8);
+        else if (g_str_has_prefix(p, "SEQNUM="))
+            ev->seqnum = g_ascii_strtoull(p + 7, NULL, 10);
+        p += l + 1;
+    }
+
+    /* the header has them too, if the keys were missing */
+    if (!ev->action)
+        ev->action = g_strndup(buff, at - buff);
+    if (!ev->devpath)
+        ev->devpath = g_strdup(at + 1);
+    if (!ev->subsystem || !*ev->devpath) {
+        uevent_clear(ev);
+        return FALSE;
+    }
+    ev->name = g_path_get_basename(ev->devpath);
+    return TRUE;
+}
+
+void uevent_dispatch(const uevent *ev) {
+    if (!ev) return;
+
+    /* sysfs symlinks may point somewhere else now */
+    if (!uevent_is(ev, "change"))
+        sysobj_path_cache_invalidate();
+
+    /* handlers aren't removed until uevent_cleanup(), but one may
+     * start a lazy generator that adds another, so not under the lock */
+    GSList *match = NULL;
+    g_mutex_lock(&handlers_lock);
+    for (GSList *l = handlers; l; l = l->next) {
+        uevent_hnd *h = l->data;
+        if (!h->subsystem || SEQ(h->subsystem, ev->subsystem))
+            match = g_slist_prepend(match, h);
+    }
+    g_mutex_unlock(&handlers_lock);
+    match = g_slist_reverse(match);
+    for (GSList *l = match; l; l = l->next) {
+        uevent_hnd *h = l->data;
+        h->f(ev, h->user_data);
+    }
+    g_slist_free(match);
+    /* after the handlers, so a waiter sees what they did */
+    sysobj_stats.uevent_count++;
+}
+
+/* events were lost, each handler gets a "rescan" for its subsystem */
+static void uevent_rescan() {
+    sysobj_path_cache_invalidate();
+
+    GSList *all = NULL;
+    g_mutex_lock(&handlers_lock);
+    for (GSList *l = handlers; l; l = l->next)
+        all = g_slist_prepend(all, l->data);
+    g_mutex_unlock(&handlers_lock);
+    all = g_slist_reverse(all);
+    for (GSList *l = all; l; l = l->next) {
+        uevent_hnd *h = l->data;
+        uevent ev = {
+            .action = "rescan", .devpath = "", .name = "",
+            .subsystem = h->subsystem,
+        };
+        h->f(&ev, h->user_data);
+    }
+    g_slist_free(all);
+}
+
+static gpointer uevent_listen_main(gpointer unused) {
+    gchar buff[UEVENT_BUFF_SIZE + 1];
+    struct pollfd pfd[2] = {
+        { .fd = listener.fd, .events = POLLIN },
+        { .fd = listener.stop[0], .events = POLLIN },
+    };
+
+    while (1) {
+        if (poll(pfd, 2, -1) < 0) {
+            if (errno == EINTR) continue;
+            uevent_msg("poll: %s", strerror(errno));
+            break;
+        }
+        if (pfd[1].revents)
+            break; /* uevent_listen_stop() */
+        if (!(pfd[0].revents & POLLIN))
+            break;
+
+        struct sockaddr_nl sa = {};
+        struct iovec iov = { buff, UEVENT_BUFF_SIZE };
+        struct msghdr msg = { .msg_iov = &iov, .msg_iovlen = 1 };
+        if (listener.netlink) {
+            msg.msg_name = &sa;
+            msg.msg_namelen = sizeof(sa);
+        }
+        ssize_t len = recvmsg(listener.fd, &msg, 0);
+        if (len < 0 && errno == EINTR)
+            continue;
+        if (len < 0 && errno == ENOBUFS) {
+            /* the kernel dropped some, the socket is still good */
+            uevent_msg("overrun, rescanning");
+            uevent_rescan();
+            continue;
+        }
+        if (len <= 0) {
+            if (len < 0)
+                uevent_msg("recvmsg: %s", strerror(errno));
+            break;
+        }
+        buff[len] = 0;
+
+        /* only from the kernel, not udevd's re-broadcast or another process */
+        if (listener.netlink && sa.nl_pid != 0)
+            continue;
+        if (g_str_has_prefix(buff, "libudev"))
+            continue;
+
+        uevent ev;
+        if (uevent_parse(buff, len, &ev)) {
+            uevent_dispatch(&ev);
+            uevent_clear(&ev);
+        }
+    }
+    return NULL;
+}
+
+static gboolean uevent_listen_fd(int fd, gboolean netlink) {
+    if (listener.thread) {
+        uevent_msg("already listening");
+        close(fd);
+        return FALSE;
+    }
+    if (pipe(listener.stop) != 0) {
+        close(fd);
+        return FALSE;
+    }
+    listener.fd = fd;
+    listener.netlink = netlink;
+    listener.thread = g_thread_new("uevent", uevent_listen_main, NULL);
+    return TRUE;
+}
+
+gboolean uevent_listen_start() {
+    struct sockaddr_nl sa = {
+        .nl_family = AF_NETLINK,
+        .nl_groups = 1, /* kernel events */
+    };
+    int fd = socket(AF_NETLINK, SOCK_DGRAM | SOCK_CLOEXEC, NETLINK_KOBJECT_UEVENT);
+    if (fd < 0) {
+        uevent_msg("netlink socket: %s", strerror(errno));
+        return FALSE;
+    }
+    /* FORCE can go past rmem_max, but needs CAP_NET_ADMIN */
+    int rcvbuf = UEVENT_RCVBUF;
+    if (setsockopt(fd, SOL_SOCKET, SO_RCVBUFFORCE, &rcvbuf, sizeof(rcvbuf)) != 0)
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &rcvbuf, sizeof(rcvbuf));
+    if (bind(fd, (struct sockaddr *)&sa, sizeof(sa)) != 0) {
+        uevent_msg("netlink bind: %s", strerror(errno));
+        close(fd);
+        return FALSE;
+    }
+    return uevent_listen_fd(fd, TRUE);
+}
+
+int uevent_listen_fake() {
+    int sv[2];
+    if (socketpair(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0, sv) != 0)
+        return -1;
+    if (!uevent_listen_fd(sv[0], FALSE)) {
+        close(sv[1]);
+        return -1;
+    }
+    return sv[1];
+}
+
+gboolean uevent_inject(int fd, const gchar *action, const gchar *devpath, ...) {
+    GString *msg = g_string_new(NULL);
+    const gchar *kv;
+    va_list args;
+
+    g_string_append_printf(msg, "%s@%s", action, devpath);
+    g_string_append_c(msg, 0);
+    g_string_append_printf(msg, "ACTION=%s", action);
+    g_string_append_c(msg, 0);
+    g_string_append_printf(msg, "DEVPATH=%s", devpath);
+    g_string_append_c(msg, 0);
+    va_start(args, devpath);
+    while ( (kv = va_arg(args, const gchar *)) ) {
+        g_string_append(msg, kv);
+        g_string_append_c(msg, 0);
+    }
+    va_end(args);
+
+    gboolean ret = (send(fd, msg->str, msg->len, 0) == (ssize_t)msg->len);
+    g_string_free(msg, TRUE);
+    return ret;
+}
+
+void uevent_listen_stop() {
+    if (!listener.thread) return;
+    if (write(listener.stop[1], "x", 1) != 1)
+        uevent_msg("couldn't signal the listener");
+    g_thread_join(listener.thread);
+    listener.thread = NULL;
+    close(listener.fd);
+    close(listener.stop[0]);
+    close(listener.stop[1]);
+    listener.fd = listener.stop[0] = listener.stop[1] = -1;
+}
+
+void uevent_cleanup() {
+    uevent_listen_stop();
+    g_mutex_lock(&handlers_lock);
+    g_slist_free_full(handlers, (GDestroyNotify)uevent_hnd_free);
+    handlers = NULL;
+    g_mutex_unlock(&handlers_lock);
+}
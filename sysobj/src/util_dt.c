@@ -19,6 +19,7 @@
  */
 
 #include "util_dt.h"
+#include "util_fdt.h"
 #include "format_funcs.h"
 
 void dtr_msg(char *fmt, ...);
@@ -49,9 +50,53 @@ enum {
 };
 
 gchar* dtr_log = NULL;
-static GSList *phandles = NULL;
-static GSList *aliases = NULL;
-static GSList *symbols = NULL;
+/* built once by dtr_init(), the first of a key wins */
+static GHashTable *phandles = NULL;  /* phandle -> dtr_map_item, owns */
+static GHashTable *aliases = NULL;   /* label -> dtr_map_item, owns */
+static GHashTable *alias_paths = NULL;  /* path -> dtr_map_item */
+static GHashTable *symbols = NULL;   /* label -> dtr_map_item, owns */
+static GHashTable *symbol_paths = NULL; /* path -> dtr_map_item */
+
+/* the whole tree in one read, when it can be (root only),
+ * instead of a file per property under DTROOT */
+#define FDT_FILE "/sys/firmware/fdt"
+static fdt_tree *fdt = NULL;
+static gboolean phandle_files_scanned = FALSE; /* as well as the blob */
+
+/* the blob is from boot, it doesn't have anything added
+ * through configfs since */
+#define OVERLAYS_DIR "/sys/kernel/config/device-tree/overlays"
+static gboolean dtr_have_overlays() {
+    sysobj *obj = sysobj_new_from_fn(OVERLAYS_DIR, NULL);
+    GSList *childs = obj->exists ? sysobj_children(obj, NULL, NULL, FALSE) : NULL;
+    gboolean ret = (childs != NULL);
+    g_slist_free_full(childs, g_free);
+    sysobj_free(obj);
+    return ret;
+}
+
+/* the in-memory node for a DTROOT path */
+static const fdt_node *dtr_fdt_node(const gchar *path) {
+    if (!fdt || !path || !g_str_has_prefix(path, DTROOT))
+        return NULL;
+    const gchar *rel = path + strlen(DTROOT);
+    if (*rel && *rel != '/')
+        return NULL;
+    return fdt_node_find(fdt, rel);
+}
+
+/* a property of a DTROOT path from the blob, NULL if it isn't there,
+ * then the caller reads the file instead */
+static const fdt_prop *dtr_fdt_prop(const gchar *path, const gchar *name) {
+    return fdt_prop_find(dtr_fdt_node(path), name);
+}
+
+static guint32 fdt_prop_u32(const fdt_prop *p) {
+    uint32_t v = 0;
+    if (p && p->len >= 4)
+        memcpy(&v, p->data, 4);
+    return be32toh(v);
+}
 
 void dtr_msg(char *fmt, ...) {
     gchar *buf, *tmp;
@@ -132,6 +177,22 @@ int dtr_inh_find(sysobj *obj, char *qprop, int limit) {
 
     if (!limit) limit = 100;
 
+    gchar *npath = g_path_get_dirname(obj->path);
+    const fdt_node *fn = dtr_fdt_node(npath);
+    g_free(npath);
+    if (fn) {
+        int fl = limit;
+        for (const fdt_node *an = fn->parent; an && fl; an = an->parent, fl--) {
+            const fdt_prop *fp = fdt_prop_find(an, qprop);
+            if (fp && fp->len >= 4) {
+                ret = fdt_prop_u32(fp);
+                found = 1;
+                goto dtr_inh_find_default;
+            }
+        }
+        /* not in the blob, but maybe from an overlay */
+    }
+
     tobj = obj;
     while (tobj != NULL) {
         pobj = sysobj_parent(tobj, FALSE);
@@ -152,6 +213,7 @@ int dtr_inh_find(sysobj *obj, char *qprop, int limit) {
     }
     sysobj_free(pobj);
 
+dtr_inh_find_default:
     if (!found) {
         i = 0;
         while(default_values[i].name != NULL) {
@@ -276,6 +338,9 @@ char *dtr_list_reg(sysobj *obj) {
 
 uint32_t dtr_get_phref_prop(uint32_t phandle, gchar *prop) {
     uint32_t ret = 0;
+    const fdt_prop *fp = dtr_fdt_prop(dtr_phandle_lookup(phandle), prop);
+    if (fp)
+        return fdt_prop_u32(fp);
     sysobj *obj = sysobj_new_from_fn(dtr_phandle_lookup(phandle), prop);
     if (obj && obj->exists) {
         sysobj_read(obj, FALSE);
@@ -394,6 +459,9 @@ char *dtr_list_override(sysobj *obj) {
 
 uint32_t dtr_get_prop_u32(sysobj *node, const char *name) {
     uint32_t ret = 0;
+    const fdt_prop *fp = dtr_fdt_prop(node->path, name);
+    if (fp)
+        return fdt_prop_u32(fp);
     sysobj *obj = sysobj_new_from_fn(node->path, name);
     if (obj && obj->exists) {
         sysobj_read(obj, FALSE);
@@ -406,6 +474,14 @@ uint32_t dtr_get_prop_u32(sysobj *node, const char *name) {
 
 uint64_t dtr_get_prop_u64(sysobj *node, const char *name) {
     uint64_t ret = 0;
+    const fdt_prop *fp = dtr_fdt_prop(node->path, name);
+    if (fp) {
+        if (fp->len >= 8) {
+            memcpy(&ret, fp->data, 8);
+            ret = be64toh(ret);
+        }
+        return ret;
+    }
     sysobj *obj = sysobj_new_from_fn(node->path, name);
     if (obj && obj->exists) {
         sysobj_read(obj, FALSE);
@@ -418,6 +494,9 @@ uint64_t dtr_get_prop_u64(sysobj *node, const char *name) {
 
 char *dtr_get_prop_str(sysobj *node, const char *name) {
     char *ret = NULL;
+    const fdt_prop *fp = dtr_fdt_prop(node->path, name);
+    if (fp)
+        return g_strndup((const gchar*)fp->data, fp->len);
     sysobj *obj = sysobj_new_from_fn(node->path, name);
     if (obj && obj->exists) {
         sysobj_read(obj, FALSE);
@@ -653,7 +732,7 @@ int dtr_guess_type(sysobj *obj) {
     if (nt != DTP_UNK) return nt;
 
     /* maybe a string? */
-    if (obj->data.is_utf8)
+    if (sysobj_data_is_utf8(&obj->data))
         return DTP_STR;
     for (i = 0; i < obj->data.len; i++) {
         tmp = obj->data.str + i;
@@ -819,116 +898,136 @@ gchar *dtr_format(sysobj *obj, int fmt_opts) {
     return simple_format(obj, fmt_opts);
 }
 
+static void dtr_phandle_scan(sysobj_virt_batch *b, gchar *nb, gchar *nn);
+
 const char *dtr_phandle_lookup(uint32_t v) {
     /* 0 and 0xffffffff are invalid phandle values */
     /* TODO: perhaps "INVALID" or something */
     if (v == 0 || v == 0xffffffff)
         return NULL;
-    GSList *l = phandles;
-    while(l) {
-        dtr_map_item *mi = l->data;
-        if (mi->v == v)
-            return mi->path;
-        l = l->next;
+    sysobj_virt_lazy_trigger(":/devicetree"); /* the maps are built by gen_dt */
+    dtr_map_item *mi = phandles ? g_hash_table_lookup(phandles, GUINT_TO_POINTER(v)) : NULL;
+    if (!mi && fdt && !phandle_files_scanned) {
+        /* not in the blob, the files might have it */
+        phandle_files_scanned = TRUE;
+        sysobj_virt_batch *b = sysobj_virt_batch_new(FALSE);
+        dtr_phandle_scan(b, DTROOT, NULL);
+        sysobj_virt_batch_commit(b);
+        mi = g_hash_table_lookup(phandles, GUINT_TO_POINTER(v));
     }
-    return NULL;
+    return mi ? mi->path : NULL;
 }
 
 const char *dtr_alias_lookup(const gchar* label) {
-    GSList *l = aliases;
-    while(l) {
-        dtr_map_item *ali = (dtr_map_item *)l->data;
-        if (SEQ(ali->label, label))
-            return ali->path;
-        l = l->next;
-    }
-    return NULL;
+    sysobj_virt_lazy_trigger(":/devicetree");
+    dtr_map_item *mi = (aliases && label) ? g_hash_table_lookup(aliases, label) : NULL;
+    return mi ? mi->path : NULL;
 }
 
 const char *dtr_alias_lookup_by_path(const gchar* path) {
-    GSList *l = aliases;
-    while(l) {
-        dtr_map_item *ali = (dtr_map_item *)l->data;
-        if (SEQ(ali->path, path))
-            return ali->label;
-        l = l->next;
+    sysobj_virt_lazy_trigger(":/devicetree");
+    dtr_map_item *mi = (alias_paths && path) ? g_hash_table_lookup(alias_paths, path) : NULL;
+    return mi ? mi->label : NULL;
+}
+
+/* takes label */
+static void dtr_label_add(sysobj_virt_batch *b, GHashTable *by_label, GHashTable *by_path, const gchar *virt_base,
+    gchar *label, const gchar *target_path) {
+    if (g_hash_table_contains(by_label, label) ) {
+        g_free(label);
+        return;
     }
-    return NULL;
+    dtr_map_item *nmi = g_new0(dtr_map_item, 1);
+    nmi->label = label;
+    nmi->path = g_strdup(target_path);
+    g_hash_table_insert(by_label, nmi->label, nmi);
+    if (!g_hash_table_contains(by_path, nmi->path) )
+        g_hash_table_insert(by_path, nmi->path, nmi);
+    sysobj_virt_batch_add_simple(b, virt_base, label, nmi->path, VSO_TYPE_SYMLINK | VSO_TYPE_AUTOLINK | VSO_TYPE_DYN );
 }
 
-static void dtr_alias_scan() {
-    sysobj *alo = sysobj_new_from_fn(DTROOT, "aliases");
+/* for /aliases and /__symbols__, label -> path */
+static void dtr_label_scan(const gchar *node, GHashTable *by_label, GHashTable *by_path, const gchar *virt_base) {
+    sysobj_virt_batch *b = sysobj_virt_batch_new(FALSE);
+    gchar *np = g_strdup_printf("/%s", node);
+    const fdt_node *fn = fdt_node_find(fdt, np);
+    g_free(np);
+    if (fn) {
+        for (guint i = 0; i < fn->props->len; i++) {
+            const fdt_prop *fp = &g_array_index(fn->props, fdt_prop, i);
+            if (SEQ(fp->name, "name") || !fp->len)
+                continue;
+            gchar *apath = g_strndup((const gchar*)fp->data, fp->len);
+            const fdt_node *tn = fdt_node_find(fdt, apath);
+            gchar *tpath = g_strdup_printf("%s%s", DTROOT, tn ? tn->path : apath);
+            dtr_label_add(b, by_label, by_path, virt_base, g_strdup(fp->name), tpath);
+            g_free(tpath);
+            g_free(apath);
+        }
+        sysobj_virt_batch_commit(b);
+        return;
+    }
+
+    sysobj *alo = sysobj_new_from_fn(DTROOT, node);
     GSList *childs = sysobj_children(alo, NULL, "name", FALSE);
     GSList *l = childs;
     while(l) {
         gchar *fn = (gchar *)l->data;
         gchar *apath = dtr_get_prop_str(alo, fn);
         sysobj *target = sysobj_new_from_fn(DTROOT, apath);
-        if (apath) {
-            dtr_map_item *nmi = g_new0(dtr_map_item, 1);
-            nmi->label = fn;
-            nmi->path = g_strdup(target->path);
-            aliases = g_slist_append(aliases, nmi);
-            sysobj_virt_add_simple(":/devicetree/_alias_map", fn, nmi->path, VSO_TYPE_SYMLINK | VSO_TYPE_AUTOLINK | VSO_TYPE_DYN );
-        }
+        if (apath)
+            dtr_label_add(b, by_label, by_path, virt_base, fn, target->path);
+        else
+            g_free(fn);
         sysobj_free(target);
         g_free(apath);
         l = l->next;
     }
-    /* the aliases list owns each fn (->data) via nmi */
+    /* the map owns each fn (->data) via nmi */
     g_slist_free(childs);
     sysobj_free(alo);
+    sysobj_virt_batch_commit(b);
 }
 
 const char *dtr_symbol_lookup_by_path(const gchar* path) {
-    GSList *l = symbols;
-    while(l) {
-        dtr_map_item *ali = (dtr_map_item *)l->data;
-        if (SEQ(ali->path, path))
-            return ali->label;
-        l = l->next;
-    }
-    return NULL;
+    sysobj_virt_lazy_trigger(":/devicetree");
+    dtr_map_item *mi = (symbol_paths && path) ? g_hash_table_lookup(symbol_paths, path) : NULL;
+    return mi ? mi->label : NULL;
 }
 
-static void dtr_symbol_scan() {
-    sysobj *alo = sysobj_new_from_fn(DTROOT, "__symbols__");
-    GSList *childs = sysobj_children(alo, NULL, "name", FALSE);
-    GSList *l = childs;
-    while(l) {
-        gchar *fn = (gchar *)l->data;
-        gchar *apath = dtr_get_prop_str(alo, fn);
-        sysobj *target = sysobj_new_from_fn(DTROOT, apath);
-        if (apath) {
-            dtr_map_item *nmi = g_new0(dtr_map_item, 1);
-            nmi->label = fn;
-            nmi->path = g_strdup(target->path);
-            symbols = g_slist_append(symbols, nmi);
-            sysobj_virt_add_simple(":/devicetree/_symbol_map", fn, nmi->path, VSO_TYPE_SYMLINK | VSO_TYPE_AUTOLINK | VSO_TYPE_DYN );
-        }
-        sysobj_free(target);
-        g_free(apath);
-        l = l->next;
+static void dtr_phandle_add(sysobj_virt_batch *b, uint32_t v, const gchar *path) {
+    gchar phstr[20] = "";
+    if (g_hash_table_contains(phandles, GUINT_TO_POINTER(v)) )
+        return;
+    dtr_map_item *nmi = g_new0(dtr_map_item, 1);
+    nmi->v = v;
+    nmi->path = g_strdup(path);
+    g_hash_table_insert(phandles, GUINT_TO_POINTER(v), nmi);
+    sprintf(phstr, "0x%08x", nmi->v);
+    sysobj_virt_batch_add_simple(b, ":/devicetree/_phandle_map", phstr, nmi->path, VSO_TYPE_SYMLINK | VSO_TYPE_AUTOLINK | VSO_TYPE_DYN );
+}
+
+static void dtr_fdt_phandle_scan(sysobj_virt_batch *b, const fdt_node *n) {
+    const fdt_prop *fp = fdt_prop_find(n, "phandle");
+    if (!fp)
+        fp = fdt_prop_find(n, "linux,phandle");
+    if (fp && fp->len == 4) {
+        gchar *path = g_strdup_printf("%s%s", DTROOT, n->path);
+        dtr_phandle_add(b, fdt_prop_u32(fp), path);
+        g_free(path);
     }
-    /* the symbols list owns each fn (->data) via nmi */
-    g_slist_free(childs);
-    sysobj_free(alo);
+    for (guint i = 0; i < n->childs->len; i++)
+        dtr_fdt_phandle_scan(b, g_ptr_array_index(n->childs, i));
 }
 
-static void dtr_phandle_scan(gchar *nb, gchar *nn) {
-    gchar phstr[20] = "";
+static void dtr_phandle_scan(sysobj_virt_batch *b, gchar *nb, gchar *nn) {
     sysobj *obj = sysobj_new_from_fn(nb, nn);
     if (obj && obj->exists && obj->data.is_dir) {
         /* this object */
         sysobj *phobj = sysobj_child(obj, "phandle");
         if (phobj && phobj->exists) {
             sysobj_read(phobj, FALSE);
-            dtr_map_item *nmi = g_new0(dtr_map_item, 1);
-            nmi->v = be32toh(*phobj->data.uint32);
-            nmi->path = g_strdup(obj->path);
-            phandles = g_slist_append(phandles, nmi);
-            sprintf(phstr, "0x%08x", nmi->v);
-            sysobj_virt_add_simple(":/devicetree/_phandle_map", phstr, nmi->path, VSO_TYPE_SYMLINK | VSO_TYPE_AUTOLINK | VSO_TYPE_DYN );
+            dtr_phandle_add(b, be32toh(*phobj->data.uint32), obj->path);
         }
         sysobj_free(phobj);
 
@@ -936,7 +1035,7 @@ static void dtr_phandle_scan(gchar *nb, gchar *nn) {
         GSList *childs = sysobj_children(obj, NULL, NULL, FALSE);
         GSList *l = childs;
         while(l) {
-            dtr_phandle_scan(obj->path, l->data);
+            dtr_phandle_scan(b, obj->path, l->data);
             /* won't need this again */
             g_free(l->data);
             l = l->next;
@@ -955,16 +1054,37 @@ gboolean dtr_init() {
     }
 
     dtr_log = g_strdup("");
+    phandles = g_hash_table_new_full(g_direct_hash, g_direct_equal, NULL, (GDestroyNotify)dtr_map_free);
+    aliases = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, (GDestroyNotify)dtr_map_free);
+    alias_paths = g_hash_table_new(g_str_hash, g_str_equal);
+    symbols = g_hash_table_new_full(g_str_hash, g_str_equal, NULL, (GDestroyNotify)dtr_map_free);
+    symbol_paths = g_hash_table_new(g_str_hash, g_str_equal);
+
+    if (dtr_have_overlays() )
+        dtr_msg("overlays applied, not using %s", FDT_FILE);
+    else {
+        sysobj *fdt_obj = sysobj_new_from_fn(FDT_FILE, NULL);
+        if (fdt_obj->exists)
+            fdt = fdt_load(fdt_obj->path_fs);
+        sysobj_free(fdt_obj);
+    }
+    if (fdt)
+        dtr_msg("%u node(s) read from %s (v%u).", fdt_node_count(fdt), FDT_FILE, fdt->version);
 
-    if (!sysobj_exists_from_fn(DTROOT, NULL)) {
+    if (!fdt && !sysobj_exists_from_fn(DTROOT, NULL)) {
         dtr_msg("devicetree not found at %s", DTROOT);
     } else {
-        dtr_alias_scan();
-        dtr_msg("%d alias(es) read from /aliases.", g_slist_length(aliases) );
-        dtr_symbol_scan();
-        dtr_msg("%d symbol(s) read from /__symbols__.", g_slist_length(symbols) );
-        dtr_phandle_scan(DTROOT, NULL);
-        dtr_msg("%d phandle(s) found.", g_slist_length(phandles) );
+        dtr_label_scan("aliases", aliases, alias_paths, ":/devicetree/_alias_map");
+        dtr_msg("%d alias(es) read from /aliases.", g_hash_table_size(aliases) );
+        dtr_label_scan("__symbols__", symbols, symbol_paths, ":/devicetree/_symbol_map");
+        dtr_msg("%d symbol(s) read from /__symbols__.", g_hash_table_size(symbols) );
+        sysobj_virt_batch *b = sysobj_virt_batch_new(FALSE);
+        if (fdt)
+            dtr_fdt_phandle_scan(b, fdt->root);
+        else
+            dtr_phandle_scan(b, DTROOT, NULL);
+        sysobj_virt_batch_commit(b);
+        dtr_msg("%d phandle(s) found.", g_hash_table_size(phandles) );
     }
 }
 
@@ -973,12 +1093,16 @@ void dtr_cleanup() {
         if (prop_types[i].pspec)
             g_pattern_spec_free(prop_types[i].pspec);
     }
-    if (phandles)
-        g_slist_free_full(phandles, (GDestroyNotify)dtr_map_free);
-    if (aliases)
-        g_slist_free_full(aliases, (GDestroyNotify)dtr_map_free);
-    if (symbols)
-        g_slist_free_full(symbols, (GDestroyNotify)dtr_map_free);
+    /* the by-path maps don't own their items, so first */
+    fdt_free(fdt);
+    fdt = NULL;
+    phandle_files_scanned = FALSE;
+    GHashTable **maps[] = { &alias_paths, &symbol_paths, &phandles, &aliases, &symbols };
+    for (int i = 0; i < (int)G_N_ELEMENTS(maps); i++) {
+        if (*maps[i])
+            g_hash_table_destroy(*maps[i]);
+        *maps[i] = NULL;
+    }
     g_free(dtr_log);
 }
 
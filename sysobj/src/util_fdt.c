@@ -0,0 +1,195 @@
+/*
+ * sysobj - https://github.com/bp0/verbose-spork
+ * Copyright (C) 2018  Burt P. <pburt0@gmail.com>
+ *
+ * This program is free software; you can redistribute it and/or
+ * modify it under the terms of the GNU General Public License
+ * as published by the Free Software Foundation; either version 2
+ * of the License, or (at your option) any later version.
+ *
+ * This program is distributed in the hope that it will be useful,
+ * but WITHOUT ANY WARRANTY; without even the implied warranty of
+ * MERCHANTABILITY or FITNESS FOR A PARTICULAR PURPOSE.  See the
+ * GNU General Public License for more details.
+ *
+ * You should have received a copy of the GNU General Public License
+ * along with this program; if not, write to the Free Software
+ * Foundation, Inc., 51 Franklin Street, Fifth Floor, Boston, MA  02110-1301, USA.
+ *
+ */
+
+#include "util_fdt.h"
+#include "util_sysobj.h"
+#include <string.h>
+#include <endian.h>
+#include <stdio.h>
+
+#define FDT_MAGIC       0xd00dfeed
+#define FDT_BEGIN_NODE  1
+#define FDT_END_NODE    2
+#define FDT_PROP        3
+#define FDT_NOP         4
+#define FDT_END         9
+
+#define FDT_HEADER_SIZE 40
+#define FDT_MAX_DEPTH   64 /* like dtc, and the nodes are freed recursively */
+#define FDT_ALIGN(x) (((x) + 3) & ~3)
+
+#define fdt_msg(fmt, ...) fprintf (stderr, "[%s] " fmt "\n", __FUNCTION__, ##__VA_ARGS__)
+
+static guint32 be32_at(const gchar *p) {
+    guint32 v;
+    memcpy(&v, p, sizeof(v));
+    return be32toh(v);
+}
+
+static void fdt_node_free(fdt_node *n) {
+    if (!n) return;
+    g_ptr_array_free(n->childs, TRUE);
+    g_array_free(n->props, TRUE);
+    g_free(n->path);
+    g_free(n);
+}
+
+static fdt_node *fdt_node_new(fdt_tree *t, fdt_node *parent, const gchar *name, gsize name_len) {
+    fdt_node *n = g_new0(fdt_node, 1);
+    gsize plen = parent ? strlen(parent->path) : 0;
+    n->path = parent
+        ? g_strdup_printf("%s/%.*s", parent->path, (int)name_len, name)
+        : g_strdup("");
+    n->name = parent ? n->path + plen + 1 : n->path;
+    n->parent = parent;
+    n->childs = g_ptr_array_new_with_free_func((GDestroyNotify)fdt_node_free);
+    n->props = g_array_new(FALSE, FALSE, sizeof(fdt_prop));
+    if (parent)
+        g_ptr_array_add(parent->childs, n);
+    g_hash_table_insert(t->nodes, n->path, n);
+    return n;
+}
+
+fdt_tree *fdt_parse(gchar *blob, gsize len) {
+    if (!blob || len < FDT_HEADER_SIZE || be32_at(blob) != FDT_MAGIC) {
+        g_free(blob);
+        return NULL;
+    }
+
+    guint32 totalsize = be32_at(blob + 4);
+    guint32 off_struct = be32_at(blob + 8);
+    guint32 off_strings = be32_at(blob + 12);
+    guint32 version = be32_at(blob + 20);
+    guint32 last_comp = be32_at(blob + 24);
+    guint32 size_strings = be32_at(blob + 32);
+    guint32 size_struct = be32_at(blob + 36);
+
+    if (totalsize > len || version < 16 || last_comp > 17
+        || off_struct >= totalsize || off_strings > totalsize
+        || size_strings > totalsize - off_strings) {
+        g_free(blob);
+        return NULL;
+    }
+    if (version < 17) /* no size_dt_struct */
+        size_struct = totalsize - off_struct;
+    if (size_struct > totalsize - off_struct) {
+        g_free(blob);
+        return NULL;
+    }
+
+    fdt_tree *t = g_new0(fdt_tree, 1);
+    t->blob = blob;
+    t->len = len;
+    t->version = version;
+    t->nodes = g_hash_table_new(g_str_hash, g_str_equal);
+
+    const gchar *strs = blob + off_strings;
+    const gchar *p = blob + off_struct, *end = p + size_struct;
+    fdt_node *cur = NULL;
+    int depth = 0;
+    gboolean ok = FALSE;
+
+    while (p + 4 <= end) {
+        guint32 tok = be32_at(p);
+        p += 4;
+        if (tok == FDT_BEGIN_NODE) {
+            gsize nl = strnlen(p, end - p);
+            if (p + nl >= end) break;
+            if (!cur && t->root) break; /* a second root */
+            if (++depth > FDT_MAX_DEPTH) break;
+            cur = fdt_node_new(t, cur, p, nl);
+            if (!t->root) t->root = cur;
+            p += FDT_ALIGN(nl + 1);
+        } else if (tok == FDT_END_NODE) {
+            if (!cur) break;
+            cur = cur->parent;
+            depth--;
+        } else if (tok == FDT_PROP) {
+            if (!cur || p + 8 > end) break;
+            guint32 plen = be32_at(p);
+            guint32 nameoff = be32_at(p + 4);
+            p += 8;
+            if (plen > (gsize)(end - p) || nameoff >= size_strings
+                || !memchr(strs + nameoff, 0, size_strings - nameoff) )
+                break;
+            fdt_prop prop = { strs + nameoff, (const guint8*)p, plen };
+            g_array_append_val(cur->props, prop);
+            p += FDT_ALIGN(plen);
+        } else if (tok == FDT_NOP) {
+            continue;
+        } else if (tok == FDT_END) {
+            ok = (!cur && t->root);
+            break;
+        } else
+            break;
+    }
+
+    if (!ok) {
+        fdt_msg("bad or truncated devicetree blob");
+        fdt_free(t);
+        return NULL;
+    }
+    return t;
+}
+
+fdt_tree *fdt_load(const gchar *file) {
+    gchar *blob = NULL;
+    gsize len = 0;
+    if (!g_file_get_contents(file, &blob, &len, NULL))
+        return NULL;
+    return fdt_parse(blob, len);
+}
+
+void fdt_free(fdt_tree *t) {
+    if (!t) return;
+    g_hash_table_destroy(t->nodes);
+    fdt_node_free(t->root);
+    g_free(t->blob);
+    g_free(t);
+}
+
+const fdt_node *fdt_node_find(const fdt_tree *t, const gchar *path) {
+    if (!t || !path) return NULL;
+    if (SEQ(path, "/"))
+        path = "";
+    gsize len = strlen(path);
+    if (len && path[len-1] == '/') {
+        gchar *trim = g_strndup(path, len - 1);
+        const fdt_node *ret = g_hash_table_lookup(t->nodes, trim);
+        g_free(trim);
+        return ret;
+    }
+    return g_hash_table_lookup(t->nodes, path);
+}
+
+const fdt_prop *fdt_prop_find(const fdt_node *n, const gchar *name) {
+    if (!n || !name) return NULL;
+    /* usually only a handful per node */
+    for (guint i = 0; i < n->props->len; i++) {
+        const fdt_prop *p = &g_array_index(n->props, fdt_prop, i);
+        if (SEQ(p->name, name))
+            return p;
+    }
+    return NULL;
+}
+
+guint fdt_node_count(const fdt_tree *t) {
+    return t ? g_hash_table_size(t->nodes) : 0;
+}
@@ -26,6 +26,7 @@
 #include <ctype.h>   /* for isxdigit(), etc. */
 
 #include "util_sysobj.h"
+#include "sysobj.h"  /* for sysobj_raw_from_fn() */
 
 gchar *util_build_fn(const gchar *base, const gchar *name) {
     gchar *ret = NULL;
@@ -301,3 +302,58 @@ gchar *util_find_line_value(gchar *data, gchar *key, gchar delim) {
     g_strfreev(lines);
     return ret;
 }
+
+guint64 util_counter_delta(guint64 cur, guint64 prev) {
+    if (cur >= prev)
+        return cur - prev;
+    /* a 64-bit counter won't wrap, it was reset,
+     * like a driver reload, so counted from 0 */
+    return cur;
+}
+
+guint64 util_counter32_delta(guint64 cur, guint64 prev) {
+    if (cur < prev && prev <= G_MAXUINT32)
+        return (G_MAXUINT32 - prev) + cur + 1;
+    return util_counter_delta(cur, prev);
+}
+
+double util_sample_dt(gint64 *last) {
+    gint64 now = g_get_monotonic_time();
+    double dt = 0;
+    if (*last) {
+        dt = (double)(now - *last) / G_USEC_PER_SEC;
+    } else {
+        gchar *up = sysobj_raw_from_fn("/proc/uptime", NULL);
+        if (up) dt = g_ascii_strtod(up, NULL);
+        g_free(up);
+    }
+    *last = now;
+    return dt;
+}
+
+int util_key_table_scan(const gchar *data, int skip_words, const gchar * const *keys, int nkeys, guint64 *values) {
+    int found = 0;
+    const gchar *p = data;
+    while (p && *p) {
+        for (int w = 0; w < skip_words; w++) {
+            while (*p == ' ' || *p == '\t') p++;
+            while (*p && !isspace((unsigned char)*p)) p++;
+        }
+        while (*p == ' ' || *p == '\t') p++;
+        const gchar *key = p;
+        while (*p && *p != ':' && !isspace((unsigned char)*p)) p++;
+        gsize len = p - key;
+        if (*p == ':') p++;
+
+        for (int i = 0; len && i < nkeys; i++) {
+            if (strncmp(keys[i], key, len) == 0 && keys[i][len] == 0) {
+                values[i] = g_ascii_strtoull(p, NULL, 10);
+                found++;
+                break;
+            }
+        }
+        p = strchr(p, '\n');
+        if (p) p++;
+    }
+    return found;
+}
@@ -318,16 +318,64 @@ const char *x86_flag_list() {
     return all_flags;
 }
 
+/* open addressing hash of tab_flag_meaning indexes, built
+ * once on first use; a thread that loses the race to
+ * publish it just frees its own */
+static int *flag_index = NULL;
+static unsigned int flag_index_mask = 0;
+
+static unsigned int flag_hash(const char *s) {
+    unsigned int h = 2166136261u; /* FNV-1a */
+    while (*s) {
+        h ^= (unsigned char)*s++;
+        h *= 16777619u;
+    }
+    return h;
+}
+
+static int *flag_index_get(void) {
+    int *idx = __atomic_load_n(&flag_index, __ATOMIC_ACQUIRE);
+    if (idx) return idx;
+
+    unsigned int n = 0, size = 1, i;
+    while(tab_flag_meaning[n].name != NULL) n++;
+    while (size < n * 2) size <<= 1;
+    idx = malloc(size * sizeof(int));
+    if (!idx) return NULL;
+    for (i = 0; i < size; i++) idx[i] = -1;
+    for (i = 0; i < n; i++) {
+        unsigned int h = flag_hash(tab_flag_meaning[i].name) & (size - 1);
+        while (idx[h] >= 0) {
+            /* first definition wins, as with the scan */
+            if (SEQ(tab_flag_meaning[idx[h]].name, tab_flag_meaning[i].name))
+                break;
+            h = (h + 1) & (size - 1);
+        }
+        if (idx[h] < 0)
+            idx[h] = i;
+    }
+
+    int *expect = NULL;
+    __atomic_store_n(&flag_index_mask, size - 1, __ATOMIC_RELAXED);
+    if (!__atomic_compare_exchange_n(&flag_index, &expect, idx, 0, __ATOMIC_RELEASE, __ATOMIC_ACQUIRE)) {
+        free(idx);
+        return expect;
+    }
+    return idx;
+}
+
 const char *x86_flag_meaning(const char *flag) {
-    int i = 0;
-    if (flag)
-    while(tab_flag_meaning[i].name != NULL) {
-        if (SEQ(tab_flag_meaning[i].name, flag)) {
-            if (tab_flag_meaning[i].meaning != NULL)
-                return C_("x86-flag", tab_flag_meaning[i].meaning);
+    int *idx;
+    if (!flag || !(idx = flag_index_get()) )
+        return NULL;
+    unsigned int h = flag_hash(flag) & flag_index_mask;
+    while (idx[h] >= 0) {
+        if (SEQ(tab_flag_meaning[idx[h]].name, flag)) {
+            if (tab_flag_meaning[idx[h]].meaning != NULL)
+                return C_("x86-flag", tab_flag_meaning[idx[h]].meaning);
             else return NULL;
         }
-        i++;
+        h = (h + 1) & flag_index_mask;
     }
     return NULL;
 }
@@ -8,6 +8,7 @@ zip -y -r "SS_$ZNAME.zip" \
 	/sys/block \
 	/sys/class \
 	/sys/firmware/devicetree/base \
+	/sys/firmware/fdt \
 	/sys/devices \
 	/sys/devices/system/cpu/ \
 	/sys/devices/virtual/dmi/id \